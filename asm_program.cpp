@@ -0,0 +1,251 @@
+#include <array>
+#include <sstream>
+#include <unordered_set>
+#include "asm_program.h"
+
+asm_line asm_line::instruction(const std::string& opcode, const std::vector<std::string>& operands){
+    return asm_line{line_type::INSTRUCTION, "", opcode, operands};
+}
+
+asm_line asm_line::label(const std::string& name){
+    return asm_line{line_type::LABEL, name, "", {}};
+}
+
+bool asm_line::is_jump() const noexcept{
+    return is_instruction() && opcode.size() > 1 && opcode[0] == 'j';
+}
+
+bool asm_line::is_conditional_jump() const noexcept{
+    return is_jump() && opcode != "jmp";
+}
+
+static std::string trim(const std::string& str){
+    auto begin = str.find_first_not_of(" \t");
+    if(begin == std::string::npos)
+        return "";
+    auto end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+asm_program::asm_program(const std::string& code){
+    std::istringstream input(code);
+    std::string line;
+    bool is_data = false;
+    int source_line = 0;
+    while(std::getline(input, line)){
+        auto text = trim(line);
+        if(text.starts_with("; line ")){
+            source_line = std::stoi(text.substr(7));
+            continue;
+        }
+        if(text.starts_with("section")){
+            is_data = text != "section .text";
+        }
+        if(is_data || text.empty() || text.starts_with("section") || text.starts_with("extern") || text.starts_with("global")){
+            _lines.push_back(asm_line{asm_line::line_type::OTHER, line, "", {}});
+            continue;
+        }
+        if(text.back() == ':' && text.find_first_of(" \t") == std::string::npos){
+            _lines.push_back(asm_line::label(text.substr(0, text.size() - 1)));
+            _lines.back().source_line = source_line;
+            continue;
+        }
+
+        auto opcode_end = text.find_first_of(" \t");
+        asm_line instruction = asm_line::instruction(text.substr(0, opcode_end));
+        if(opcode_end != std::string::npos){
+            //split the operands by the commas outside of the brackets
+            std::string operand;
+            int depth = 0;
+            for(char c : text.substr(opcode_end + 1)){
+                if(c == ',' && depth == 0){
+                    instruction.operands.push_back(trim(operand));
+                    operand.clear();
+                    continue;
+                }
+                depth += c == '[' ? 1 : c == ']' ? -1 : 0;
+                operand += c;
+            }
+            instruction.operands.push_back(trim(operand));
+        }
+        instruction.source_line = source_line;
+        _lines.push_back(instruction);
+    }
+}
+
+int asm_program::get_text_end() const noexcept{
+    for(int i = 0; i < static_cast<int>(_lines.size()); i++){
+        if(_lines[i].type == asm_line::line_type::OTHER && trim(_lines[i].text).starts_with("section .data")){
+            return i;
+        }
+    }
+    return _lines.size();
+}
+
+std::string asm_program::to_string() const{
+    std::string code;
+    for(const auto& line : _lines){
+        switch (line.type){
+            case asm_line::line_type::INSTRUCTION:
+                code += '\t' + line.opcode;
+                for(size_t i = 0; i < line.operands.size(); i++){
+                    code += (i == 0 ? " " : ", ") + line.operands[i];
+                }
+                break;
+            case asm_line::line_type::LABEL:
+                code += line.text + ':';
+                break;
+            case asm_line::line_type::OTHER:
+                code += line.text;
+                break;
+        }
+        code += '\n';
+    }
+    return code;
+}
+
+std::unordered_map<std::string, int> asm_program::get_label_lines() const{
+    std::unordered_map<std::string, int> label_lines;
+    int text_end = get_text_end();
+    for(int i = 0; i < text_end; i++){
+        if(_lines[i].is_label()){
+            label_lines[_lines[i].text] = i;
+        }
+    }
+    return label_lines;
+}
+
+std::vector<basic_block> asm_program::build_cfg() const{
+    std::vector<basic_block> blocks;
+    int text_end = get_text_end();
+    blocks.push_back(basic_block{0, text_end});
+    for(int i = 0; i < text_end; i++){
+        const auto& line = _lines[i];
+        if(line.is_label()){
+            if(blocks.back().last_instruction != -1){
+                blocks.back().end = i;
+                blocks.push_back(basic_block{i, text_end});
+            }
+            blocks.back().labels.push_back(line.text);
+        }else if(line.is_instruction()){
+            blocks.back().last_instruction = i;
+            if(line.is_jump() || line.opcode == "ret"){
+                blocks.back().end = i + 1;
+                blocks.push_back(basic_block{i + 1, text_end});
+            }
+        }
+    }
+
+    std::unordered_map<std::string, int> label_blocks;
+    for(int i = 0; i < static_cast<int>(blocks.size()); i++){
+        for(const auto& label : blocks[i].labels){
+            label_blocks[label] = i;
+        }
+    }
+    for(int i = 0; i < static_cast<int>(blocks.size()); i++){
+        auto& block = blocks[i];
+        int next = i + 1 < static_cast<int>(blocks.size()) ? i + 1 : -1;
+        if(block.last_instruction == -1){
+            block.fallthrough = next;
+            continue;
+        }
+        const auto& last = _lines[block.last_instruction];
+        if(last.is_jump()){
+            auto it = label_blocks.find(last.operands[0]);
+            block.taken = it == label_blocks.end() ? -1 : it->second;
+            block.fallthrough = last.is_conditional_jump() ? next : -1;
+        }else if(last.opcode != "ret"){
+            block.fallthrough = next;
+        }
+    }
+    for(int i = 0; i < static_cast<int>(blocks.size()); i++){
+        for(int successor : {blocks[i].taken, blocks[i].fallthrough}){
+            if(successor != -1){
+                blocks[successor].predecessors.push_back(i);
+            }
+        }
+    }
+    return blocks;
+}
+
+std::string asm_program::make_label(const std::string& prefix){
+    return prefix + std::to_string(_label_count++);
+}
+
+std::string asm_program::invert_jump(const std::string& opcode){
+    static const std::unordered_map<std::string, std::string> inverted = {
+        {"jz", "jnz"}, {"jnz", "jz"}, {"je", "jne"}, {"jne", "je"},
+        {"jl", "jge"}, {"jge", "jl"}, {"jg", "jle"}, {"jle", "jg"},
+        {"js", "jns"}, {"jns", "js"}
+    };
+    auto it = inverted.find(opcode);
+    return it == inverted.end() ? "" : it->second;
+}
+
+bool asm_program::is_memory_operand(const std::string& operand){
+    return operand.find('[') != std::string::npos;
+}
+
+std::string asm_program::get_memory_symbol(const std::string& operand){
+    auto begin = operand.find('[');
+    auto end = operand.find(']');
+    if(begin == std::string::npos || end == std::string::npos)
+        return "";
+    auto symbol = operand.substr(begin + 1, end - begin - 1);
+    //[rel name] of the position independent code is the same variable as [name]
+    if(symbol.starts_with("rel "))
+        symbol = symbol.substr(4);
+    //a slot of the stack frame is a variable too, other addresses with an offset aren't
+    if(symbol.starts_with("rbp - ") && is_immediate(symbol.substr(6)))
+        return symbol;
+    if(symbol.find_first_of(" +-*") != std::string::npos)
+        return "";
+    return symbol;
+}
+
+bool asm_program::is_register(const std::string& operand){
+    static const std::unordered_set<std::string> registers = {
+        "rax", "rbx", "rcx", "rdx", "rsi", "rdi", "rbp", "rsp",
+        "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+    };
+    return registers.contains(operand);
+}
+
+namespace{
+
+//64-bit register, its 32-bit and its low 8-bit parts
+const std::vector<std::array<std::string, 3>> register_parts = {
+    {"rax", "eax", "al"}, {"rbx", "ebx", "bl"}, {"rcx", "ecx", "cl"}, {"rdx", "edx", "dl"},
+    {"rsi", "esi", "sil"}, {"rdi", "edi", "dil"}, {"rbp", "ebp", "bpl"}, {"rsp", "esp", "spl"}
+};
+
+}
+
+std::string asm_program::get_full_register(const std::string& operand){
+    if(is_register(operand))
+        return operand;
+    if(operand.size() > 2 && operand[0] == 'r' && (operand.back() == 'd' || operand.back() == 'b')
+     && is_register(operand.substr(0, operand.size() - 1)))
+        return operand.substr(0, operand.size() - 1);
+    for(const auto& parts : register_parts){
+        if(operand == parts[1] || operand == parts[2])
+            return parts[0];
+    }
+    return operand;
+}
+
+std::string asm_program::get_register_part(const std::string& reg, int bits){
+    int part = bits == 32 ? 1 : 2;
+    for(const auto& parts : register_parts){
+        if(reg == parts[0])
+            return parts[part];
+    }
+    return reg + (bits == 32 ? "d" : "b");
+}
+
+bool asm_program::is_immediate(const std::string& operand){
+    if(operand.empty())
+        return false;
+    size_t start = operand[0] == '-' ? 1 : 0;
+    return start < operand.size() && operand.find_first_not_of("0123456789", start) == std::string::npos;
+}
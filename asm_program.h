@@ -0,0 +1,81 @@
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//one line of the generated assembly
+struct asm_line{
+    enum class line_type{
+        INSTRUCTION,
+        LABEL,
+        //directives, data and empty lines, kept as they are
+        OTHER
+    };
+    line_type type;
+    //the name of a label or the whole text of other lines
+    std::string text;
+    std::string opcode;
+    std::vector<std::string> operands;
+    //the source line of the statement the line is generated for, 0 if it isn't known
+    int source_line = 0;
+
+    static asm_line instruction(const std::string& opcode, const std::vector<std::string>& operands = {});
+    static asm_line label(const std::string& name);
+
+    inline bool is_instruction() const noexcept{ return type == line_type::INSTRUCTION; }
+    inline bool is_label() const noexcept{ return type == line_type::LABEL; }
+    bool is_jump() const noexcept;
+    bool is_conditional_jump() const noexcept;
+    inline bool is_unconditional_jump() const noexcept{ return is_instruction() && opcode == "jmp"; }
+};
+
+//a straight sequence of lines which is entered only at the beginning and left only at the end
+struct basic_block{
+    //lines [begin, end) of the program
+    int begin;
+    int end;
+    //the last instruction line, -1 for a block that has only labels
+    int last_instruction = -1;
+    std::vector<std::string> labels;
+    //the block the jump at the end goes to and the next block if the end isn't an unconditional jump
+    int taken = -1;
+    int fallthrough = -1;
+    std::vector<int> predecessors;
+};
+
+//the assembly generated for a program, the code generator emits text and the passes edit it line by line
+//no register lives across a label: every expression is computed from the variables in memory,
+//only the tail merging after the other block analyses jumps to the middle of a statement
+class asm_program{
+private:
+    std::vector<asm_line> _lines;
+    int _label_count = 0;
+public:
+    asm_program() = default;
+    //"; line N" comments of the code give the source lines of the next lines, they aren't kept
+    explicit asm_program(const std::string& code);
+
+    inline std::vector<asm_line>& get_lines() noexcept{ return _lines; }
+    inline const std::vector<asm_line>& get_lines() const noexcept{ return _lines; }
+    //the lines before the data section
+    int get_text_end() const noexcept;
+    std::string to_string() const;
+
+    //the blocks of the text section in the line order, the first one is the entry
+    std::vector<basic_block> build_cfg() const;
+    //label name -> line index of the text section
+    std::unordered_map<std::string, int> get_label_lines() const;
+    std::string make_label(const std::string& prefix);
+
+    //return an empty string if the jump can't be inverted
+    static std::string invert_jump(const std::string& opcode);
+    //return the symbol of a memory operand like [name] or the slot of [rbp - 8], an empty string for other operands
+    static std::string get_memory_symbol(const std::string& operand);
+    static bool is_memory_operand(const std::string& operand);
+    //a 64-bit general purpose register
+    static bool is_register(const std::string& operand);
+    static bool is_immediate(const std::string& operand);
+    //the 64-bit register of a part like r8d, eax or al, other operands are returned as they are
+    static std::string get_full_register(const std::string& operand);
+    //the 32-bit or the low 8-bit part of a 64-bit register
+    static std::string get_register_part(const std::string& reg, int bits);
+};
@@ -1,9 +1,10 @@
+#include <climits>
 #include "ast.h"
 #include "lexer.h"
 #include "parser.h"
 #include "code_generator.h"
 
-extern std::unique_ptr<symbol_table> global_sym_table;
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
 
 ast_node::ast_node(ast_node_type t, int val,
      const std::shared_ptr<ast_node>& left, const std::shared_ptr<ast_node>& right) :
@@ -176,11 +177,11 @@ if_statement::if_statement(std::shared_ptr<expression>&& cond,
 
 if_statement::if_statement(const if_statement& stat) : 
      statement(ast_node_type::IF_HEAD,0,stat._left, stat._right),
-      _if_stat(stat._if_stat), _else_stat(stat._else_stat)  {}
+      _if_stat(stat._if_stat), _else_stat(stat._else_stat), _is_branchless(stat._is_branchless)  {}
 
 if_statement::if_statement(if_statement&& stat) : 
      statement(ast_node_type::IF_HEAD,0,std::move(stat._left), std::move(stat._right)),
-      _if_stat(std::move(stat._if_stat)), _else_stat(std::move(stat._else_stat))  {}
+      _if_stat(std::move(stat._if_stat)), _else_stat(std::move(stat._else_stat)), _is_branchless(stat._is_branchless)  {}
 
 compound_statement::compound_statement(const std::shared_ptr<statement>& inner_stat,
      const std::shared_ptr<statement>& next) :
@@ -369,3 +370,235 @@ int for_statement::accept_visitor(code_generator& visitor) const{
     visitor.node_interaction(this);
     return 0; 
 }
+
+std::shared_ptr<expression> copy_expression(const std::shared_ptr<expression>& expr){
+    if(!expr)
+        return nullptr;
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            return std::make_shared<number_expression>(std::static_pointer_cast<number_expression>(expr)->get_number());
+        case ast_node_type::ID:
+            return std::make_shared<identifier_expression>(std::static_pointer_cast<identifier_expression>(expr)->get_id());
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            auto copy = std::make_shared<binary_expression>(*bin_expr);
+            copy->set_left(copy_expression(bin_expr->get_left()));
+            copy->set_right(copy_expression(bin_expr->get_right()));
+            return copy;
+        }
+    }
+}
+
+bool are_equal_expressions(const std::shared_ptr<expression>& left, const std::shared_ptr<expression>& right){
+    if(!left || !right)
+        return left == right;
+    if(left->get_type() != right->get_type())
+        return false;
+    switch (left->get_type()){
+        case ast_node_type::NUM:
+            return std::static_pointer_cast<number_expression>(left)->get_number() ==
+             std::static_pointer_cast<number_expression>(right)->get_number();
+        case ast_node_type::ID:
+            return std::static_pointer_cast<identifier_expression>(left)->get_id() ==
+             std::static_pointer_cast<identifier_expression>(right)->get_id();
+        default:{
+            const auto& left_expr = std::static_pointer_cast<binary_expression>(left);
+            const auto& right_expr = std::static_pointer_cast<binary_expression>(right);
+            return are_equal_expressions(left_expr->get_left(), right_expr->get_left()) &&
+             are_equal_expressions(left_expr->get_right(), right_expr->get_right());
+        }
+    }
+}
+
+bool can_trap(const std::shared_ptr<expression>& expr){
+    if(!expr || expr->get_type() == ast_node_type::NUM || expr->get_type() == ast_node_type::ID)
+        return false;
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    if(expr->get_type() == ast_node_type::DIV){
+        //idiv faults on a zero divisor and on INT64_MIN / -1
+        const auto& divisor = bin_expr->get_right();
+        if(divisor->get_type() != ast_node_type::NUM)
+            return true;
+        int val = std::static_pointer_cast<number_expression>(divisor)->get_number();
+        if(val == 0 || val == -1)
+            return true;
+    }
+    return can_trap(bin_expr->get_left()) || can_trap(bin_expr->get_right());
+}
+
+static std::shared_ptr<compound_statement> copy_compound(const std::shared_ptr<compound_statement>& stat){
+    return std::static_pointer_cast<compound_statement>(copy_statements(stat));
+}
+
+std::shared_ptr<statement> copy_statements(const std::shared_ptr<statement>& stat){
+    if(!stat)
+        return nullptr;
+    std::shared_ptr<statement> copy;
+    switch (stat->get_type()){
+        case ast_node_type::PRINT:
+            copy = std::make_shared<print_statement>(copy_expression(std::static_pointer_cast<print_statement>(stat)->get_expression()));
+            break;
+        case ast_node_type::VAR_DECL:{
+            const auto& var_stat = std::static_pointer_cast<variable_declaration>(stat);
+            copy = std::make_shared<variable_declaration>(var_stat->get_identifier_code(), copy_expression(var_stat->get_expression()));
+            break;
+        }
+        case ast_node_type::ASSIGN:{
+            const auto& assign_stat = std::static_pointer_cast<assignment_statement>(stat);
+            copy = std::make_shared<assignment_statement>(assign_stat->get_identifier_code(), copy_expression(assign_stat->get_expression()));
+            break;
+        }
+        case ast_node_type::COMPOUND:
+            copy = std::make_shared<compound_statement>(copy_statements(std::static_pointer_cast<compound_statement>(stat)->get_inner_statement()));
+            break;
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(stat);
+            auto if_copy = std::make_shared<if_statement>(copy_expression(if_stat->get_conditional_expression()), nullptr,
+             copy_compound(if_stat->get_if_inner_statement()), copy_compound(if_stat->get_else_inner_statement()));
+            if_copy->set_branchless(if_stat->is_branchless());
+            copy = if_copy;
+            break;
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(stat);
+            copy = std::make_shared<while_statement>(copy_expression(while_stat->get_conditional_expression()), nullptr,
+             copy_compound(while_stat->get_inner_statement()));
+            break;
+        }
+        case ast_node_type::FOR_LOOP:{
+            const auto& for_stat = std::static_pointer_cast<for_statement>(stat);
+            copy = std::make_shared<for_statement>(std::static_pointer_cast<statement_with_id>(copy_statements(for_stat->get_start_statement())),
+             nullptr, copy_expression(for_stat->get_final_expression()), copy_expression(for_stat->get_after_iter_expression()),
+             copy_compound(for_stat->get_inner_statement()));
+            break;
+        }
+        default:
+            throw std::runtime_error("undefined statement type\n");
+    }
+    copy->set_line(stat->get_line());
+    copy->set_next(copy_statements(stat->get_next()));
+    return copy;
+}
+
+void collect_variables(const std::shared_ptr<expression>& expr, std::unordered_set<int>& read){
+    if(!expr)
+        return;
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            break;
+        case ast_node_type::ID:
+            read.emplace(std::static_pointer_cast<identifier_expression>(expr)->get_id());
+            break;
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            collect_variables(bin_expr->get_left(), read);
+            collect_variables(bin_expr->get_right(), read);
+            break;
+        }
+    }
+}
+
+void collect_variables(const std::shared_ptr<statement>& stat, std::unordered_set<int>& read, std::unordered_set<int>& written){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::PRINT:
+                collect_variables(std::static_pointer_cast<print_statement>(node)->get_expression(), read);
+                break;
+            case ast_node_type::VAR_DECL:
+            case ast_node_type::ASSIGN:{
+                const auto& stat_id = std::static_pointer_cast<statement_with_id>(node);
+                if(stat_id->get_expression()){
+                    collect_variables(stat_id->get_expression(), read);
+                    written.emplace(stat_id->get_identifier_code());
+                }
+                break;
+            }
+            case ast_node_type::COMPOUND:
+                collect_variables(std::static_pointer_cast<compound_statement>(node)->get_inner_statement(), read, written);
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                collect_variables(if_stat->get_conditional_expression(), read);
+                collect_variables(if_stat->get_if_inner_statement(), read, written);
+                collect_variables(if_stat->get_else_inner_statement(), read, written);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:{
+                const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+                collect_variables(while_stat->get_conditional_expression(), read);
+                collect_variables(while_stat->get_inner_statement(), read, written);
+                break;
+            }
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                int iterator_id = for_stat->get_start_statement()->get_identifier_code();
+                collect_variables(for_stat->get_start_statement(), read, written);
+                collect_variables(for_stat->get_final_expression(), read);
+                collect_variables(for_stat->get_after_iter_expression(), read);
+                collect_variables(for_stat->get_inner_statement(), read, written);
+                read.emplace(iterator_id);
+                written.emplace(iterator_id);
+                break;
+            }
+            default:
+                throw std::runtime_error("undefined statement type\n");
+        }
+    }
+}
+
+std::shared_ptr<expression> make_constant(int64_t value){
+    if(value >= INT_MIN && value <= INT_MAX)
+        return std::make_shared<number_expression>(value);
+    //(high * 65536 + middle) * 65536 + low, the registers wrap around like the unsigned numbers
+    auto high = std::make_shared<number_expression>(static_cast<int>(value >> 32));
+    auto middle = std::make_shared<number_expression>(static_cast<int>((value >> 16) & 0xFFFF));
+    auto low = std::make_shared<number_expression>(static_cast<int>(value & 0xFFFF));
+    auto factor = std::make_shared<number_expression>(65536);
+    auto expr = std::make_shared<binary_expression>(arithmetical_operation::MUL, high, factor);
+    auto upper = std::make_shared<binary_expression>(arithmetical_operation::ADD, expr, middle);
+    auto shifted = std::make_shared<binary_expression>(arithmetical_operation::MUL, upper, copy_expression(factor));
+    return std::make_shared<binary_expression>(arithmetical_operation::ADD, shifted, low);
+}
+
+int count_nodes(const std::shared_ptr<ast_node>& node){
+    if(!node)
+        return 0;
+    switch (node->get_type()){
+        case ast_node_type::NUM:
+        case ast_node_type::ID:
+            return 1;
+        case ast_node_type::PRINT:
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto& stat = std::static_pointer_cast<statement>(node);
+            const auto& expr = node->get_type() == ast_node_type::PRINT ?
+             std::static_pointer_cast<print_statement>(node)->get_expression() :
+             std::static_pointer_cast<statement_with_id>(node)->get_expression();
+            return 1 + count_nodes(expr) + count_nodes(stat->get_next());
+        }
+        case ast_node_type::COMPOUND:{
+            const auto& compound_stat = std::static_pointer_cast<compound_statement>(node);
+            return 1 + count_nodes(compound_stat->get_inner_statement()) + count_nodes(compound_stat->get_next());
+        }
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+            return 1 + count_nodes(if_stat->get_conditional_expression()) + count_nodes(if_stat->get_if_inner_statement()) +
+             count_nodes(if_stat->get_else_inner_statement()) + count_nodes(if_stat->get_next());
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+            return 1 + count_nodes(while_stat->get_conditional_expression()) + count_nodes(while_stat->get_inner_statement()) +
+             count_nodes(while_stat->get_next());
+        }
+        case ast_node_type::FOR_LOOP:{
+            const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+            return 1 + count_nodes(for_stat->get_start_statement()) + count_nodes(for_stat->get_final_expression()) +
+             count_nodes(for_stat->get_after_iter_expression()) + count_nodes(for_stat->get_inner_statement()) +
+             count_nodes(for_stat->get_next());
+        }
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(node);
+            return 1 + count_nodes(bin_expr->get_left()) + count_nodes(bin_expr->get_right());
+        }
+    }
+}
@@ -1,4 +1,6 @@
+#include <cstdint>
 #include <memory>
+#include <unordered_set>
 
 class code_generator;
 enum class operator_type;
@@ -131,6 +133,9 @@ public:
 
 //value is reserved, right node is for the next node and left node is reserved
 class statement : public ast_node{
+protected:
+    //the source line the statement starts at, 0 for the statements made by the passes
+    int _line = 0;
 protected:
     void check_validity() const;
 
@@ -150,6 +155,8 @@ public:
     virtual inline void set_next(const std::shared_ptr<statement>& next) noexcept{
         _right = next;
     }
+    inline int get_line() const noexcept{ return _line; }
+    inline void set_line(int line) noexcept{ _line = line; }
 
     virtual int accept_visitor(code_generator& visitor) const = 0;
 };
@@ -204,6 +211,8 @@ class if_statement : public statement{
 private:
     std::shared_ptr<compound_statement> _if_stat;
     std::shared_ptr<compound_statement> _else_stat;
+    //generate the statement with conditional moves instead of jumps
+    bool _is_branchless = false;
 public:
     if_statement(const std::shared_ptr<expression>& cond = std::shared_ptr<expression>(),
      const std::shared_ptr<statement>& next = std::shared_ptr<statement>(),
@@ -234,6 +243,12 @@ public:
     inline std::shared_ptr<compound_statement> get_else_inner_statement() const noexcept{
         return _else_stat;
     };
+    inline void set_branchless(bool is_branchless) noexcept{
+        _is_branchless = is_branchless;
+    }
+    inline bool is_branchless() const noexcept{
+        return _is_branchless;
+    }
 
     virtual int accept_visitor(code_generator& visitor) const;
     friend code_generator;
@@ -384,4 +399,20 @@ public:
     };
     virtual int accept_visitor(code_generator& visitor) const;
     friend code_generator;
-};
\ No newline at end of file
+};
+//deep copy of a statement and all the statements after it, the copy doesn't share any node with the original
+std::shared_ptr<statement> copy_statements(const std::shared_ptr<statement>& stat);
+//deep copy of an expression tree
+std::shared_ptr<expression> copy_expression(const std::shared_ptr<expression>& expr);
+//compare the trees of two expressions
+bool are_equal_expressions(const std::shared_ptr<expression>& left, const std::shared_ptr<expression>& right);
+//check if an expression may divide by zero or overflow a division
+bool can_trap(const std::shared_ptr<expression>& expr);
+//collect identifier codes of the variables read and written by an expression tree
+void collect_variables(const std::shared_ptr<expression>& expr, std::unordered_set<int>& read);
+//collect identifier codes of the variables read and written by a statement and all the statements after it
+void collect_variables(const std::shared_ptr<statement>& stat, std::unordered_set<int>& read, std::unordered_set<int>& written);
+//the expression of a value, a value that doesn't fit an int is built of 16-bit parts
+std::shared_ptr<expression> make_constant(int64_t value);
+//number of nodes in a tree, used to estimate the size of the generated code
+int count_nodes(const std::shared_ptr<ast_node>& node);
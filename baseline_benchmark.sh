@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# the compile time of the same generated program of 250 to 3000 statements with the code generator at -O0
+# and with the stencils of --backend=baseline, and the nodes the baseline generator copies in a millisecond
+# the partial evaluation is turned off, otherwise the program is run by the compiler
+cd build/
+cmake ..
+make
+
+echo ""
+TIMEFORMAT="%R"
+printf "%-12s %10s %10s %14s\n" "statements" "native" "baseline" "nodes per ms"
+for statements in 250 500 1000 2000 3000
+    do
+    {
+        echo "let a = 1;"
+        echo "let b = 2;"
+        echo "let c = 3;"
+        for (( i = 0; i < statements; i++ ))
+            do
+            echo "a = a * 3 + b - c * $(( i % 7 + 1 )) + a / 5;"
+            echo "if => (a < b){"
+            echo "    c = c + a - 1;"
+            echo "}"
+            done
+        echo "print(a);"
+        echo "print(c);"
+    } > baseline_bench.em
+    native=$( { time ./enma baseline_bench.em -O0 --eval-steps=0 -o baseline_native > /dev/null; } 2>&1 )
+    baseline=$( { time ./enma baseline_bench.em -O0 --eval-steps=0 -o baseline_stencils --backend=baseline > /dev/null; } 2>&1 )
+    rate=$(./enma baseline_bench.em -O0 --eval-steps=0 -o baseline_stencils --backend=baseline -v |
+     awk '/^baseline:/ { printf "%d", $2 / $5 }')
+    if ! cmp -s <(./baseline_native) <(./baseline_stencils)
+        then
+            echo "the outputs of the backends differ"
+        fi
+    printf "%-12s %9ss %9ss %14s\n" "${statements}" "${native}" "${baseline}" "${rate}"
+    done
+    rm -f baseline_bench.em baseline_native baseline_native.o baseline_stencils baseline_stencils.o
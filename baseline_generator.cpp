@@ -0,0 +1,488 @@
+#include <cstring>
+#include <stdexcept>
+#include "baseline_generator.h"
+#include "asm_program.h"
+#include "x86_encoder.h"
+#include "elf_object.h"
+#include "lexer.h"
+#include "ast.h"
+
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
+
+//every label starts a stencil that ends at the next one, _HOLE is the variable of the node
+//and -1515870811 is the immediate 0xA5A5A5A5 the number of the node replaces
+const char* baseline_generator::_stencil_code = R"(section .text
+	extern _HOLE
+	extern printf
+	extern fflush
+	extern fwrite
+	extern stdout
+	extern d_fmt
+	extern _PRECOMPUTED_OUTPUT
+_ADD_CONST:
+	add rax, -1515870811
+_ADD_VARIABLE:
+	add rax, [_HOLE]
+_ADD_POP:
+	mov rcx, rax
+	pop rax
+	add rax, rcx
+_SUB_CONST:
+	sub rax, -1515870811
+_SUB_VARIABLE:
+	sub rax, [_HOLE]
+_SUB_POP:
+	mov rcx, rax
+	pop rax
+	sub rax, rcx
+_MUL_CONST:
+	imul rax, rax, -1515870811
+_MUL_VARIABLE:
+	imul rax, [_HOLE]
+_MUL_POP:
+	mov rcx, rax
+	pop rax
+	imul rax, rcx
+_DIV_CONST:
+	mov rcx, -1515870811
+	cqo
+	idiv rcx
+_DIV_VARIABLE:
+	mov rcx, [_HOLE]
+	cqo
+	idiv rcx
+_DIV_POP:
+	mov rcx, rax
+	pop rax
+	cqo
+	idiv rcx
+_EQUAL_CONST:
+	cmp rax, -1515870811
+	sete al
+	movzx eax, al
+_EQUAL_VARIABLE:
+	cmp rax, [_HOLE]
+	sete al
+	movzx eax, al
+_EQUAL_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	sete al
+	movzx eax, al
+_NOT_EQUAL_CONST:
+	cmp rax, -1515870811
+	setne al
+	movzx eax, al
+_NOT_EQUAL_VARIABLE:
+	cmp rax, [_HOLE]
+	setne al
+	movzx eax, al
+_NOT_EQUAL_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	setne al
+	movzx eax, al
+_LESS_CONST:
+	cmp rax, -1515870811
+	setl al
+	movzx eax, al
+_LESS_VARIABLE:
+	cmp rax, [_HOLE]
+	setl al
+	movzx eax, al
+_LESS_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	setl al
+	movzx eax, al
+_LESS_EQUAL_CONST:
+	cmp rax, -1515870811
+	setle al
+	movzx eax, al
+_LESS_EQUAL_VARIABLE:
+	cmp rax, [_HOLE]
+	setle al
+	movzx eax, al
+_LESS_EQUAL_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	setle al
+	movzx eax, al
+_GREATER_CONST:
+	cmp rax, -1515870811
+	setg al
+	movzx eax, al
+_GREATER_VARIABLE:
+	cmp rax, [_HOLE]
+	setg al
+	movzx eax, al
+_GREATER_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	setg al
+	movzx eax, al
+_GREATER_EQUAL_CONST:
+	cmp rax, -1515870811
+	setge al
+	movzx eax, al
+_GREATER_EQUAL_VARIABLE:
+	cmp rax, [_HOLE]
+	setge al
+	movzx eax, al
+_GREATER_EQUAL_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+	setge al
+	movzx eax, al
+_COMPARE_CONST:
+	cmp rax, -1515870811
+_COMPARE_VARIABLE:
+	cmp rax, [_HOLE]
+_COMPARE_POP:
+	mov rcx, rax
+	pop rax
+	cmp rax, rcx
+_TEST:
+	test rax, rax
+_LOAD_CONST:
+	mov rax, -1515870811
+_LOAD_VARIABLE:
+	mov rax, [_HOLE]
+_PUSH:
+	push rax
+_STORE:
+	mov [_HOLE], rax
+_INCREMENT_CONST:
+	add qword [_HOLE], -1515870811
+_INCREMENT:
+	add [_HOLE], rax
+_PRINT:
+	mov rsi, rax
+	mov rdi, d_fmt
+	call printf
+_PROLOGUE:
+	push rbp
+	mov rbp, rsp
+_PRECOMPUTED_OUTPUT_WRITE:
+	mov rdi, _PRECOMPUTED_OUTPUT
+	mov rsi, 1
+	mov rdx, -1515870811
+	mov rcx, [stdout]
+	call fwrite
+_EPILOGUE:
+	mov rdi, [stdout]
+	call fflush
+	mov rsp, rbp
+	pop rbp
+	mov rax, 60
+	mov rdi, 0
+	syscall
+)";
+
+namespace{
+
+//the labels of the stencils in the order of stencil_kind
+const char* const stencil_labels[] = {
+    "_ADD_CONST", "_ADD_VARIABLE", "_ADD_POP",
+    "_SUB_CONST", "_SUB_VARIABLE", "_SUB_POP",
+    "_MUL_CONST", "_MUL_VARIABLE", "_MUL_POP",
+    "_DIV_CONST", "_DIV_VARIABLE", "_DIV_POP",
+    "_EQUAL_CONST", "_EQUAL_VARIABLE", "_EQUAL_POP",
+    "_NOT_EQUAL_CONST", "_NOT_EQUAL_VARIABLE", "_NOT_EQUAL_POP",
+    "_LESS_CONST", "_LESS_VARIABLE", "_LESS_POP",
+    "_LESS_EQUAL_CONST", "_LESS_EQUAL_VARIABLE", "_LESS_EQUAL_POP",
+    "_GREATER_CONST", "_GREATER_VARIABLE", "_GREATER_POP",
+    "_GREATER_EQUAL_CONST", "_GREATER_EQUAL_VARIABLE", "_GREATER_EQUAL_POP",
+    "_COMPARE_CONST", "_COMPARE_VARIABLE", "_COMPARE_POP",
+    "_TEST",
+    "_LOAD_CONST", "_LOAD_VARIABLE", "_PUSH", "_STORE",
+    "_INCREMENT_CONST", "_INCREMENT",
+    "_PRINT",
+    "_PROLOGUE", "_PRECOMPUTED_OUTPUT_WRITE", "_EPILOGUE"
+};
+static_assert(sizeof(stencil_labels) / sizeof(stencil_labels[0]) == static_cast<size_t>(stencil_kind::COUNT));
+
+//the first stencil of the operation, the stencils for a variable and a pushed value follow it
+stencil_kind get_operation(ast_node_type type){
+    switch (type){
+        case ast_node_type::ADD: return stencil_kind::ADD_CONST;
+        case ast_node_type::SUB: return stencil_kind::SUB_CONST;
+        case ast_node_type::MUL: return stencil_kind::MUL_CONST;
+        case ast_node_type::DIV: return stencil_kind::DIV_CONST;
+        case ast_node_type::EQUAL: return stencil_kind::EQUAL_CONST;
+        case ast_node_type::NEQUAl: return stencil_kind::NOT_EQUAL_CONST;
+        case ast_node_type::LESS: return stencil_kind::LESS_CONST;
+        case ast_node_type::LESS_EQ: return stencil_kind::LESS_EQUAL_CONST;
+        case ast_node_type::GREATER: return stencil_kind::GREATER_CONST;
+        case ast_node_type::GREATER_EQ: return stencil_kind::GREATER_EQUAL_CONST;
+        default:
+            throw std::runtime_error("undefined binary expression operator");
+    }
+}
+
+//the condition code of jcc that jumps when the comparison is true, -1 if it isn't a comparison
+int get_condition_code(ast_node_type type){
+    switch (type){
+        case ast_node_type::EQUAL: return 0x4;
+        case ast_node_type::NEQUAl: return 0x5;
+        case ast_node_type::LESS: return 0xC;
+        case ast_node_type::GREATER_EQ: return 0xD;
+        case ast_node_type::LESS_EQ: return 0xE;
+        case ast_node_type::GREATER: return 0xF;
+        default: return -1;
+    }
+}
+
+stencil_kind operator+(stencil_kind kind, int offset){
+    return static_cast<stencil_kind>(static_cast<int>(kind) + offset);
+}
+
+}
+
+const std::array<baseline_generator::stencil, static_cast<size_t>(stencil_kind::COUNT)>& baseline_generator::get_stencils(){
+    static const auto stencils = [](){
+        std::array<stencil, static_cast<size_t>(stencil_kind::COUNT)> result;
+        auto object = x86_encoder().encode(asm_program(_stencil_code));
+        const auto& text = object.get_sections()[object.find_section(".text")];
+        const auto& symbols = object.get_symbols();
+        for(size_t i = 0; i < result.size(); i++){
+            uint64_t begin = symbols[object.find_symbol(stencil_labels[i])].value;
+            uint64_t end = i + 1 < result.size() ? symbols[object.find_symbol(stencil_labels[i + 1])].value : text.bytes.size();
+            auto& current = result[i];
+            current.bytes.assign(text.bytes.begin() + begin, text.bytes.begin() + end);
+            for(size_t offset = 0; offset + 4 <= current.bytes.size(); offset++){
+                uint32_t field;
+                memcpy(&field, current.bytes.data() + offset, 4);
+                if(field == _value_marker){
+                    current.value_hole = offset;
+                    break;
+                }
+            }
+            for(const auto& relocation : text.relocations){
+                if(relocation.offset < begin || relocation.offset >= end)
+                    continue;
+                const auto& name = symbols[relocation.symbol].name;
+                int runtime_symbol = -1;
+                for(size_t j = 0; j < _runtime_symbol_names.size(); j++){
+                    if(name == _runtime_symbol_names[j])
+                        runtime_symbol = j;
+                }
+                if(runtime_symbol == -1 && name != "_HOLE")
+                    throw std::runtime_error("the stencil refers to an unknown symbol: " + name);
+                current.relocations.push_back(stencil_relocation{static_cast<uint32_t>(relocation.offset - begin),
+                 relocation.type, runtime_symbol, relocation.addend});
+            }
+        }
+        return result;
+    }();
+    return stencils;
+}
+
+baseline_generator::baseline_generator(){}
+
+baseline_generator::~baseline_generator(){}
+
+int baseline_generator::get_code_size() const{
+    return _object->get_sections()[_text].bytes.size();
+}
+
+void baseline_generator::emit(stencil_kind kind, int32_t value, int variable){
+    const auto& current = get_stencils()[static_cast<size_t>(kind)];
+    auto& section = _object->get_sections()[_text];
+    uint64_t begin = section.bytes.size();
+    section.bytes.insert(section.bytes.end(), current.bytes.begin(), current.bytes.end());
+    if(current.value_hole != -1)
+        memcpy(section.bytes.data() + begin + current.value_hole, &value, 4);
+    for(const auto& relocation : current.relocations){
+        int symbol = relocation.runtime_symbol == -1 ? variable : _runtime_symbols[relocation.runtime_symbol];
+        section.relocations.push_back(object_relocation{begin + relocation.offset, relocation.type, symbol, relocation.addend});
+    }
+}
+
+int baseline_generator::emit_jump(int condition){
+    auto& bytes = _object->get_sections()[_text].bytes;
+    if(condition == -1){
+        bytes.push_back(0xE9);
+    }else{
+        bytes.push_back(0x0F);
+        bytes.push_back(0x80 + condition);
+    }
+    bytes.insert(bytes.end(), 4, 0);
+    return bytes.size() - 4;
+}
+
+void baseline_generator::patch_jump(int field, int target){
+    int32_t distance = target - (field + 4);
+    memcpy(_object->get_sections()[_text].bytes.data() + field, &distance, 4);
+}
+
+int baseline_generator::get_variable(int id_code){
+    if(id_code >= static_cast<int>(_variable_symbols.size()))
+        _variable_symbols.resize(id_code + 1, -1);
+    if(_variable_symbols[id_code] == -1){
+        auto& data = _object->get_sections()[_data].bytes;
+        _variable_symbols[id_code] = _object->add_symbol("_" + std::to_string(id_code) + "_" +
+         global_sym_table->get_identifier(id_code), _data, data.size(), false);
+        data.insert(data.end(), 8, 0);
+    }
+    return _variable_symbols[id_code];
+}
+
+void baseline_generator::compile_operand(stencil_kind kind, const expression* right){
+    if(right->get_type() == ast_node_type::NUM){
+        _nodes_count++;
+        emit(kind, static_cast<const number_expression*>(right)->get_number());
+    }else if(right->get_type() == ast_node_type::ID){
+        _nodes_count++;
+        emit(kind + 1, 0, get_variable(static_cast<const identifier_expression*>(right)->get_id()));
+    }else{
+        emit(stencil_kind::PUSH);
+        compile_expression(right);
+        emit(kind + 2);
+    }
+}
+
+void baseline_generator::compile_expression(const expression* expr){
+    _nodes_count++;
+    if(expr->get_type() == ast_node_type::NUM){
+        emit(stencil_kind::LOAD_CONST, static_cast<const number_expression*>(expr)->get_number());
+        return;
+    }
+    if(expr->get_type() == ast_node_type::ID){
+        emit(stencil_kind::LOAD_VARIABLE, 0, get_variable(static_cast<const identifier_expression*>(expr)->get_id()));
+        return;
+    }
+    const auto* bin_expr = static_cast<const binary_expression*>(expr);
+    compile_expression(bin_expr->get_left().get());
+    compile_operand(get_operation(expr->get_type()), bin_expr->get_right().get());
+}
+
+int baseline_generator::compile_condition(const expression* cond, bool is_taken){
+    int condition = get_condition_code(cond->get_type());
+    if(condition == -1){
+        compile_expression(cond);
+        emit(stencil_kind::TEST);
+        return emit_jump(is_taken ? 0x5 : 0x4);
+    }
+    //the comparison sets the flags for the jump instead of a value
+    _nodes_count++;
+    const auto* bin_expr = static_cast<const binary_expression*>(cond);
+    compile_expression(bin_expr->get_left().get());
+    compile_operand(stencil_kind::COMPARE_CONST, bin_expr->get_right().get());
+    //the opposite condition differs in the lowest bit
+    return emit_jump(is_taken ? condition : condition ^ 1);
+}
+
+void baseline_generator::compile_statements(const statement* stat){
+    for(; stat; stat = stat->get_next().get()){
+        compile_statement(stat);
+    }
+}
+
+void baseline_generator::compile_statement(const statement* stat){
+    _nodes_count++;
+    switch (stat->get_type()){
+        case ast_node_type::PRINT:
+            compile_expression(static_cast<const print_statement*>(stat)->get_expression().get());
+            emit(stencil_kind::PRINT);
+            break;
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto* id_stat = static_cast<const statement_with_id*>(stat);
+            //an assignment can be only an identifier
+            if(!id_stat->get_expression())
+                break;
+            compile_expression(id_stat->get_expression().get());
+            emit(stencil_kind::STORE, 0, get_variable(id_stat->get_identifier_code()));
+            break;
+        }
+        case ast_node_type::COMPOUND:
+            compile_statements(static_cast<const compound_statement*>(stat)->get_inner_statement().get());
+            break;
+        case ast_node_type::IF_HEAD:{
+            const auto* if_stat = static_cast<const if_statement*>(stat);
+            int to_else = compile_condition(if_stat->get_conditional_expression().get(), false);
+            compile_statement(if_stat->get_if_inner_statement().get());
+            if(if_stat->get_else_inner_statement()){
+                int to_end = emit_jump(-1);
+                patch_jump(to_else, get_code_size());
+                compile_statement(if_stat->get_else_inner_statement().get());
+                patch_jump(to_end, get_code_size());
+            }else{
+                patch_jump(to_else, get_code_size());
+            }
+            break;
+        }
+        case ast_node_type::WHILE_LOOP:{
+            //the condition is after the body, an iteration ends with one jump
+            const auto* while_stat = static_cast<const while_statement*>(stat);
+            int to_condition = emit_jump(-1);
+            int body = get_code_size();
+            compile_statement(while_stat->get_inner_statement().get());
+            patch_jump(to_condition, get_code_size());
+            patch_jump(compile_condition(while_stat->get_conditional_expression().get(), true), body);
+            break;
+        }
+        case ast_node_type::FOR_LOOP:{
+            //the loop runs while the iterator isn't equal to the final value
+            const auto* for_stat = static_cast<const for_statement*>(stat);
+            compile_statement(for_stat->get_start_statement().get());
+            int iterator = get_variable(for_stat->get_start_statement()->get_identifier_code());
+            int to_condition = emit_jump(-1);
+            int body = get_code_size();
+            compile_statement(for_stat->get_inner_statement().get());
+            const auto* increment = for_stat->get_after_iter_expression().get();
+            if(increment->get_type() == ast_node_type::NUM){
+                _nodes_count++;
+                emit(stencil_kind::INCREMENT_CONST, static_cast<const number_expression*>(increment)->get_number(), iterator);
+            }else{
+                compile_expression(increment);
+                emit(stencil_kind::INCREMENT, 0, iterator);
+            }
+            patch_jump(to_condition, get_code_size());
+            emit(stencil_kind::LOAD_VARIABLE, 0, iterator);
+            compile_operand(stencil_kind::COMPARE_CONST, for_stat->get_final_expression().get());
+            patch_jump(emit_jump(get_condition_code(ast_node_type::NEQUAl)), body);
+            break;
+        }
+        default:
+            throw std::runtime_error("undefined statement");
+    }
+}
+
+elf_object baseline_generator::generate(const std::shared_ptr<statement>& root, const std::string& precomputed_output){
+    _object = std::make_unique<elf_object>();
+    _variable_symbols.clear();
+    _nodes_count = 0;
+    //the sections and the symbols of the objects the encoder makes from the generated assembly
+    _text = _object->add_section(".text", elf_object::allocated | elf_object::executable, 16);
+    _data = _object->add_section(".data", elf_object::allocated | elf_object::writable, 4);
+    _object->add_section(".note.GNU-stack", 0, 1);
+    _object->add_symbol("main", _text, 0, true);
+    for(size_t i = 0; i < _runtime_symbol_names.size(); i++){
+        std::string name = _runtime_symbol_names[i];
+        bool is_data = name == "d_fmt" || name == "_PRECOMPUTED_OUTPUT";
+        _runtime_symbols[i] = _object->add_symbol(name, is_data ? _data : -1, 0, !is_data);
+    }
+    //the format takes 8 bytes, so the variables after it are aligned
+    _object->get_sections()[_data].bytes = {'%', 'd', '\n', 0, 0, 0, 0, 0};
+
+    emit(stencil_kind::PROLOGUE);
+    if(!precomputed_output.empty())
+        emit(stencil_kind::PRECOMPUTED_OUTPUT, precomputed_output.size());
+    compile_statements(root.get());
+    emit(stencil_kind::EPILOGUE);
+    //the output is after the variables, they are known at the end
+    auto& data = _object->get_sections()[_data].bytes;
+    _object->get_symbols()[_runtime_symbols.back()].value = data.size();
+    data.insert(data.end(), precomputed_output.begin(), precomputed_output.end());
+    auto object = std::move(*_object);
+    _object.reset();
+    return object;
+}
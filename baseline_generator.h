@@ -0,0 +1,101 @@
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class elf_object;
+class expression;
+class statement;
+enum class relocation_type : uint32_t;
+
+//the stencils in the order of their labels in the stencil code, every operation has a stencil for a constant,
+//a variable and a value pushed to the stack on its right
+enum class stencil_kind{
+    ADD_CONST, ADD_VARIABLE, ADD_POP,
+    SUB_CONST, SUB_VARIABLE, SUB_POP,
+    MUL_CONST, MUL_VARIABLE, MUL_POP,
+    DIV_CONST, DIV_VARIABLE, DIV_POP,
+    EQUAL_CONST, EQUAL_VARIABLE, EQUAL_POP,
+    NOT_EQUAL_CONST, NOT_EQUAL_VARIABLE, NOT_EQUAL_POP,
+    LESS_CONST, LESS_VARIABLE, LESS_POP,
+    LESS_EQUAL_CONST, LESS_EQUAL_VARIABLE, LESS_EQUAL_POP,
+    GREATER_CONST, GREATER_VARIABLE, GREATER_POP,
+    GREATER_EQUAL_CONST, GREATER_EQUAL_VARIABLE, GREATER_EQUAL_POP,
+    COMPARE_CONST, COMPARE_VARIABLE, COMPARE_POP,
+    TEST,
+    LOAD_CONST, LOAD_VARIABLE, PUSH, STORE,
+    INCREMENT_CONST, INCREMENT,
+    PRINT,
+    PROLOGUE, PRECOMPUTED_OUTPUT, EPILOGUE,
+    COUNT
+};
+
+//the baseline backend: the machine code of every kind of node is a stencil encoded once from its assembly,
+//the program is the copies of the stencils with their holes patched, so there's no text, no register allocation
+//and no assembly pass between the statements and the object
+//the value of an expression is in rax, the left value of an operation waits on the stack while its right one is computed,
+//every variable is in the data section, so nothing is kept in the registers between the statements
+//a block variable shares its place with the variables of the same name in the other blocks, it can't be seen
+//where one of them is declared and every one is written by its declaration
+//the only code that isn't a stencil are the jumps: jmp and jcc with a 32-bit offset patched when the target is known
+class baseline_generator{
+private:
+    //a field of a stencil the linker fills
+    struct stencil_relocation{
+        uint32_t offset;
+        relocation_type type;
+        //the index in _runtime_symbols, -1 for the address of the variable of the node
+        int runtime_symbol;
+        int64_t addend;
+    };
+    struct stencil{
+        std::vector<uint8_t> bytes;
+        //the offset of the 32-bit immediate of the node, -1 if the stencil has none
+        int value_hole = -1;
+        std::vector<stencil_relocation> relocations;
+    };
+    //the symbols the stencils refer to by their names
+    static constexpr std::array<const char*, 6> _runtime_symbol_names = {
+        "printf", "fflush", "fwrite", "stdout", "d_fmt", "_PRECOMPUTED_OUTPUT"
+    };
+    //the immediate of a stencil the number of the node replaces
+    static constexpr uint32_t _value_marker = 0xA5A5A5A5;
+    static const char* _stencil_code;
+
+    //the stencils are encoded by the first generator and shared by all of them
+    static const std::array<stencil, static_cast<size_t>(stencil_kind::COUNT)>& get_stencils();
+
+    std::unique_ptr<elf_object> _object;
+    int _text = -1;
+    int _data = -1;
+    std::array<int, _runtime_symbol_names.size()> _runtime_symbols{};
+    //the symbol of every identifier code, -1 for an identifier without a variable yet
+    std::vector<int> _variable_symbols;
+    int _nodes_count = 0;
+private:
+    //copy the stencil to the end of the code, patch its immediate and add its relocations
+    void emit(stencil_kind kind, int32_t value = 0, int variable = -1);
+    //return the offset of the field of the target, the condition is -1 for jmp
+    int emit_jump(int condition);
+    void patch_jump(int field, int target);
+    int get_variable(int id_code);
+    int get_code_size() const;
+
+    //the stencil of the kind for a constant on the right, the next one for a variable or the one after it
+    //for a value computed after the left one is pushed
+    void compile_operand(stencil_kind kind, const expression* right);
+    void compile_expression(const expression* expr);
+    //compile the condition and a jump taken when it is the given value, return the field of the jump
+    int compile_condition(const expression* cond, bool is_taken);
+    void compile_statements(const statement* stat);
+    void compile_statement(const statement* stat);
+public:
+    baseline_generator();
+    ~baseline_generator();
+
+    //throw std::runtime_error for a node without a stencil
+    elf_object generate(const std::shared_ptr<statement>& root, const std::string& precomputed_output);
+    //the nodes of the last program
+    inline int get_nodes_count() const noexcept{ return _nodes_count; }
+};
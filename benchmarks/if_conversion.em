@@ -0,0 +1,17 @@
+let seed = 12345;
+let positive = 0;
+let negative = 0;
+let min = 0;
+for => (let i = 0 to 20000000){
+    seed = seed * 1103515245 + 12345;
+    if => (seed < 0){
+        negative = negative + 1;
+    }else{
+        positive = positive + 1;
+    }
+    if => (seed < min){
+        min = seed;
+    }
+}
+print(positive);
+print(negative);
@@ -0,0 +1,12 @@
+let a = 7;
+let b = 3;
+let sum = 0;
+let product = 1;
+for => (let i = 1 to 20000000){
+    sum = sum + a * i / 3 + b * i / 5;
+    product = product * 3 + i * b - a * 5;
+    a = i / 7 + b * 2;
+}
+print(sum);
+print(product);
+print(a);
@@ -0,0 +1,14 @@
+let mode = 3;
+let scale = 2;
+let sum = 0;
+for => (let i = 0 to 50000000){
+    if => (mode == 1){
+        sum = sum + i;
+    }else{
+        sum = sum - i;
+    }
+    if => (scale > mode){
+        sum = sum * scale;
+    }
+}
+print(sum);
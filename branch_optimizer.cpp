@@ -0,0 +1,656 @@
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include "branch_optimizer.h"
+#include "pass_manager.h"
+#include "asm_program.h"
+#include "remarks.h"
+
+namespace{
+
+constexpr int64_t min_value = std::numeric_limits<int64_t>::min();
+constexpr int64_t max_value = std::numeric_limits<int64_t>::max();
+
+}
+
+branch_optimizer::branch_optimizer(remark_emitter* remarks) : _remarks(remarks){}
+
+branch_optimizer::predicate branch_optimizer::negate(const predicate& pred){
+    static const std::unordered_map<std::string, std::string> negated = {
+        {"e", "ne"}, {"ne", "e"}, {"l", "ge"}, {"ge", "l"}, {"g", "le"}, {"le", "g"}
+    };
+    return predicate{pred.variable, negated.at(pred.condition), pred.value};
+}
+
+std::optional<bool> branch_optimizer::decide(const predicate& pred, const facts& known){
+    auto it = known.find(pred.variable);
+    if(it == known.end())
+        return std::nullopt;
+    const auto& range = it->second;
+    if(pred.condition == "ne"){
+        auto result = decide(negate(pred), known);
+        return result ? std::optional<bool>(!*result) : std::nullopt;
+    }
+
+    //the values for which the predicate is true, an empty range if min > max
+    value_range true_range{min_value, max_value};
+    if(pred.condition == "e"){
+        true_range = {pred.value, pred.value};
+    }else if(pred.condition == "l"){
+        true_range = pred.value == min_value ? value_range{max_value, min_value} : value_range{min_value, pred.value - 1};
+    }else if(pred.condition == "le"){
+        true_range.max = pred.value;
+    }else if(pred.condition == "g"){
+        true_range = pred.value == max_value ? value_range{max_value, min_value} : value_range{pred.value + 1, max_value};
+    }else if(pred.condition == "ge"){
+        true_range.min = pred.value;
+    }else{
+        return std::nullopt;
+    }
+
+    if(true_range.min <= range.min && range.max <= true_range.max)
+        return true;
+    if(range.max < true_range.min || true_range.max < range.min)
+        return false;
+    return std::nullopt;
+}
+
+bool branch_optimizer::add_fact(facts& known, const predicate& pred){
+    auto it = known.find(pred.variable);
+    if(pred.condition == "ne"){
+        //only the ends of a range can be excluded
+        if(it != known.end()){
+            auto& range = it->second;
+            if(range.min == pred.value && range.max == pred.value)
+                return false;
+            if(range.min == pred.value)
+                range.min++;
+            else if(range.max == pred.value)
+                range.max--;
+        }
+        return true;
+    }
+
+    value_range range = it == known.end() ? value_range{min_value, max_value} : it->second;
+    if(pred.condition == "e"){
+        range.min = std::max(range.min, pred.value);
+        range.max = std::min(range.max, pred.value);
+    }else if(pred.condition == "l" || pred.condition == "le"){
+        if(pred.condition == "l" && pred.value == min_value)
+            return false;
+        range.max = std::min(range.max, pred.condition == "l" ? pred.value - 1 : pred.value);
+    }else{
+        if(pred.condition == "g" && pred.value == max_value)
+            return false;
+        range.min = std::max(range.min, pred.condition == "g" ? pred.value + 1 : pred.value);
+    }
+    if(range.min > range.max)
+        return false;
+    known[pred.variable] = range;
+    return true;
+}
+
+branch_optimizer::block_info branch_optimizer::analyze_block(const asm_program& program, const basic_block& block){
+    //what a register holds, computed from the instructions of the block only
+    struct symbolic_value{
+        enum class value_kind{ UNKNOWN, CONSTANT, VARIABLE, CONDITION, LOW_BYTE } kind = value_kind::UNKNOWN;
+        int64_t value = 0;
+        std::string variable;
+        predicate cond;
+        //a low byte written by setcc holds either a constant or a condition
+        bool is_constant_byte = false;
+        bool is_loaded_at_entry = false;
+    };
+    using value_kind = symbolic_value::value_kind;
+    enum class flags_kind{ UNKNOWN, COMPARE, TEST };
+
+    block_info info;
+    const auto& lines = program.get_lines();
+    std::unordered_map<std::string, symbolic_value> registers;
+    std::unordered_set<std::string> stored;
+    flags_kind flags = flags_kind::UNKNOWN;
+    symbolic_value flags_left, flags_right;
+    bool is_pure = true;
+
+    auto get_value = [&registers](const std::string& operand){
+        if(asm_program::is_immediate(operand)){
+            symbolic_value val;
+            val.kind = value_kind::CONSTANT;
+            val.value = std::stoll(operand);
+            return val;
+        }
+        auto it = registers.find(operand);
+        return it == registers.end() ? symbolic_value{} : it->second;
+    };
+    auto store = [&](const std::string& variable){
+        stored.insert(variable);
+        info.stored_variables.push_back(variable);
+        for(auto& [reg, val] : registers){
+            if((val.kind == value_kind::VARIABLE && val.variable == variable) ||
+             ((val.kind == value_kind::CONDITION || val.kind == value_kind::LOW_BYTE) && !val.is_constant_byte && val.cond.variable == variable)){
+                val = symbolic_value{};
+            }
+        }
+        if(flags_left.variable == variable || flags_right.variable == variable || flags_left.cond.variable == variable){
+            flags = flags_kind::UNKNOWN;
+        }
+    };
+
+    int end = block.last_instruction == -1 ? block.begin : block.last_instruction + 1;
+    for(int i = block.begin; i < end; i++){
+        const auto& line = lines[i];
+        if(!line.is_instruction())
+            continue;
+        const auto& ops = line.operands;
+        if(line.is_conditional_jump() && i == block.last_instruction){
+            if(flags != flags_kind::TEST || (line.opcode != "jz" && line.opcode != "jnz"))
+                break;
+            info.branch.is_taken_if_true = line.opcode == "jnz";
+            if(flags_left.kind == value_kind::CONSTANT){
+                info.branch.constant_cond = flags_left.value != 0;
+            }else if(flags_left.kind == value_kind::CONDITION){
+                info.branch.cond = flags_left.cond;
+                info.branch.is_loaded_at_entry = flags_left.is_loaded_at_entry;
+                info.branch.is_loaded_at_exit = true;
+            }else if(flags_left.kind == value_kind::VARIABLE){
+                info.branch.cond = predicate{flags_left.variable, "ne", 0};
+                info.branch.is_loaded_at_entry = flags_left.is_loaded_at_entry;
+                info.branch.is_loaded_at_exit = true;
+            }
+            info.branch.is_pure_test = is_pure && info.branch.cond.has_value();
+            break;
+        }
+
+        if(line.opcode == "mov" && ops.size() == 2 && asm_program::is_register(ops[0])){
+            auto variable = asm_program::get_memory_symbol(ops[1]);
+            symbolic_value val;
+            if(!variable.empty()){
+                val.kind = value_kind::VARIABLE;
+                val.variable = variable;
+                val.is_loaded_at_entry = !stored.contains(variable);
+            }else if(asm_program::is_immediate(ops[1]) || asm_program::is_register(ops[1])){
+                val = get_value(ops[1]);
+            }else{
+                is_pure = false;
+            }
+            registers[ops[0]] = val;
+        }else if(line.opcode == "cmp" && ops.size() == 2){
+            flags = flags_kind::COMPARE;
+            flags_left = get_value(ops[0]);
+            flags_right = get_value(ops[1]);
+        }else if(line.opcode == "test" && ops.size() == 2 && ops[0] == ops[1]){
+            flags = flags_kind::TEST;
+            flags_left = get_value(ops[0]);
+            flags_right = symbolic_value{};
+        }else if(line.opcode.starts_with("set") && ops.size() == 1){
+            auto condition = line.opcode.substr(3);
+            symbolic_value val;
+            if(flags == flags_kind::COMPARE){
+                static const std::unordered_map<std::string, std::string> swapped = {
+                    {"e", "e"}, {"ne", "ne"}, {"l", "g"}, {"g", "l"}, {"le", "ge"}, {"ge", "le"}
+                };
+                const auto& left = flags_left;
+                const auto& right = flags_right;
+                auto it = swapped.find(condition);
+                if(it == swapped.end()){
+                }else if(left.kind == value_kind::CONSTANT && right.kind == value_kind::CONSTANT){
+                    predicate pred{"", condition, right.value};
+                    facts known{{"", value_range{left.value, left.value}}};
+                    val.kind = value_kind::LOW_BYTE;
+                    val.is_constant_byte = true;
+                    val.value = *decide(pred, known);
+                }else if(left.kind == value_kind::VARIABLE && right.kind == value_kind::CONSTANT){
+                    val.kind = value_kind::LOW_BYTE;
+                    val.cond = predicate{left.variable, condition, right.value};
+                    val.is_loaded_at_entry = left.is_loaded_at_entry;
+                }else if(left.kind == value_kind::CONSTANT && right.kind == value_kind::VARIABLE){
+                    val.kind = value_kind::LOW_BYTE;
+                    val.cond = predicate{right.variable, it->second, left.value};
+                    val.is_loaded_at_entry = right.is_loaded_at_entry;
+                }
+            }
+            //setcc writes the low byte of the register
+            registers[asm_program::get_full_register(ops[0])] = val;
+        }else if(line.opcode == "and" && ops.size() == 2 && ops[1] == "255"){
+            auto val = get_value(ops[0]);
+            if(val.kind == value_kind::LOW_BYTE){
+                val.kind = val.is_constant_byte ? value_kind::CONSTANT : value_kind::CONDITION;
+            }else{
+                val = symbolic_value{};
+            }
+            registers[ops[0]] = val;
+            flags = flags_kind::UNKNOWN;
+        }else{
+            is_pure = false;
+            flags = flags_kind::UNKNOWN;
+            if(line.opcode == "call" || line.opcode == "syscall" || line.opcode == "cqo" || line.opcode == "idiv"){
+                registers.clear();
+            }else if(!ops.empty() && asm_program::is_register(ops[0])){
+                registers[ops[0]] = symbolic_value{};
+            }
+        }
+        if(!ops.empty() && asm_program::is_memory_operand(ops[0]) && line.opcode != "cmp" && line.opcode != "test"){
+            is_pure = false;
+            auto variable = asm_program::get_memory_symbol(ops[0]);
+            if(!variable.empty()){
+                store(variable);
+            }
+        }
+    }
+    return info;
+}
+
+std::optional<branch_optimizer::facts> branch_optimizer::get_edge_facts(const std::optional<facts>& block_facts,
+ const block_info& info, bool is_taken){
+    if(!block_facts)
+        return std::nullopt;
+    facts known = *block_facts;
+    for(const auto& variable : info.stored_variables){
+        known.erase(variable);
+    }
+    const auto& branch = info.branch;
+    bool is_true_edge = is_taken == branch.is_taken_if_true;
+    if(branch.constant_cond && *branch.constant_cond != is_true_edge)
+        return std::nullopt;
+    if(branch.cond && branch.is_loaded_at_exit){
+        if(!add_fact(known, is_true_edge ? *branch.cond : negate(*branch.cond)))
+            return std::nullopt;
+    }
+    return known;
+}
+
+int branch_optimizer::thread_jumps(asm_program& program) const{
+    int threaded_count = 0;
+    for(int round = 0; round < _max_rounds; round++){
+        auto& lines = program.get_lines();
+        auto blocks = program.build_cfg();
+        int blocks_count = blocks.size();
+        std::vector<block_info> infos;
+        for(const auto& block : blocks){
+            infos.push_back(analyze_block(program, block));
+        }
+
+        //the facts known at the entry of every block, nullopt for the blocks not reached yet
+        std::vector<std::optional<facts>> entry_facts(blocks_count);
+        if(blocks_count > 0){
+            entry_facts[0] = facts{};
+        }
+        auto get_facts_on_edge = [&](int from, int to, bool is_taken) -> std::optional<facts>{
+            if((is_taken ? blocks[from].taken : blocks[from].fallthrough) != to)
+                return std::nullopt;
+            return get_edge_facts(entry_facts[from], infos[from], is_taken);
+        };
+        bool is_changed = true;
+        for(int iteration = 0; is_changed && iteration < blocks_count + _max_rounds; iteration++){
+            is_changed = false;
+            for(int i = 1; i < blocks_count; i++){
+                std::optional<facts> meet;
+                for(int pred : blocks[i].predecessors){
+                    for(bool is_taken : {true, false}){
+                        auto edge = get_facts_on_edge(pred, i, is_taken);
+                        if(!edge)
+                            continue;
+                        if(!meet){
+                            meet = edge;
+                            continue;
+                        }
+                        facts merged;
+                        for(const auto& [variable, range] : *meet){
+                            auto it = edge->find(variable);
+                            if(it != edge->end()){
+                                merged[variable] = value_range{std::min(range.min, it->second.min), std::max(range.max, it->second.max)};
+                            }
+                        }
+                        meet = merged;
+                    }
+                }
+                auto equal = [](const std::optional<facts>& a, const std::optional<facts>& b){
+                    if(a.has_value() != b.has_value())
+                        return false;
+                    if(!a)
+                        return true;
+                    return std::equal(a->begin(), a->end(), b->begin(), b->end(), [](const auto& x, const auto& y){
+                        return x.first == y.first && x.second.min == y.second.min && x.second.max == y.second.max;
+                    });
+                };
+                if(!equal(meet, entry_facts[i])){
+                    entry_facts[i] = meet;
+                    is_changed = true;
+                }
+            }
+        }
+
+        //the edits are collected from one graph and applied from the last line to the first one
+        enum class edit_kind{ SET_TARGET, MAKE_UNCONDITIONAL, REMOVE, INSERT_LABEL, INSERT_JUMP };
+        struct edit{
+            int line;
+            edit_kind kind;
+            std::string label;
+            //the source line of the test whose outcome is known
+            int test_line = 0;
+        };
+        std::vector<edit> edits;
+        std::unordered_map<int, std::string> block_labels;
+        auto get_block_label = [&](int block) -> std::string{
+            if(!blocks[block].labels.empty())
+                return blocks[block].labels.front();
+            auto it = block_labels.find(block);
+            if(it != block_labels.end())
+                return it->second;
+            auto label = program.make_label("_THREAD_TARGET");
+            edits.push_back(edit{blocks[block].begin, edit_kind::INSERT_LABEL, label});
+            return block_labels[block] = label;
+        };
+
+        std::vector<bool> is_decided(blocks_count, false);
+        for(int i = 0; i < blocks_count; i++){
+            const auto& branch = infos[i].branch;
+            std::optional<bool> outcome = branch.constant_cond;
+            if(!outcome && branch.cond && branch.is_loaded_at_entry && entry_facts[i]){
+                outcome = decide(*branch.cond, *entry_facts[i]);
+            }
+            if(!outcome)
+                continue;
+            is_decided[i] = true;
+            bool is_taken = *outcome == branch.is_taken_if_true;
+            edits.push_back(edit{blocks[i].last_instruction, is_taken ? edit_kind::MAKE_UNCONDITIONAL : edit_kind::REMOVE, "",
+             lines[blocks[i].last_instruction].source_line});
+        }
+
+        for(int i = 0; i < blocks_count; i++){
+            const auto& branch = infos[i].branch;
+            if(!branch.is_pure_test || is_decided[i])
+                continue;
+            for(int pred : blocks[i].predecessors){
+                if(is_decided[pred])
+                    continue;
+                for(bool is_taken : {true, false}){
+                    auto edge = get_facts_on_edge(pred, i, is_taken);
+                    if(!edge)
+                        continue;
+                    auto outcome = decide(*branch.cond, *edge);
+                    if(!outcome)
+                        continue;
+                    bool is_target_taken = *outcome == branch.is_taken_if_true;
+                    int target = is_target_taken ? blocks[i].taken : blocks[i].fallthrough;
+                    if(target == -1 || target == i)
+                        continue;
+                    auto label = is_target_taken ? lines[blocks[i].last_instruction].operands[0] : get_block_label(target);
+                    int test_line = lines[blocks[i].last_instruction].source_line;
+                    if(is_taken){
+                        edits.push_back(edit{blocks[pred].last_instruction, edit_kind::SET_TARGET, label, test_line});
+                    }else{
+                        edits.push_back(edit{blocks[pred].end, edit_kind::INSERT_JUMP, label, test_line});
+                    }
+                }
+            }
+        }
+        if(edits.empty())
+            break;
+
+        //at the same line the line is changed first, then a new label is put before it
+        //and a new jump, which ends the previous block, before the label
+        std::stable_sort(edits.begin(), edits.end(), [](const edit& a, const edit& b){
+            return a.line != b.line ? a.line > b.line : a.kind < b.kind;
+        });
+        auto report = [&](int line, const std::string& message){
+            if(_remarks)
+                _remarks->emit(remark_kind::APPLIED, "jump-threading", line, message);
+        };
+        auto skipped_test = [](const edit& change){
+            return "the jump skips the test at line " + std::to_string(change.test_line) + ", its outcome is known";
+        };
+        for(const auto& change : edits){
+            switch (change.kind){
+                case edit_kind::INSERT_LABEL:
+                    lines.insert(lines.begin() + change.line, asm_line::label(change.label));
+                    break;
+                case edit_kind::INSERT_JUMP:{
+                    //the jump ends the previous block and belongs to its statement
+                    auto jump = asm_line::instruction("jmp", {change.label});
+                    jump.source_line = change.line > 0 ? lines[change.line - 1].source_line : 0;
+                    lines.insert(lines.begin() + change.line, jump);
+                    report(jump.source_line, skipped_test(change));
+                    threaded_count++;
+                    break;
+                }
+                case edit_kind::SET_TARGET:
+                    lines[change.line].operands[0] = change.label;
+                    report(lines[change.line].source_line, skipped_test(change));
+                    threaded_count++;
+                    break;
+                case edit_kind::MAKE_UNCONDITIONAL:
+                    lines[change.line].opcode = "jmp";
+                    report(change.test_line, "the condition is always true, the branch is always taken");
+                    threaded_count++;
+                    break;
+                case edit_kind::REMOVE:
+                    lines.erase(lines.begin() + change.line);
+                    report(change.test_line, "the condition is always false, the branch is removed");
+                    threaded_count++;
+                    break;
+            }
+        }
+    }
+    return threaded_count;
+}
+
+int branch_optimizer::fold_branches(asm_program& program) const{
+    int folded_count = 0;
+    for(int round = 0; round < _max_rounds; round++){
+        auto& lines = program.get_lines();
+        int text_end = program.get_text_end();
+        int changes_count = 0;
+
+        auto next_instruction = [&](int line){
+            for(int i = line + 1; i < text_end; i++){
+                if(lines[i].is_instruction())
+                    return i;
+            }
+            return text_end;
+        };
+        //the labels between a line and the next instruction
+        auto has_label_after = [&](int line, const std::string& label){
+            for(int i = line + 1; i < text_end && !lines[i].is_instruction(); i++){
+                if(lines[i].is_label() && lines[i].text == label)
+                    return true;
+            }
+            return false;
+        };
+
+        //a jump to an unconditional jump goes to its target directly
+        auto label_lines = program.get_label_lines();
+        for(int i = 0; i < text_end; i++){
+            if(!lines[i].is_jump())
+                continue;
+            auto it = label_lines.find(lines[i].operands[0]);
+            if(it == label_lines.end())
+                continue;
+            int target = next_instruction(it->second);
+            if(target != text_end && target != i && lines[target].is_unconditional_jump() &&
+             lines[target].operands[0] != lines[i].operands[0]){
+                lines[i].operands[0] = lines[target].operands[0];
+                changes_count++;
+            }
+        }
+
+        //jumps to the next instruction and conditional jumps over an unconditional one
+        std::vector<bool> is_removed(lines.size(), false);
+        for(int i = 0; i < text_end; i++){
+            if(!lines[i].is_jump() || is_removed[i])
+                continue;
+            if(has_label_after(i, lines[i].operands[0])){
+                is_removed[i] = true;
+                changes_count++;
+                continue;
+            }
+            int next = next_instruction(i);
+            auto inverted = asm_program::invert_jump(lines[i].opcode);
+            if(lines[i].is_conditional_jump() && next != text_end && lines[next].is_unconditional_jump() &&
+             has_label_after(next, lines[i].operands[0]) && !inverted.empty()){
+                lines[i].opcode = inverted;
+                lines[i].operands[0] = lines[next].operands[0];
+                is_removed[next] = true;
+                changes_count++;
+                if(_remarks)
+                    _remarks->emit(remark_kind::APPLIED, "branch-folding", lines[i].source_line,
+                     "the branch is inverted, the jump over the other arm is removed");
+            }
+        }
+
+        //an empty block gets the name of the next one
+        std::unordered_map<std::string, std::string> merged_labels;
+        for(int i = 0; i < text_end; i++){
+            if(!lines[i].is_label() || !lines[i].text.starts_with("_"))
+                continue;
+            for(int j = i + 1; j < text_end && !lines[j].is_instruction(); j++){
+                if(lines[j].is_label()){
+                    merged_labels[lines[i].text] = lines[j].text;
+                    break;
+                }
+            }
+        }
+        std::unordered_set<std::string> referenced_labels;
+        for(int i = 0; i < text_end; i++){
+            if(!lines[i].is_instruction() || is_removed[i])
+                continue;
+            for(auto& operand : lines[i].operands){
+                auto it = merged_labels.find(operand);
+                while(it != merged_labels.end()){
+                    operand = it->second;
+                    it = merged_labels.find(operand);
+                    changes_count++;
+                }
+                referenced_labels.insert(operand);
+            }
+        }
+
+        //labels without jumps to them and the code no jump reaches
+        bool is_reachable = true;
+        for(int i = 0; i < text_end; i++){
+            if(lines[i].is_label()){
+                if(lines[i].text.starts_with("_") && !referenced_labels.contains(lines[i].text)){
+                    is_removed[i] = true;
+                    changes_count++;
+                }else{
+                    is_reachable = true;
+                }
+            }else if(lines[i].is_instruction() && !is_removed[i]){
+                if(!is_reachable){
+                    is_removed[i] = true;
+                    changes_count++;
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "branch-folding", lines[i].source_line, "the unreachable code is removed");
+                }else if(lines[i].is_unconditional_jump() || lines[i].opcode == "ret"){
+                    is_reachable = false;
+                }
+            }
+        }
+
+        for(int i = text_end - 1; i >= 0; i--){
+            if(is_removed[i]){
+                lines.erase(lines.begin() + i);
+            }
+        }
+        folded_count += changes_count;
+        if(changes_count == 0)
+            break;
+    }
+    return folded_count;
+}
+
+int branch_optimizer::merge_tails(asm_program& program) const{
+    int merged_count = 0;
+    auto& lines = program.get_lines();
+    //every merge removes instructions, so the merging ends
+    bool is_changed = true;
+    while(is_changed){
+        is_changed = false;
+        auto blocks = program.build_cfg();
+        //the instructions of a block without its unconditional jump
+        auto get_body = [&](const basic_block& block){
+            std::vector<int> body;
+            for(int i = block.begin; i < block.end; i++){
+                if(lines[i].is_instruction())
+                    body.push_back(i);
+            }
+            if(!body.empty() && lines[body.back()].is_unconditional_jump())
+                body.pop_back();
+            return body;
+        };
+        for(int target = 0; target < static_cast<int>(blocks.size()) && !is_changed; target++){
+            //the predecessors which always go to the target: by a jump or by falling through
+            std::vector<int> sources;
+            for(int pred : blocks[target].predecessors){
+                const auto& block = blocks[pred];
+                bool is_jump = block.last_instruction != -1 && lines[block.last_instruction].is_unconditional_jump();
+                bool is_fallthrough = block.taken == -1 && block.fallthrough == target &&
+                 (block.last_instruction == -1 || !lines[block.last_instruction].is_jump());
+                if(is_jump || is_fallthrough)
+                    sources.push_back(pred);
+            }
+            for(int from : sources){
+                if(!lines[blocks[from].last_instruction].is_unconditional_jump())
+                    continue;
+                auto from_body = get_body(blocks[from]);
+                for(int to : sources){
+                    if(to == from)
+                        continue;
+                    auto to_body = get_body(blocks[to]);
+                    size_t length = 0;
+                    while(length < from_body.size() && length < to_body.size()){
+                        const auto& left = lines[from_body[from_body.size() - 1 - length]];
+                        const auto& right = lines[to_body[to_body.size() - 1 - length]];
+                        if(left.opcode != right.opcode || left.operands != right.operands)
+                            break;
+                        length++;
+                    }
+                    if(length == 0)
+                        continue;
+                    //the jump goes to the same instructions at the end of the other block
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "tail-merging", lines[from_body[from_body.size() - length]].source_line,
+                         std::to_string(length) + " instructions are shared with the same code of line " +
+                         std::to_string(lines[to_body[to_body.size() - length]].source_line));
+                    auto label = program.make_label("_TAIL");
+                    lines[blocks[from].last_instruction].operands[0] = label;
+                    int tail_begin = to_body[to_body.size() - length];
+                    std::vector<int> removed(from_body.end() - length, from_body.end());
+                    int inserted = tail_begin;
+                    for(int k = removed.size() - 1; k >= 0; k--){
+                        if(inserted > removed[k]){
+                            lines.insert(lines.begin() + inserted, asm_line::label(label));
+                            inserted = -1;
+                        }
+                        lines.erase(lines.begin() + removed[k]);
+                    }
+                    if(inserted != -1)
+                        lines.insert(lines.begin() + inserted, asm_line::label(label));
+                    merged_count += length;
+                    is_changed = true;
+                    break;
+                }
+                if(is_changed)
+                    break;
+            }
+        }
+    }
+    return merged_count;
+}
+
+static pass_registration threading_registration({"jump-threading", pass_stage::ASSEMBLY, 20, "12s", "jumps threaded",
+ [](pass_context& context){
+    return branch_optimizer(context.remarks).thread_jumps(*context.program);
+}});
+
+static pass_registration folding_registration({"branch-folding", pass_stage::ASSEMBLY, 30, "12s", "jumps and labels folded",
+ [](pass_context& context){
+    return branch_optimizer(context.remarks).fold_branches(*context.program);
+}});
+
+//the merged tails read the registers computed before the jumps to them, so it runs after the passes analyzing blocks
+static pass_registration merging_registration({"tail-merging", pass_stage::ASSEMBLY, 50, "s", "instructions merged",
+ [](pass_context& context){
+    return branch_optimizer(context.remarks).merge_tails(*context.program);
+}});
@@ -0,0 +1,66 @@
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+class asm_program;
+class remark_emitter;
+struct basic_block;
+
+//jump threading, branch folding and tail merging on the control flow graph of the generated assembly
+class branch_optimizer{
+private:
+    static constexpr int _max_rounds = 16;
+    remark_emitter* _remarks;
+
+    //variable OP constant, the operations are the condition codes of setcc: e, ne, l, le, g, ge
+    struct predicate{
+        std::string variable;
+        std::string condition;
+        int64_t value;
+    };
+    //the values a variable can have
+    struct value_range{
+        int64_t min;
+        int64_t max;
+    };
+    using facts = std::map<std::string, value_range>;
+
+    //what decides the conditional jump at the end of a block
+    struct branch_info{
+        //the jump is taken if the predicate is true, or if it is false for jz
+        std::optional<predicate> cond;
+        std::optional<bool> constant_cond;
+        bool is_taken_if_true = true;
+        //the variable isn't stored between the block entry and its load, or after its load
+        bool is_loaded_at_entry = false;
+        bool is_loaded_at_exit = false;
+        //the block only computes the condition
+        bool is_pure_test = false;
+    };
+    struct block_info{
+        branch_info branch;
+        std::vector<std::string> stored_variables;
+    };
+
+    static predicate negate(const predicate& pred);
+    static std::optional<bool> decide(const predicate& pred, const facts& known);
+    //return false if the facts contradict each other, so the edge is never taken
+    static bool add_fact(facts& known, const predicate& pred);
+    static block_info analyze_block(const asm_program& program, const basic_block& block);
+    static std::optional<facts> get_edge_facts(const std::optional<facts>& block_facts, const block_info& info, bool is_taken);
+public:
+    branch_optimizer(remark_emitter* remarks = nullptr);
+
+    //redirect the jumps whose outcome is known from the earlier branches,
+    //return the number of redirected and removed jumps
+    int thread_jumps(asm_program& program) const;
+    //remove jumps to the next instruction, invert a conditional jump over an unconditional one,
+    //shortcut jumps to jumps, merge adjacent labels and remove unreachable code,
+    //return the number of changes
+    int fold_branches(asm_program& program) const;
+    //the same instructions before the jumps to a block are kept once: a jump goes to the copy at the end
+    //of another predecessor, return the number of removed instructions
+    int merge_tails(asm_program& program) const;
+};
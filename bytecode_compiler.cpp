@@ -0,0 +1,294 @@
+#include <climits>
+#include <stdexcept>
+#include <unordered_set>
+#include "bytecode_compiler.h"
+#include "ast.h"
+
+namespace{
+
+//the value instruction of a binary operation
+opcode get_operation(ast_node_type type){
+    switch (type){
+        case ast_node_type::ADD: return opcode::ADD;
+        case ast_node_type::SUB: return opcode::SUB;
+        case ast_node_type::MUL: return opcode::MUL;
+        case ast_node_type::DIV: return opcode::DIV;
+        case ast_node_type::EQUAL: return opcode::EQUAL;
+        case ast_node_type::NEQUAl: return opcode::NOT_EQUAL;
+        case ast_node_type::LESS: return opcode::LESS;
+        case ast_node_type::LESS_EQ: return opcode::LESS_EQUAL;
+        case ast_node_type::GREATER: return opcode::GREATER;
+        case ast_node_type::GREATER_EQ: return opcode::GREATER_EQUAL;
+        default:
+            throw std::runtime_error("undefined binary expression operator");
+    }
+}
+
+bool is_comparison(ast_node_type type){
+    return type == ast_node_type::EQUAL || type == ast_node_type::NEQUAl || type == ast_node_type::LESS ||
+     type == ast_node_type::LESS_EQ || type == ast_node_type::GREATER || type == ast_node_type::GREATER_EQ;
+}
+
+ast_node_type negate_comparison(ast_node_type type){
+    switch (type){
+        case ast_node_type::EQUAL: return ast_node_type::NEQUAl;
+        case ast_node_type::NEQUAl: return ast_node_type::EQUAL;
+        case ast_node_type::LESS: return ast_node_type::GREATER_EQ;
+        case ast_node_type::LESS_EQ: return ast_node_type::GREATER;
+        case ast_node_type::GREATER: return ast_node_type::LESS_EQ;
+        default: return ast_node_type::LESS;
+    }
+}
+
+//the comparison with the operands swapped: 3 < a is a > 3
+ast_node_type swap_comparison(ast_node_type type){
+    switch (type){
+        case ast_node_type::LESS: return ast_node_type::GREATER;
+        case ast_node_type::LESS_EQ: return ast_node_type::GREATER_EQ;
+        case ast_node_type::GREATER: return ast_node_type::LESS;
+        case ast_node_type::GREATER_EQ: return ast_node_type::LESS_EQ;
+        default: return type;
+    }
+}
+
+//the jumps are in the order of the value comparisons, the ones with a constant after them
+opcode get_jump(ast_node_type type, bool is_constant){
+    int offset = static_cast<int>(get_operation(type)) - static_cast<int>(opcode::EQUAL);
+    auto first = is_constant ? opcode::JUMP_EQUAL_CONST : opcode::JUMP_EQUAL;
+    return static_cast<opcode>(static_cast<int>(first) + offset);
+}
+
+bool is_number(const std::shared_ptr<expression>& expr){
+    return expr->get_type() == ast_node_type::NUM;
+}
+
+int get_number(const std::shared_ptr<expression>& expr){
+    return std::static_pointer_cast<number_expression>(expr)->get_number();
+}
+
+}
+
+bytecode_compiler::bytecode_compiler(bool is_counting_loops) : _is_counting_loops(is_counting_loops){}
+
+int bytecode_compiler::get_variable_register(int id_code) const{
+    for(auto scope = _scopes.rbegin(); scope != _scopes.rend(); scope++){
+        auto it = scope->find(id_code);
+        if(it != scope->end())
+            return it->second;
+    }
+    throw std::runtime_error("the variable has no register: " + std::to_string(id_code));
+}
+
+int bytecode_compiler::allocate_register(){
+    int reg = _next_register++;
+    _program.registers_count = std::max(_program.registers_count, _next_register);
+    return reg;
+}
+
+int bytecode_compiler::emit(opcode op, int a, int b, int c){
+    _program.code.push_back(bytecode_instruction{op, a, b, c});
+    return _program.code.size() - 1;
+}
+
+void bytecode_compiler::patch_jump(int jump){
+    _program.code[jump].c = _program.code.size();
+}
+
+void bytecode_compiler::count_loop(){
+    if(!_is_counting_loops)
+        return;
+    bytecode_loop loop;
+    loop.path = _path;
+    for(const auto& scope : _scopes){
+        for(const auto& [id_code, reg] : scope){
+            loop.variables[id_code] = reg;
+        }
+    }
+    emit(opcode::COUNT_LOOP, _program.loops.size());
+    _program.loops.push_back(std::move(loop));
+}
+
+int bytecode_compiler::compile_expression(const std::shared_ptr<expression>& expr, int destination){
+    if(expr->get_type() == ast_node_type::NUM){
+        int reg = destination != -1 ? destination : allocate_register();
+        emit(opcode::LOAD, reg, get_number(expr));
+        return reg;
+    }
+    if(expr->get_type() == ast_node_type::ID){
+        int reg = get_variable_register(std::static_pointer_cast<identifier_expression>(expr)->get_id());
+        if(destination == -1 || destination == reg)
+            return reg;
+        emit(opcode::MOVE, destination, reg);
+        return destination;
+    }
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    auto left = bin_expr->get_left();
+    auto right = bin_expr->get_right();
+    auto type = expr->get_type();
+    //the constant is on the right of a commutative operation
+    if(is_number(left) && !is_number(right) && (type == ast_node_type::ADD || type == ast_node_type::MUL))
+        std::swap(left, right);
+    if(is_number(right)){
+        int number = get_number(right);
+        opcode op = opcode::HALT;
+        if(type == ast_node_type::ADD){
+            op = opcode::ADD_CONST;
+        }else if(type == ast_node_type::SUB && number != INT_MIN){
+            op = opcode::ADD_CONST;
+            number = -number;
+        }else if(type == ast_node_type::MUL){
+            op = opcode::MUL_CONST;
+        }else if(type == ast_node_type::DIV && number != 0 && number != -1){
+            op = opcode::DIV_CONST;
+        }
+        if(op != opcode::HALT){
+            int left_reg = compile_expression(left);
+            int reg = destination != -1 ? destination : allocate_register();
+            emit(op, reg, left_reg, number);
+            return reg;
+        }
+    }
+    int left_reg = compile_expression(left);
+    int right_reg = compile_expression(right);
+    int reg = destination != -1 ? destination : allocate_register();
+    emit(get_operation(type), reg, left_reg, right_reg);
+    return reg;
+}
+
+int bytecode_compiler::compile_condition(const std::shared_ptr<expression>& cond, bool is_taken){
+    auto type = cond->get_type();
+    if(!is_comparison(type)){
+        int reg = compile_expression(cond);
+        return emit(is_taken ? opcode::JUMP_IF_NOT_ZERO : opcode::JUMP_IF_ZERO, reg);
+    }
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(cond);
+    auto left = bin_expr->get_left();
+    auto right = bin_expr->get_right();
+    if(!is_taken)
+        type = negate_comparison(type);
+    if(is_number(left) && !is_number(right)){
+        std::swap(left, right);
+        type = swap_comparison(type);
+    }
+    int left_reg = compile_expression(left);
+    if(is_number(right))
+        return emit(get_jump(type, true), left_reg, get_number(right));
+    return emit(get_jump(type, false), left_reg, compile_expression(right));
+}
+
+void bytecode_compiler::compile_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        compile_statement(node);
+    }
+}
+
+void bytecode_compiler::compile_statement(const std::shared_ptr<statement>& stat){
+    //the temporary values live only in their statement
+    _next_register = _variables_top;
+    _path.push_back(stat);
+    switch (stat->get_type()){
+        case ast_node_type::PRINT:
+            emit(opcode::PRINT, compile_expression(std::static_pointer_cast<print_statement>(stat)->get_expression()));
+            break;
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto& id_stat = std::static_pointer_cast<statement_with_id>(stat);
+            //an assignment can be only an identifier
+            if(!id_stat->get_expression())
+                break;
+            int id_code = id_stat->get_identifier_code();
+            if(stat->get_type() == ast_node_type::ASSIGN || _scopes.size() == 1){
+                compile_expression(id_stat->get_expression(), get_variable_register(id_code));
+                break;
+            }
+            //the expression still sees the variable of the outer block: let a = a + 1
+            int reg = _variables_top++;
+            _next_register = _variables_top;
+            _program.registers_count = std::max(_program.registers_count, _variables_top);
+            compile_expression(id_stat->get_expression(), reg);
+            _scopes.back()[id_code] = reg;
+            break;
+        }
+        case ast_node_type::COMPOUND:{
+            int variables_top = _variables_top;
+            _scopes.emplace_back();
+            compile_statements(std::static_pointer_cast<compound_statement>(stat)->get_inner_statement());
+            _scopes.pop_back();
+            _variables_top = variables_top;
+            break;
+        }
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(stat);
+            int to_else = compile_condition(if_stat->get_conditional_expression(), false);
+            compile_statement(if_stat->get_if_inner_statement());
+            if(if_stat->get_else_inner_statement()){
+                int to_end = emit(opcode::JUMP);
+                patch_jump(to_else);
+                compile_statement(if_stat->get_else_inner_statement());
+                patch_jump(to_end);
+            }else{
+                patch_jump(to_else);
+            }
+            break;
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(stat);
+            int to_condition = emit(opcode::JUMP);
+            int body = _program.code.size();
+            compile_statement(while_stat->get_inner_statement());
+            patch_jump(to_condition);
+            count_loop();
+            _next_register = _variables_top;
+            _program.code[compile_condition(while_stat->get_conditional_expression(), true)].c = body;
+            break;
+        }
+        case ast_node_type::FOR_LOOP:{
+            //the loop runs while the iterator isn't equal to the final value
+            const auto& for_stat = std::static_pointer_cast<for_statement>(stat);
+            compile_statement(for_stat->get_start_statement());
+            int iterator = get_variable_register(for_stat->get_start_statement()->get_identifier_code());
+            int to_condition = emit(opcode::JUMP);
+            int body = _program.code.size();
+            compile_statement(for_stat->get_inner_statement());
+            _next_register = _variables_top;
+            auto increment = for_stat->get_after_iter_expression();
+            if(is_number(increment)){
+                emit(opcode::ADD_CONST, iterator, iterator, get_number(increment));
+            }else{
+                emit(opcode::ADD, iterator, iterator, compile_expression(increment));
+            }
+            patch_jump(to_condition);
+            count_loop();
+            _next_register = _variables_top;
+            auto final_expr = for_stat->get_final_expression();
+            if(is_number(final_expr)){
+                emit(opcode::JUMP_NOT_EQUAL_CONST, iterator, get_number(final_expr), body);
+            }else{
+                emit(opcode::JUMP_NOT_EQUAL, iterator, compile_expression(final_expr), body);
+            }
+            break;
+        }
+        default:
+            throw std::runtime_error("undefined statement");
+    }
+    _path.pop_back();
+}
+
+bytecode_program bytecode_compiler::compile(const std::shared_ptr<statement>& root, const std::string& precomputed_output){
+    _program = bytecode_program();
+    _program.precomputed_output = precomputed_output;
+    //the global variables start with 0 like in the data section
+    std::unordered_set<int> read, written;
+    if(root)
+        collect_variables(root, read, written);
+    read.insert(written.begin(), written.end());
+    _scopes.assign(1, {});
+    for(int id_code : read){
+        _scopes.front()[id_code] = _variables_top++;
+    }
+    _next_register = _variables_top;
+    _program.registers_count = _variables_top;
+    compile_statements(root);
+    emit(opcode::HALT);
+    return std::move(_program);
+}
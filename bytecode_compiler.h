@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class statement;
+class expression;
+
+//the instructions of the register machine: every variable has its own register, so reading a variable
+//and writing it back aren't instructions, the operands a and b are registers or constants and c is a register
+//or the index of the instruction a jump goes to
+enum class opcode : uint8_t{
+    //r[a] = b
+    LOAD,
+    //r[a] = r[b]
+    MOVE,
+    //r[a] = r[b] op r[c], the comparisons give 1 or 0
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    EQUAL,
+    NOT_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    //r[a] = r[b] op c, the superinstructions of an operation with a constant: a = a + 1 is one instruction,
+    //a subtraction of a constant is an addition and the divisor is never 0 or -1, so the division doesn't check it
+    ADD_CONST,
+    MUL_CONST,
+    DIV_CONST,
+    //goto c
+    JUMP,
+    //if(r[a] == 0) goto c, if(r[a] != 0) goto c
+    JUMP_IF_ZERO,
+    JUMP_IF_NOT_ZERO,
+    //if(r[a] op r[b]) goto c, the superinstructions of a comparison and the branch on it
+    JUMP_EQUAL,
+    JUMP_NOT_EQUAL,
+    JUMP_LESS,
+    JUMP_LESS_EQUAL,
+    JUMP_GREATER,
+    JUMP_GREATER_EQUAL,
+    //if(r[a] op b) goto c
+    JUMP_EQUAL_CONST,
+    JUMP_NOT_EQUAL_CONST,
+    JUMP_LESS_CONST,
+    JUMP_LESS_EQUAL_CONST,
+    JUMP_GREATER_CONST,
+    JUMP_GREATER_EQUAL_CONST,
+    //printf("%d\n", r[a])
+    PRINT,
+    //count a run of the condition of loop a, the interpreter stops at a hot loop for the tiered execution
+    COUNT_LOOP,
+    HALT
+};
+
+struct bytecode_instruction{
+    opcode op;
+    int32_t a = 0;
+    int32_t b = 0;
+    int32_t c = 0;
+};
+
+//a loop the native code can continue from
+struct bytecode_loop{
+    //the statements from the top level to the loop, the parent of every statement is the one before it
+    std::vector<std::shared_ptr<statement>> path;
+    //the identifier codes and the registers of the variables seen at the condition of the loop
+    std::map<int, int> variables;
+};
+
+struct bytecode_program{
+    std::vector<bytecode_instruction> code;
+    //the loops the COUNT_LOOP instructions count
+    std::vector<bytecode_loop> loops;
+    int registers_count = 0;
+    //the output of the statements the partial evaluation has run, it's printed first
+    std::string precomputed_output;
+};
+
+//the bytecode of the statements for bytecode_vm: the global variables have the first registers,
+//the variables of a block and the temporary values of a statement are allocated like a stack above them,
+//the loops are rotated, so an iteration runs one compare-and-branch at the bottom and no jump back
+class bytecode_compiler{
+private:
+    bool _is_counting_loops;
+    bytecode_program _program;
+    //the registers of the variables by their identifier codes, the global ones in the first scope
+    std::vector<std::map<int, int>> _scopes;
+    //the first register after the variables of the open blocks
+    int _variables_top = 0;
+    //the first free register for a temporary value
+    int _next_register = 0;
+    //the statements around the compiled one
+    std::vector<std::shared_ptr<statement>> _path;
+private:
+    int get_variable_register(int id_code) const;
+    int allocate_register();
+    //return the index of the instruction
+    int emit(opcode op, int a = 0, int b = 0, int c = 0);
+    //point the jump at the next instruction
+    void patch_jump(int jump);
+    //a COUNT_LOOP at the condition of the loop at the end of the path
+    void count_loop();
+
+    //return the register of the value, the value is put to the destination register if it isn't -1
+    int compile_expression(const std::shared_ptr<expression>& expr, int destination = -1);
+    //emit a jump taken when the condition is is_taken, return its index to patch it
+    int compile_condition(const std::shared_ptr<expression>& cond, bool is_taken);
+    void compile_statements(const std::shared_ptr<statement>& stat);
+    void compile_statement(const std::shared_ptr<statement>& stat);
+public:
+    //count the loops for the tiered execution
+    bytecode_compiler(bool is_counting_loops = false);
+
+    //throw std::runtime_error for a statement the bytecode doesn't have
+    bytecode_program compile(const std::shared_ptr<statement>& root, const std::string& precomputed_output);
+};
@@ -0,0 +1,172 @@
+#include <charconv>
+#include <climits>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bytecode_vm.h"
+#include "bytecode_compiler.h"
+
+namespace{
+
+//an instruction with the address of its handler instead of the opcode
+struct threaded_instruction{
+    const void* handler;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+}
+
+bytecode_vm::bytecode_vm(int64_t hot_loop_threshold) : _hot_loop_threshold(hot_loop_threshold){}
+
+int bytecode_vm::run(const bytecode_program& program){
+    //in the order of opcode
+    static const void* const handlers[] = {
+        &&load, &&move,
+        &&add, &&sub, &&mul, &&div,
+        &&equal, &&not_equal, &&less, &&less_equal, &&greater, &&greater_equal,
+        &&add_const, &&mul_const, &&div_const,
+        &&jump, &&jump_if_zero, &&jump_if_not_zero,
+        &&jump_equal, &&jump_not_equal, &&jump_less, &&jump_less_equal, &&jump_greater, &&jump_greater_equal,
+        &&jump_equal_const, &&jump_not_equal_const, &&jump_less_const, &&jump_less_equal_const, &&jump_greater_const,
+        &&jump_greater_equal_const,
+        &&print, &&count_loop, &&halt
+    };
+    static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(opcode::HALT) + 1);
+
+    std::vector<threaded_instruction> code;
+    code.reserve(program.code.size());
+    for(const auto& instruction : program.code){
+        code.push_back(threaded_instruction{handlers[static_cast<size_t>(instruction.op)], instruction.a, instruction.b,
+         instruction.c});
+    }
+    _registers.assign(program.registers_count, 0);
+    int64_t* r = _registers.data();
+    std::vector<int64_t> loop_counts(program.loops.size(), 0);
+    const threaded_instruction* const begin = code.data();
+    const threaded_instruction* ip = begin;
+
+    std::string output = program.precomputed_output;
+    output.reserve(_buffer_size + 16);
+    auto flush = [&output](){
+        fwrite(output.data(), 1, output.size(), stdout);
+        output.clear();
+    };
+
+    //the registers wrap around like the unsigned numbers
+    #define BINARY(operation) r[ip->a] = static_cast<int64_t>(static_cast<uint64_t>(r[ip->b]) operation static_cast<uint64_t>(r[ip->c]))
+    #define NEXT() goto *(++ip)->handler
+    #define BRANCH(condition) ip = (condition) ? begin + ip->c : ip + 1; goto *ip->handler
+
+    goto *ip->handler;
+load:
+    r[ip->a] = ip->b;
+    NEXT();
+move:
+    r[ip->a] = r[ip->b];
+    NEXT();
+add:
+    BINARY(+);
+    NEXT();
+sub:
+    BINARY(-);
+    NEXT();
+mul:
+    BINARY(*);
+    NEXT();
+div:
+    if(r[ip->c] == 0 || (r[ip->b] == INT64_MIN && r[ip->c] == -1)){
+        flush();
+        fflush(stdout);
+        std::raise(SIGFPE);
+        return -1;
+    }
+    r[ip->a] = r[ip->b] / r[ip->c];
+    NEXT();
+equal:
+    r[ip->a] = r[ip->b] == r[ip->c];
+    NEXT();
+not_equal:
+    r[ip->a] = r[ip->b] != r[ip->c];
+    NEXT();
+less:
+    r[ip->a] = r[ip->b] < r[ip->c];
+    NEXT();
+less_equal:
+    r[ip->a] = r[ip->b] <= r[ip->c];
+    NEXT();
+greater:
+    r[ip->a] = r[ip->b] > r[ip->c];
+    NEXT();
+greater_equal:
+    r[ip->a] = r[ip->b] >= r[ip->c];
+    NEXT();
+add_const:
+    r[ip->a] = static_cast<int64_t>(static_cast<uint64_t>(r[ip->b]) + static_cast<uint64_t>(static_cast<int64_t>(ip->c)));
+    NEXT();
+mul_const:
+    r[ip->a] = static_cast<int64_t>(static_cast<uint64_t>(r[ip->b]) * static_cast<uint64_t>(static_cast<int64_t>(ip->c)));
+    NEXT();
+div_const:
+    r[ip->a] = r[ip->b] / ip->c;
+    NEXT();
+jump:
+    ip = begin + ip->c;
+    goto *ip->handler;
+jump_if_zero:
+    BRANCH(r[ip->a] == 0);
+jump_if_not_zero:
+    BRANCH(r[ip->a] != 0);
+jump_equal:
+    BRANCH(r[ip->a] == r[ip->b]);
+jump_not_equal:
+    BRANCH(r[ip->a] != r[ip->b]);
+jump_less:
+    BRANCH(r[ip->a] < r[ip->b]);
+jump_less_equal:
+    BRANCH(r[ip->a] <= r[ip->b]);
+jump_greater:
+    BRANCH(r[ip->a] > r[ip->b]);
+jump_greater_equal:
+    BRANCH(r[ip->a] >= r[ip->b]);
+jump_equal_const:
+    BRANCH(r[ip->a] == ip->b);
+jump_not_equal_const:
+    BRANCH(r[ip->a] != ip->b);
+jump_less_const:
+    BRANCH(r[ip->a] < ip->b);
+jump_less_equal_const:
+    BRANCH(r[ip->a] <= ip->b);
+jump_greater_const:
+    BRANCH(r[ip->a] > ip->b);
+jump_greater_equal_const:
+    BRANCH(r[ip->a] >= ip->b);
+print:{
+    //printf("%d") prints the low half of the register
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), static_cast<int32_t>(r[ip->a]));
+    output.append(digits, result.ptr);
+    output += '\n';
+    if(output.size() >= _buffer_size)
+        flush();
+    NEXT();
+}
+count_loop:
+    if(++loop_counts[ip->a] == _hot_loop_threshold){
+        flush();
+        fflush(stdout);
+        return ip->a;
+    }
+    NEXT();
+halt:
+    flush();
+    fflush(stdout);
+    return -1;
+
+    #undef BINARY
+    #undef NEXT
+    #undef BRANCH
+}
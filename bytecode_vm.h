@@ -0,0 +1,27 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct bytecode_program;
+
+//the interpreter of the bytecode: the instructions are translated to the addresses of their handlers before the run,
+//every handler jumps to the handler of the next instruction with a computed goto, so there's no loop and no switch
+//and every instruction has its own indirect branch for the predictor
+//the arithmetic is the 64-bit one of the generated code and print shows the low half like printf("%d")
+class bytecode_vm{
+private:
+    //the output is written when the buffer is full and at the end
+    static constexpr size_t _buffer_size = 1 << 16;
+    //the runs of the condition of a counted loop that make it hot, 0 never stops the program
+    int64_t _hot_loop_threshold;
+    std::vector<int64_t> _registers;
+public:
+    bytecode_vm(int64_t hot_loop_threshold = 0);
+
+    //run the program to its end and return -1, or stop at the condition of a hot loop and return the index of the loop,
+    //the output is written in both cases
+    //a division by zero or an overflowing division raises SIGFPE like the native code, after the output is written
+    int run(const bytecode_program& program);
+    //the values of the variables where the program has stopped
+    inline const std::vector<int64_t>& get_registers() const noexcept{ return _registers; }
+};
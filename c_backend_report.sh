@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# the run time of every benchmark compiled with the code generator at -O2 and with --backend=c,
+# where the C compiler optimizes the C file at -O2: the distance of the native code to the system optimizer
+# the partial evaluation is turned off, otherwise the benchmarks are run by the compiler
+cd build/
+cmake ..
+make
+
+echo ""
+TIMEFORMAT="%R"
+printf "%-28s %10s %10s\n" "benchmark" "native" "c"
+for bench in ../benchmarks/*.em
+    do
+    name="${bench#../benchmarks/}"
+    ./enma "${bench}" -o bench_native --eval-steps=0 > /dev/null
+    ./enma "${bench}" -o bench_c --eval-steps=0 --backend=c > /dev/null
+    if ! cmp -s <(./bench_native) <(./bench_c)
+        then
+            echo "${name}: the outputs of the backends differ"
+        fi
+    native=$( { time ./bench_native > /dev/null; } 2>&1 )
+    c=$( { time ./bench_c > /dev/null; } 2>&1 )
+    printf "%-28s %9ss %9ss\n" "${name}" "${native}" "${c}"
+    done
+    rm -f bench_native bench_native.o bench_c ../benchmarks/*.c
@@ -0,0 +1,173 @@
+#include <stdexcept>
+#include <unordered_set>
+#include <set>
+#include "c_generator.h"
+#include "lexer.h"
+#include "ast.h"
+
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
+
+//the operations go through unsigned numbers, so an overflow wraps around instead of being undefined,
+//the conversions back to the signed numbers are modular in GCC and Clang
+//the division raises the signal idiv would raise, the output printf hasn't written is lost like in the native code
+const char* c_generator::_runtime_code = R"(#include <inttypes.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static inline int64_t enma_add(int64_t a, int64_t b){ return (int64_t)((uint64_t)a + (uint64_t)b); }
+static inline int64_t enma_sub(int64_t a, int64_t b){ return (int64_t)((uint64_t)a - (uint64_t)b); }
+static inline int64_t enma_mul(int64_t a, int64_t b){ return (int64_t)((uint64_t)a * (uint64_t)b); }
+static inline int64_t enma_div(int64_t a, int64_t b){
+    if(b == 0 || (a == INT64_MIN && b == -1)){
+        raise(SIGFPE);
+        abort();
+    }
+    return a / b;
+}
+static inline void enma_print(int64_t a){ printf("%" PRId32 "\n", (int32_t)(uint32_t)(uint64_t)a); }
+
+)";
+
+std::string c_generator::get_name(int id_code){
+    return "v" + std::to_string(id_code) + "_" + global_sym_table->get_identifier(id_code);
+}
+
+void c_generator::output_line(const std::string& line){
+    _code << std::string(_indent * 4, ' ') << line << '\n';
+}
+
+std::string c_generator::compile_expression(const std::shared_ptr<expression>& expr){
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            return "INT64_C(" + std::to_string(std::static_pointer_cast<number_expression>(expr)->get_number()) + ")";
+        case ast_node_type::ID:
+            return get_name(std::static_pointer_cast<identifier_expression>(expr)->get_id());
+        default:
+            break;
+    }
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    auto left = compile_expression(bin_expr->get_left());
+    auto right = compile_expression(bin_expr->get_right());
+    switch (expr->get_type()){
+        case ast_node_type::ADD: return "enma_add(" + left + ", " + right + ")";
+        case ast_node_type::SUB: return "enma_sub(" + left + ", " + right + ")";
+        case ast_node_type::MUL: return "enma_mul(" + left + ", " + right + ")";
+        case ast_node_type::DIV: return "enma_div(" + left + ", " + right + ")";
+        //a comparison is an int of 0 or 1
+        case ast_node_type::EQUAL: return "(int64_t)(" + left + " == " + right + ")";
+        case ast_node_type::NEQUAl: return "(int64_t)(" + left + " != " + right + ")";
+        case ast_node_type::LESS: return "(int64_t)(" + left + " < " + right + ")";
+        case ast_node_type::LESS_EQ: return "(int64_t)(" + left + " <= " + right + ")";
+        case ast_node_type::GREATER: return "(int64_t)(" + left + " > " + right + ")";
+        case ast_node_type::GREATER_EQ: return "(int64_t)(" + left + " >= " + right + ")";
+        default:
+            throw std::runtime_error("undefined binary expression operator");
+    }
+}
+
+void c_generator::compile_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        compile_statement(node);
+    }
+}
+
+void c_generator::compile_block(const std::shared_ptr<statement>& inner){
+    _indent++;
+    _depth++;
+    _declared.emplace_back();
+    compile_statements(inner);
+    _declared.pop_back();
+    _depth--;
+    _indent--;
+}
+
+void c_generator::compile_statement(const std::shared_ptr<statement>& stat){
+    switch (stat->get_type()){
+        case ast_node_type::PRINT:
+            output_line("enma_print(" + compile_expression(std::static_pointer_cast<print_statement>(stat)->get_expression()) + ");");
+            break;
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto& id_stat = std::static_pointer_cast<statement_with_id>(stat);
+            //an assignment can be only an identifier
+            if(!id_stat->get_expression())
+                break;
+            //a declaration of the top level is an assignment of the static variable
+            bool is_local = stat->get_type() == ast_node_type::VAR_DECL && _depth > 0 &&
+             _declared.back().insert(id_stat->get_identifier_code()).second;
+            output_line(std::string(is_local ? "int64_t " : "") + get_name(id_stat->get_identifier_code()) + " = " +
+             compile_expression(id_stat->get_expression()) + ";");
+            break;
+        }
+        case ast_node_type::COMPOUND:
+            output_line("{");
+            compile_block(std::static_pointer_cast<compound_statement>(stat)->get_inner_statement());
+            output_line("}");
+            break;
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(stat);
+            output_line("if(" + compile_expression(if_stat->get_conditional_expression()) + "){");
+            compile_block(if_stat->get_if_inner_statement()->get_inner_statement());
+            if(if_stat->get_else_inner_statement()){
+                output_line("}else{");
+                compile_block(if_stat->get_else_inner_statement()->get_inner_statement());
+            }
+            output_line("}");
+            break;
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(stat);
+            output_line("while(" + compile_expression(while_stat->get_conditional_expression()) + "){");
+            compile_block(while_stat->get_inner_statement()->get_inner_statement());
+            output_line("}");
+            break;
+        }
+        case ast_node_type::FOR_LOOP:{
+            //the iterator is a variable of the block of the loop, the loop runs while it isn't equal to the final value
+            const auto& for_stat = std::static_pointer_cast<for_statement>(stat);
+            compile_statement(for_stat->get_start_statement());
+            auto iterator = get_name(for_stat->get_start_statement()->get_identifier_code());
+            output_line("while(" + iterator + " != " + compile_expression(for_stat->get_final_expression()) + "){");
+            compile_block(for_stat->get_inner_statement()->get_inner_statement());
+            _indent++;
+            output_line(iterator + " = enma_add(" + iterator + ", " + compile_expression(for_stat->get_after_iter_expression()) + ");");
+            _indent--;
+            output_line("}");
+            break;
+        }
+        default:
+            throw std::runtime_error("undefined statement");
+    }
+}
+
+std::string c_generator::generate(const std::shared_ptr<statement>& root, const std::string& precomputed_output){
+    _code.str("");
+    _indent = 0;
+    _depth = 0;
+    _declared.clear();
+    _code << _runtime_code;
+    std::unordered_set<int> read, written;
+    if(root)
+        collect_variables(root, read, written);
+    read.insert(written.begin(), written.end());
+    //in the order of the codes, so the same program gives the same file
+    for(int id_code : std::set<int>(read.begin(), read.end())){
+        _code << "static int64_t " << get_name(id_code) << ";\n";
+    }
+    _code << "\nint main(void){\n";
+    _indent = 1;
+    if(!precomputed_output.empty()){
+        //the output has only numbers and new lines
+        std::string literal;
+        for(char c : precomputed_output){
+            literal += c == '\n' ? "\\n" : std::string(1, c);
+        }
+        output_line("fwrite(\"" + literal + "\", 1, " + std::to_string(precomputed_output.size()) + ", stdout);");
+    }
+    compile_statements(root);
+    output_line("return 0;");
+    _code << "}\n";
+    return _code.str();
+}
@@ -0,0 +1,35 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class expression;
+class statement;
+
+//the C backend: the program is one translation unit a C compiler optimizes, the statements are the statements of main,
+//the blocks are the blocks of C and the variables of the top level are static variables of the file
+//the arithmetic is the one of the generated code: + - * wrap around in 64 bits, / truncates
+//and a division by zero or an overflowing division raises SIGFPE, print shows the low half like printf("%d")
+class c_generator{
+private:
+    static const char* _runtime_code;
+
+    std::ostringstream _code;
+    int _indent = 0;
+    //the blocks around the statement, a declaration in a block is a local variable of C
+    int _depth = 0;
+    //the locals declared in every open block, a second declaration in the same block (the copies of an unrolled body,
+    //the iterators of two loops) is an assignment, C doesn't allow the variable twice
+    std::vector<std::unordered_set<int>> _declared;
+private:
+    static std::string get_name(int id_code);
+    void output_line(const std::string& line);
+    std::string compile_expression(const std::shared_ptr<expression>& expr);
+    void compile_statements(const std::shared_ptr<statement>& stat);
+    void compile_block(const std::shared_ptr<statement>& inner);
+    void compile_statement(const std::shared_ptr<statement>& stat);
+public:
+    //throw std::runtime_error for a node the backend doesn't know
+    std::string generate(const std::shared_ptr<statement>& root, const std::string& precomputed_output);
+};
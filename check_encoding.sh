@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# the built-in encoder and nasm have to give the same bytes: every test and benchmark is compiled both ways
+# and the .text, the .data and the relocations of the two objects are compared,
+# also without the partial evaluation, which folds most programs to one constant output
+# the argument of ctest is the build directory, then nothing is built and the test is skipped without nasm
+if ! command -v nasm > /dev/null
+    then
+        echo "nasm isn't installed"
+        exit 77
+    fi
+source="$(cd "$(dirname "$0")" && pwd)"
+if [ $# -eq 0 ]
+    then
+        cd build/
+        cmake ..
+        make
+    fi
+enma="$(realpath "${1:-.}")/enma"
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+cd "${work}"
+
+echo ""
+failed=0
+for program in "${source}"/tests/*.em "${source}"/benchmarks/*.em
+    do
+    # the copy keeps the .asm files out of the sources
+    cp "${program}" .
+    name="${program##*/}"
+    for options in "-O2" "-Os" "-O2 --eval-steps=0" "-Os --eval-steps=0"
+        do
+        "${enma}" "${name}" -o encoder_output ${options} > /dev/null
+        "${enma}" "${name}" -o nasm_output ${options} --emit=asm > /dev/null
+        result="same"
+        for section in .text .data
+            do
+            objcopy -O binary --only-section="${section}" encoder_output.o encoder_section
+            objcopy -O binary --only-section="${section}" nasm_output.o nasm_section
+            if ! cmp -s encoder_section nasm_section
+                then
+                    result="different ${section}"
+                fi
+            done
+        # the offset, the type, the symbol and the addend of every relocation
+        readelf -rW encoder_output.o | awk '$1 ~ /^[0-9a-f]+$/ {print $1, $3, $5, $6, $7}' > encoder_relocations
+        readelf -rW nasm_output.o | awk '$1 ~ /^[0-9a-f]+$/ {print $1, $3, $5, $6, $7}' > nasm_relocations
+        if ! cmp -s encoder_relocations nasm_relocations
+            then
+                result="different relocations"
+            fi
+        if [ "${result}" != "same" ]
+            then
+                failed=1
+            fi
+        echo "${program#"${source}"/} ${options} - ${result}"
+        done
+    done
+exit ${failed}
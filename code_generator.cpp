@@ -1,10 +1,16 @@
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include "code_generator.h"
+#include "profile.h"
+#include "if_converter.h"
 #include "parser.h"
 #include "ast.h"
 #include "lexer.h"
+#include "remarks.h"
+#include "superoptimizer.h"
 
-extern std::unique_ptr<symbol_table> global_sym_table;
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
 
 unhandled_register_error::unhandled_register_error(const char* msg, const code_register& reg) 
 : _msg("register: " + std::string(reg.get_name()) + "\n" + std::string(msg)) {}
@@ -22,48 +28,218 @@ _name("_" + std::to_string(global_sym_table->get_identifier(name)) + "_" + name)
     _id_code = global_sym_table->get_identifier(name);
 }
 
+some_variable::some_variable(const std::string& name, int frame_offset) :
+_name("rbp - " + std::to_string(frame_offset)){
+    _id_code = global_sym_table->get_identifier(name);
+}
+
 void code_generator::output_preamble(){
     _file   << "section .note.GNU-stack\n"
             << "section .text\n"
             << "\textern printf\n"
             << "\textern stdout\n"
             << "\textern fflush\n"
+            << "\textern fwrite\n"
             << "\tglobal main\n"
             << "main:\n"
             << "\tpush rbp\n"
             << "\tmov rbp, rsp\n\n";
 }
 
+void code_generator::output_source_line(int line){
+    //the statements made by the passes belong to the statement around them
+    if(line == 0 || line == _source_line)
+        return;
+    _source_line = line;
+    _file << "; line " << line << '\n';
+}
+
 void code_generator::output_variables(){
     _file  << "section .data\n"
             << "\td_fmt db '%d',10,0\n";
 
-    for(const auto& usr_var : _variables){
+    for(const auto& [id, usr_var] : _variables){
         _file << "\t" << usr_var.get_asm_name() << " dq 0\n";
     }
+    if(!_precomputed_output.empty()){
+        //a db line for every printed line, the output has only numbers and new lines
+        _file << "\t_PRECOMPUTED_OUTPUT:\n";
+        size_t begin = 0;
+        while(begin < _precomputed_output.size()){
+            auto end = _precomputed_output.find('\n', begin);
+            _file << "\tdb '" << _precomputed_output.substr(begin, end - begin) << "',10\n";
+            begin = end + 1;
+        }
+    }
+    if(_is_instrumenting){
+        _file   << std::hex << std::showbase
+                << "\t_PROFILE_DATA dq " << branch_profile::magic << ", " << _profile->get_program_hash()
+                << std::dec << std::noshowbase << ", " << _profile->get_branches_count() << '\n';
+        if(_profile->get_branches_count() > 0){
+            _file << "\ttimes " << _profile->get_branches_count() * 2 << " dq 0\n";
+        }
+        //the file name as bytes, so any symbol in it is safe
+        _file << "\t_PROFILE_FILE db ";
+        for(unsigned char c : _profile_output){
+            _file << static_cast<int>(c) << ',';
+        }
+        _file << "0\n";
+    }
+}
+
+void code_generator::output_profile_dump(){
+    //open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644), write the counters and close it
+    _file   << "\tmov rax, 2\n"
+            << "\tmov rdi, _PROFILE_FILE\n"
+            << "\tmov rsi, 577\n"
+            << "\tmov rdx, 420\n"
+            << "\tsyscall\n"
+            << "\ttest rax, rax\n"
+            << "\tjs _PROFILE_DUMP_END\n"
+            << "\tmov rdi, rax\n"
+            << "\tmov rax, 1\n"
+            << "\tmov rsi, _PROFILE_DATA\n"
+            << "\tmov rdx, " << (3 + _profile->get_branches_count() * 2) * 8 << '\n'
+            << "\tsyscall\n"
+            << "\tmov rax, 3\n"
+            << "\tsyscall\n"
+            << "_PROFILE_DUMP_END:\n";
+}
+
+void code_generator::output_precomputed_output(){
+    //fwrite(output, 1, size, stdout) before any printf, so the output keeps its order and is buffered like printf:
+    //a fault later in the program loses it like the output the program would have printed itself
+    output_symbol_address("rdi", "_PRECOMPUTED_OUTPUT");
+    _file   << "\tmov rsi, 1\n"
+            << "\tmov rdx, " << _precomputed_output.size() << '\n'
+            << "\tmov rcx, " << get_memory_operand("stdout") << '\n'
+            << "\tcall fwrite\n\n";
 }
 
 void code_generator::output_postamble(){
-    _file  << "\n\tmov rdi, [stdout]\n"
-            << "\tcall fflush\n"
-            << "\tpop rbp\n"
-            << "\tmov rax, 60\n"
-            << "\tmov rdi, 0\n"
-            << "\tsyscall\n\n";
+    _source_line = 0;
+    _file << "; line 0\n";
+    _file  << "\n\tmov rdi, " << get_memory_operand("stdout") << '\n'
+            << "\tcall fflush\n";
+    if(_is_instrumenting){
+        output_profile_dump();
+    }
+    _file   << "\tmov rsp, rbp\n"
+            << "\tpop rbp\n";
+    if(_is_returning){
+        _file << "\tret\n\n";
+    }else{
+        _file   << "\tmov rax, 60\n"
+                << "\tmov rdi, 0\n"
+                << "\tsyscall\n\n";
+    }
+    _file << _cold_code;
     output_variables();
 }
 
+void code_generator::output_condition(const expression* expr){
+    int reg = expr->accept_visitor(*this);
+    _file << "\ttest " << _registers[reg].get_name() << ", " << _registers[reg].get_name() << '\n';
+    _registers[reg].become_free();
+}
+
+void code_generator::output_branch_counter(const statement* stat, bool is_taken){
+    if(!_is_instrumenting){
+        return;
+    }
+    int id = _profile->get_branch_id(stat);
+    if(id != -1){
+        _file << "\tinc qword [_PROFILE_DATA + " << (3 + id * 2 + (is_taken ? 0 : 1)) * 8 << "]\n";
+    }
+}
+
+bool code_generator::is_cold_branch(const statement* stat, bool is_taken) const{
+    if(!_profile || !_profile->has_counts()){
+        return false;
+    }
+    uint64_t count = is_taken ? _profile->get_taken_count(stat) : _profile->get_not_taken_count(stat);
+    uint64_t other_count = is_taken ? _profile->get_not_taken_count(stat) : _profile->get_taken_count(stat);
+    return other_count > 0 && count * _cold_branch_ratio <= other_count;
+}
+
+void code_generator::output_cold_block(const compound_statement* stat, const std::string& label, const std::string& return_label){
+    std::ostringstream cold_code;
+    auto* hot_code = static_cast<std::ostream&>(_file).rdbuf(cold_code.rdbuf());
+    //the cold code is placed after main, it starts with its own source line
+    int hot_source_line = _source_line;
+    _file << "; line " << _source_line << '\n'
+          << label << ":\n";
+    stat->accept_visitor(*this);
+    _file << "\tjmp " << return_label << "\n\n";
+    static_cast<std::ostream&>(_file).rdbuf(hot_code);
+    _source_line = hot_source_line;
+    _cold_code += cold_code.str();
+}
+
+const some_variable& code_generator::get_variable(int id_code) const{
+    for(auto scope = _local_scopes.rbegin(); scope != _local_scopes.rend(); scope++){
+        auto it = scope->find(id_code);
+        if(it != scope->end())
+            return it->second;
+    }
+    auto it = _variables.find(id_code);
+    if(it == _variables.end())
+        throw std::runtime_error("undeclared identifier");
+    return it->second;
+}
+
+std::string code_generator::get_memory_operand(const std::string& address) const{
+    //a slot of the stack frame is relative to rbp in both kinds of code
+    bool is_symbol = address.find(' ') == std::string::npos;
+    return "[" + std::string(_is_position_independent && is_symbol ? "rel " : "") + address + "]";
+}
+
+void code_generator::output_symbol_address(const char* reg, const std::string& symbol){
+    if(_is_position_independent){
+        _file << "\tlea " << reg << ", [rel " << symbol << "]\n";
+    }else{
+        _file << "\tmov " << reg << ", " << symbol << '\n';
+    }
+}
+
 int code_generator::find_free_reg(){
+    int reg = -1;
+    for(int i = 0; i < _registers_count; i++){
+        if(!_registers[i].is_busy() && (reg == -1 || _allocation_times[i] < _allocation_times[reg])){
+            reg = i;
+        }
+    }
+    if(reg == -1)
+        throw std::runtime_error("failed to find free register");
+    _allocation_times[reg] = ++_allocations_count;
+    return reg;
+}
+
+bool code_generator::has_free_reg() const{
     for(int i = 0; i < _registers_count; i++){
         if(!_registers[i].is_busy()){
-            return i;
+            return true;
         }
     }
-    throw std::runtime_error("failed to find free register");
+    return false;
+}
+
+int code_generator::get_free_regs_count() const{
+    int count = 0;
+    for(int i = 0; i < _registers_count; i++){
+        if(!_registers[i].is_busy()){
+            count++;
+        }
+    }
+    return count;
 }
 
 int code_generator::mov_reg_var(int reg, const class identifier_expression* expr){
-    _file << "\tmov " << _registers[reg].get_name() << ", [" << _variables[expr->get_id()].get_asm_name() << "]\n";
+    return mov_reg_var(reg, expr->get_id());
+}
+
+int code_generator::mov_reg_var(int reg, int id_code){
+    _file << "\tmov " << _registers[reg].get_name() << ", " << get_memory_operand(get_variable(id_code).get_asm_name()) << '\n';
     _registers[reg].become_busy();
     return reg;
 }
@@ -173,74 +349,142 @@ int code_generator::div_reg(int left, int right){
 void code_generator::for_loop(const for_statement* stat){
     auto loop_number = std::to_string(_for_loop_count++);
     stat->get_start_statement()->accept_visitor(*this);
-    auto iterator_variable = _variables[stat->get_start_statement()->get_identifier_code()].get_asm_name();
+    auto iterator_variable = get_memory_operand(get_variable(stat->get_start_statement()->get_identifier_code()).get_asm_name());
 
     auto id_node = std::make_shared<identifier_expression>(stat->get_start_statement()->get_identifier_code());
     auto conditional_expr = std::make_shared<binary_expression>(
         arithmetical_operation::NEQUAL, id_node, stat->get_final_expression());
         
     _file   << "\n_FOR_LOOP" << loop_number << ":\n";
-    conditional_expr->accept_visitor(*this);
+    output_condition(conditional_expr.get());
     _file   << "\tjz _FOR_LOOP_END" << loop_number << "\n\n";
+    output_branch_counter(stat, true);
     stat->get_inner_statement()->accept_visitor(*this);
 
+    output_source_line(stat->get_line());
     int reg = stat->get_after_iter_expression()->accept_visitor(*this);
-    _file   << "\tadd [" << iterator_variable << "], " << _registers[reg].get_name() << '\n'
+    _file   << "\tadd " << iterator_variable << ", " << _registers[reg].get_name() << '\n'
             << "\tjmp _FOR_LOOP" << loop_number << '\n'
-            << "_FOR_LOOP_END" << loop_number << ":\n\n";
+            << "_FOR_LOOP_END" << loop_number << ":\n";
+    _registers[reg].become_free();
+    output_branch_counter(stat, false);
+    _file << '\n';
 }
 
 void code_generator::while_loop(const while_statement* stat){
     auto loop_number = std::to_string(_while_loop_count++);
     _file   << "_WHILE_COND" << loop_number << ":\n";
     //jump outside the loop if expression == 0
-    stat->get_conditional_expression()->accept_visitor(*this);
+    output_condition(stat->get_conditional_expression().get());
     _file   << "\tjz _WHILE_END" << loop_number << "\n";
+    output_branch_counter(stat, true);
     stat->get_inner_statement()->accept_visitor(*this);
+    output_source_line(stat->get_line());
     _file   << "\tjmp _WHILE_COND" << loop_number << '\n'
-            << "_WHILE_END" << loop_number <<  ":\n\n";
+            << "_WHILE_END" << loop_number <<  ":\n";
+    output_branch_counter(stat, false);
+    _file << '\n';
 }
 
 void code_generator::if_conditional(const class if_statement* stat){
     auto conditional_clause_number = std::to_string(_if_clause_count++);
+    auto if_label = "_IF_STATEMENTS" + conditional_clause_number;
+    auto else_label = "_ELSE_STATEMENTS" + conditional_clause_number;
+    auto end_label = "_END_IF_STATEMENTS" + conditional_clause_number;
+    const auto& else_stat = stat->get_else_inner_statement();
     _file << '\n';
-    stat->get_conditional_expression()->accept_visitor(*this);
-    // if conditional expression != 0
-    _file  << "\tjnz _IF_STATEMENTS" << conditional_clause_number << '\n';
-    if(stat->get_else_inner_statement()){
-        stat->get_else_inner_statement()->accept_visitor(*this);
+    output_condition(stat->get_conditional_expression().get());
+
+    if(is_cold_branch(stat, true)){
+        //the if statements are rarely executed, keep them out of line
+        _file << "\tjnz " << if_label << '\n';
+        if(else_stat){
+            else_stat->accept_visitor(*this);
+        }
+        _file << end_label << ":\n\n";
+        output_cold_block(stat->get_if_inner_statement().get(), if_label, end_label);
+    }else if(_profile && _profile->has_counts() && _profile->get_taken_count(stat) > _profile->get_not_taken_count(stat)){
+        //the if statements are hot, they are the fallthrough
+        if(!else_stat){
+            _file << "\tjz " << end_label << '\n';
+            stat->get_if_inner_statement()->accept_visitor(*this);
+        }else if(is_cold_branch(stat, false)){
+            _file << "\tjz " << else_label << '\n';
+            stat->get_if_inner_statement()->accept_visitor(*this);
+            output_cold_block(else_stat.get(), else_label, end_label);
+        }else{
+            _file << "\tjz " << else_label << '\n';
+            stat->get_if_inner_statement()->accept_visitor(*this);
+            _file << "\tjmp " << end_label << '\n'
+                  << else_label << ":\n";
+            else_stat->accept_visitor(*this);
+        }
+        _file << end_label << ":\n\n";
+    }else{
+        // if conditional expression != 0
+        _file  << "\tjnz " << if_label << '\n';
+        output_branch_counter(stat, false);
+        if(else_stat){
+            else_stat->accept_visitor(*this);
+        }
+        _file   << "\tjmp " << end_label << '\n'
+                << if_label << ":\n";
+        output_branch_counter(stat, true);
+        stat->get_if_inner_statement()->accept_visitor(*this);
+        _file << end_label << ":\n\n";
     }
-    _file   << "\tjmp _END_IF_STATEMENTS" << conditional_clause_number  << '\n'
-            << "_IF_STATEMENTS" << conditional_clause_number << ":\n";
-    stat->get_if_inner_statement()->accept_visitor(*this);
-    _file << "_END_IF_STATEMENTS" << conditional_clause_number << ":\n\n";
 }
 
-void code_generator::assign_to_variable(const assignment_statement* stat){
-    if(stat->get_identifier_code() >= _variables.size()){
-        throw std::runtime_error("undeclared identifier");
+void code_generator::branchless_if_conditional(const class if_statement* stat){
+    _file << '\n';
+    int cond_reg = stat->get_conditional_expression()->accept_visitor(*this);
+    for(const auto& assignment : if_converter::get_conditional_assignments(stat)){
+        int if_reg = assignment.if_expr ? assignment.if_expr->accept_visitor(*this) : mov_reg_var(find_free_reg(), assignment.id_code);
+        int else_reg = assignment.else_expr ? assignment.else_expr->accept_visitor(*this) : mov_reg_var(find_free_reg(), assignment.id_code);
+        _file   << "\ttest " << _registers[cond_reg].get_name() << ", " << _registers[cond_reg].get_name() << '\n'
+                << "\tcmovnz " << _registers[else_reg].get_name() << ", " << _registers[if_reg].get_name() << '\n'
+                << "\tmov " << get_memory_operand(get_variable(assignment.id_code).get_asm_name()) << ", " << _registers[else_reg].get_name() << '\n';
+        _registers[if_reg].become_free();
+        _registers[else_reg].become_free();
     }
+    _registers[cond_reg].become_free();
+    _file << '\n';
+}
+
+void code_generator::assign_to_variable(const assignment_statement* stat){
+    const auto& var = get_variable(stat->get_identifier_code());
     //this statement can be without any expression and consist of only an identifier
     if(stat->get_expression()){
         int reg = stat->get_expression()->accept_visitor(*this);
-        _file << "\tmov [" << _variables[stat->get_identifier_code()].get_asm_name() << "], "  << _registers[reg].get_name() << "\n\n";
+        _file << "\tmov " << get_memory_operand(var.get_asm_name()) << ", "  << _registers[reg].get_name() << "\n\n";
         _registers[reg].become_free();
     }
 }
 
 void code_generator::declare_variable(const variable_declaration* stat){
-    _variables.emplace_back(some_variable(stat->get_identifier()));
+    //a declaration inside a loop body is generated once for every copy of the body
+    auto var = _variables.end();
+    if(_local_scopes.empty()){
+        var = _variables.try_emplace(stat->get_identifier_code(), some_variable(stat->get_identifier())).first;
+    }else if(_local_scopes.back().contains(stat->get_identifier_code())){
+        var = _local_scopes.back().find(stat->get_identifier_code());
+    }else{
+        _frame_offset += 8;
+        _frame_size = std::max(_frame_size, _frame_offset);
+        var = _local_scopes.back().try_emplace(stat->get_identifier_code(), some_variable(stat->get_identifier(), _frame_offset)).first;
+    }
 
     int reg = stat->get_expression()->accept_visitor(*this);
-    _file << "\tmov [" << _variables.back().get_asm_name() << "], " << _registers[reg].get_name() << "\n\n";
+    _file << "\tmov " << get_memory_operand(var->second.get_asm_name()) << ", " << _registers[reg].get_name() << "\n\n";
     _registers[reg].become_free();
 }
 
 void code_generator::print_reg(int reg){
     check_valid_storage(_registers[reg]);
 
-    _file   << "\n\tmov rdi, d_fmt\n"
-            << "\tmov rsi, " << _registers[reg].get_name() << '\n'
+    _file << '\n';
+    output_symbol_address("rdi", "d_fmt");
+    _file   << "\tmov rsi, " << _registers[reg].get_name() << '\n'
             << "\tcall printf\n\n";
     _registers[reg].become_free();
 }
@@ -251,9 +495,68 @@ int code_generator::node_interaction(const number_expression* expr){
 int code_generator::node_interaction(const identifier_expression* expr){
     return mov_reg_var(find_free_reg(), expr);
 }
+int code_generator::output_rewrite(const binary_expression* expr){
+    std::vector<int> inputs;
+    auto key = superoptimizer::get_template(expr, inputs);
+    const auto* rewrite = key.empty() ? nullptr : _rewrites->find(key);
+    if(!rewrite || rewrite->instructions.empty() || get_free_regs_count() < rewrite->registers_count){
+        return -1;
+    }
+    //the inputs are loaded to the first registers of the sequence, the others are its temporaries
+    std::vector<int> regs;
+    for(int i = 0; i < rewrite->registers_count; i++){
+        int reg = find_free_reg();
+        if(i < static_cast<int>(inputs.size())){
+            mov_reg_var(reg, inputs[i]);
+        }else{
+            _registers[reg].become_busy();
+        }
+        regs.push_back(reg);
+    }
+    for(const auto& instruction : rewrite->instructions){
+        std::string text;
+        for(size_t i = 0; i < instruction.size(); i++){
+            if(instruction[i] == '%' && i + 1 < instruction.size() && isdigit(instruction[i + 1])){
+                text += _registers[regs.at(instruction[++i] - '0')].get_name();
+            }else{
+                text += instruction[i];
+            }
+        }
+        _file << '\t' << text << '\n';
+    }
+    for(size_t i = 1; i < regs.size(); i++){
+        _registers[regs[i]].become_free();
+    }
+    if(_remarks)
+        _remarks->emit(remark_kind::APPLIED, "superopt", _source_line, "the expression " + key + " is generated with " +
+         std::to_string(rewrite->instructions.size()) + " instructions of the superoptimizer database");
+    return regs[0];
+}
+
 int code_generator::node_interaction(const binary_expression* expr){
+    if(_rewrites){
+        int reg = output_rewrite(expr);
+        if(reg != -1)
+            return reg;
+    }
     int left_reg = expr->get_left()->accept_visitor(*this);
+    //all registers keep the operands of the outer expressions, the left operand waits on the stack
+    bool is_spilled = !has_free_reg();
+    if(is_spilled){
+        _file << "\tpush " << _registers[left_reg].get_name() << '\n';
+        _registers[left_reg].become_free();
+        if(_remarks)
+            _remarks->emit(remark_kind::MISSED, "register-allocation", _source_line,
+             "an operand is spilled to the stack, all " + std::to_string(_registers_count) + " registers are busy");
+    }
     int right_reg = expr->get_right()->accept_visitor(*this);
+    if(is_spilled){
+        _file   << "\tmov " << _registers[_spill_register].get_name() << ", " << _registers[right_reg].get_name() << '\n'
+                << "\tpop " << _registers[right_reg].get_name() << '\n';
+        left_reg = right_reg;
+        right_reg = _spill_register;
+        _registers[right_reg].become_busy();
+    }
 
     switch (expr->get_type()){
         case ast_node_type::ADD: return add_reg(left_reg,right_reg);
@@ -271,72 +574,100 @@ int code_generator::node_interaction(const binary_expression* expr){
     }
 }
 void code_generator::node_interaction(const print_statement* stat) {
+    output_source_line(stat->get_line());
     print_reg(stat->get_expression()->accept_visitor(*this));
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const assignment_statement* stat){
+    output_source_line(stat->get_line());
     assign_to_variable(stat);
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const variable_declaration* stat){
+    output_source_line(stat->get_line());
     declare_variable(stat);
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const compound_statement* stat){
+    int frame_offset = _frame_offset;
+    _local_scopes.emplace_back();
     if(stat->get_inner_statement()){
         stat->get_inner_statement()->accept_visitor(*this);
     }
+    _local_scopes.pop_back();
+    _frame_offset = frame_offset;
+    //the blocks of the copies of an unrolled loop body follow each other
     if(stat->get_next()){
-        throw std::runtime_error("my language doesn't support {statements} statements yet(");
+        stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const if_statement* stat){
-    if_conditional(stat);
+    output_source_line(stat->get_line());
+    if(stat->is_branchless()){
+        branchless_if_conditional(stat);
+    }else{
+        if_conditional(stat);
+    }
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const while_statement* stat){
+    output_source_line(stat->get_line());
     while_loop(stat);
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 void code_generator::node_interaction(const for_statement* stat){
+    output_source_line(stat->get_line());
     for_loop(stat);
     if(stat->get_next()){
         stat->get_next()->accept_visitor(*this);
     }
 }
 
-code_generator::code_generator(const std::string& output_filename){
-    _file.open(output_filename);
-    if(!_file.is_open())
-        throw std::runtime_error("failed to open the file: " + output_filename);
+void code_generator::instrument_branches(const branch_profile& profile, const std::string& profile_filename){
+    _profile = &profile;
+    _is_instrumenting = true;
+    _profile_output = profile_filename;
 }
 
-code_generator::~code_generator(){
-    _file.close();
+void code_generator::use_branch_profile(const branch_profile& profile){
+    _profile = &profile;
+    _is_instrumenting = false;
 }
 
 bool code_generator::generate_code(const std::shared_ptr<statement>& root){
     try{
         output_preamble();
+        if(!_precomputed_output.empty()){
+            output_precomputed_output();
+        }
         if(root) {
             root->accept_visitor(*this);
         }
         output_postamble();
+        _program = asm_program(_file.str());
+        if(_frame_size > 0){
+            //the frame size is known after the whole program, the slots keep rsp aligned by 16 for the calls
+            auto& lines = _program.get_lines();
+            auto frame_setup = std::find_if(lines.begin(), lines.end(), [](const asm_line& line){
+                return line.is_instruction() && line.opcode == "mov" && line.operands == std::vector<std::string>{"rbp", "rsp"};
+            });
+            lines.insert(frame_setup + 1, asm_line::instruction("sub", {"rsp", std::to_string((_frame_size + 15) / 16 * 16)}));
+        }
         return true;
     }catch(std::runtime_error& err){
-        std::cerr << err.what() << '\n';
+        *_errors << err.what() << '\n';
     }catch(unhandled_register_error& err){
-        std::cerr << err.what() << '\n';
+        *_errors << err.what() << '\n';
     }
     return false;
 }
\ No newline at end of file
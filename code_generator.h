@@ -1,7 +1,11 @@
 #include <array>
 #include <memory>
 #include <fstream>
+#include <iostream>
+#include <sstream>
 #include <vector>
+#include <map>
+#include "asm_program.h"
 
 class code_register;
 
@@ -42,7 +46,10 @@ private:
 public:
     some_variable(const std::string& name);
     some_variable(std::string&& name);
+    //a block local variable in the stack frame
+    some_variable(const std::string& name, int frame_offset);
     inline int get_id_code() const noexcept{return _id_code;}
+    //the address inside the brackets of a memory operand
     inline std::string get_asm_name() const noexcept{return _name;}
 
     friend bool operator<(const some_variable& a, const some_variable& b){
@@ -54,15 +61,49 @@ class code_generator{
 private:
 //rcx, r11
     static constexpr int _registers_count = 7;
-    std::array<code_register, _registers_count> _registers = {
-        "r8","r9","r10","r12","r13","r14","r15"
+    //r11 isn't allocated, it keeps the right operand while the spilled left one is restored from the stack
+    static constexpr int _spill_register = _registers_count;
+    std::array<code_register, _registers_count + 1> _registers = {
+        "r8","r9","r10","r12","r13","r14","r15","r11"
     };
-    std::ofstream _file;
-
-    std::vector<some_variable> _variables;
+    //the allocation number of every register: the least recently used free register is chosen,
+    //so the next expression doesn't wait for the registers just read and can be scheduled with them
+    std::array<int, _registers_count> _allocation_times{};
+    int _allocations_count = 0;
+    //a branch arm is moved out of line if it is executed this many times less often than the other one
+    static constexpr int _cold_branch_ratio = 16;
+    //the code is generated as text and kept as lines, so the passes can edit it before it's written
+    std::ostringstream _file;
+    asm_program _program;
+
+    //global variables are in the data section
+    std::map<int, some_variable> _variables;
+    //the variables of every open block are in the stack frame, a slot is reused when its block is closed
+    std::vector<std::map<int, some_variable>> _local_scopes;
+    int _frame_offset = 0;
+    int _frame_size = 0;
     int _if_clause_count = 0;
     int _while_loop_count = 0;
     int _for_loop_count = 0;
+
+    const class branch_profile* _profile = nullptr;
+    bool _is_instrumenting = false;
+    std::string _profile_output;
+    //out of line code placed after the end of main
+    std::string _cold_code;
+    class remark_emitter* _remarks = nullptr;
+    //the sequences found by the superoptimizer for small expressions
+    const class rewrite_database* _rewrites = nullptr;
+    //the output of the program computed at compile time, written before the generated code runs
+    std::string _precomputed_output;
+    //the source line of the generated code, given to the asm_program by "; line N" comments
+    int _source_line = 0;
+    //main returns to its caller instead of ending the process
+    bool _is_returning = false;
+    //the data is addressed relative to rip, so the code runs at any address
+    bool _is_position_independent = false;
+    //where the errors of the generation are reported
+    std::ostream* _errors = &std::cerr;
 private:
     template<class T, class... arg>
     void check_valid_storage(T a, arg ...args) const{
@@ -76,10 +117,24 @@ private:
     }
 
     void output_preamble();
-
+    void output_source_line(int line);
+    void output_condition(const class expression* expr);
+    void output_branch_counter(const class statement* stat, bool is_taken);
+    void output_cold_block(const class compound_statement* stat, const std::string& label, const std::string& return_label);
+    void output_profile_dump();
+    bool is_cold_branch(const class statement* stat, bool is_taken) const;
+
+    const some_variable& get_variable(int id_code) const;
+    //[name] of a symbol or a slot, [rel name] of a symbol in the position independent code
+    std::string get_memory_operand(const std::string& address) const;
+    //mov reg, name or lea reg, [rel name]
+    void output_symbol_address(const char* reg, const std::string& symbol);
     int find_free_reg();
+    bool has_free_reg() const;
+    int get_free_regs_count() const;
     int mov_reg(int reg, int val);
     int mov_reg_var(int reg, const class identifier_expression* expr);
+    int mov_reg_var(int reg, int id_code);
 
     int add_reg(int left, int right);
     int sub_reg(int left, int right);
@@ -93,13 +148,18 @@ private:
     int less_reg(int left, int right);
     int less_equal_reg(int left, int right);
 
+    //return -1 if the database has no sequence for the expression or there aren't enough free registers
+    int output_rewrite(const class binary_expression* expr);
+
     void print_reg(int reg);
     void declare_variable(const class variable_declaration* stat);
     void assign_to_variable(const class assignment_statement* stat);
     void if_conditional(const class if_statement* stat);
+    void branchless_if_conditional(const class if_statement* stat);
     void while_loop(const class while_statement* stat);
     void for_loop(const class for_statement* stat);
 
+    void output_precomputed_output();
     void output_postamble();
     void output_variables();
 
@@ -126,9 +186,23 @@ private:
     friend class while_statement;
     friend class for_statement;
 public:
-    code_generator(const std::string& output_filename);
+    code_generator() = default;
+
+    //count the executions of every branch and write them to the profile file at exit
+    void instrument_branches(const class branch_profile& profile, const std::string& profile_filename);
+    //lay out the branches according to the collected counts
+    void use_branch_profile(const class branch_profile& profile);
+    //generate the expressions the database has a sequence for with the sequence
+    inline void use_rewrite_database(const class rewrite_database& rewrites) noexcept{ _rewrites = &rewrites; }
+    inline void set_precomputed_output(const std::string& output){ _precomputed_output = output; }
+    //for the code called in the compiler process, the caller keeps the registers main doesn't save
+    inline void set_returning(bool is_returning) noexcept{ _is_returning = is_returning; }
+    //for a shared library: no address of the data section is an absolute field
+    inline void set_position_independent(bool is_position_independent) noexcept{ _is_position_independent = is_position_independent; }
+    //report the register spills
+    inline void set_remarks(class remark_emitter* remarks) noexcept{ _remarks = remarks; }
+    inline void set_error_stream(std::ostream& errors) noexcept{ _errors = &errors; }
 
     bool generate_code(const std::shared_ptr<class statement>& root);
-
-    ~code_generator();
+    inline asm_program& get_program() noexcept{ return _program; }
 };
\ No newline at end of file
@@ -0,0 +1,442 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "compile_server.h"
+#include "libenma.h"
+
+namespace{
+
+//the first field of a request, a server of another version refuses it
+constexpr std::string_view protocol = "enma-server 1";
+//a larger message is broken
+constexpr uint64_t max_message_size = 1ull << 31;
+
+volatile sig_atomic_t is_signaled = 0;
+
+void on_stop_signal(int){
+    is_signaled = 1;
+}
+
+//a message is its fields, a field is its size in 8 bytes and its bytes
+class message_writer{
+private:
+    std::string _bytes;
+public:
+    void add(std::string_view field){
+        uint64_t size = field.size();
+        _bytes.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        _bytes.append(field);
+    }
+    void add_number(int64_t number){
+        add(std::to_string(number));
+    }
+    void add_bytes(const std::vector<uint8_t>& bytes){
+        add(std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()));
+    }
+    inline const std::string& get_bytes() const noexcept{ return _bytes; }
+};
+
+//the fields are views of the message, throw std::runtime_error for a message that ends in a field
+class message_reader{
+private:
+    std::string_view _bytes;
+public:
+    message_reader(std::string_view bytes) : _bytes(bytes){}
+
+    std::string_view read(){
+        uint64_t size;
+        if(_bytes.size() < sizeof(size))
+            throw std::runtime_error("the message is truncated\n");
+        memcpy(&size, _bytes.data(), sizeof(size));
+        if(_bytes.size() - sizeof(size) < size)
+            throw std::runtime_error("the message is truncated\n");
+        auto field = _bytes.substr(sizeof(size), size);
+        _bytes.remove_prefix(sizeof(size) + size);
+        return field;
+    }
+    int64_t read_number(){
+        auto field = read();
+        int64_t number;
+        auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), number);
+        if(error != std::errc() || end != field.data() + field.size())
+            throw std::runtime_error("the message has a wrong number\n");
+        return number;
+    }
+    std::vector<uint8_t> read_bytes(){
+        auto field = read();
+        return std::vector<uint8_t>(field.begin(), field.end());
+    }
+};
+
+//a message on the socket is its size in 8 bytes and the message
+bool send_message(int socket, std::string_view message){
+    uint64_t size = message.size();
+    std::string bytes(reinterpret_cast<const char*>(&size), sizeof(size));
+    bytes.append(message);
+    for(size_t sent = 0; sent < bytes.size();){
+        auto count = send(socket, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if(count == -1 && errno == EINTR)
+            continue;
+        if(count <= 0)
+            return false;
+        sent += count;
+    }
+    return true;
+}
+
+bool receive_bytes(int socket, char* bytes, size_t size){
+    for(size_t received = 0; received < size;){
+        auto count = recv(socket, bytes + received, size - received, 0);
+        if(count == -1 && errno == EINTR)
+            continue;
+        if(count <= 0)
+            return false;
+        received += count;
+    }
+    return true;
+}
+
+bool receive_message(int socket, std::string& message){
+    uint64_t size;
+    if(!receive_bytes(socket, reinterpret_cast<char*>(&size), sizeof(size)) || size > max_message_size)
+        return false;
+    message.resize(size);
+    return receive_bytes(socket, message.data(), size);
+}
+
+//return -1 if the path is too long or no one listens on it
+int connect_socket(const std::string& path){
+    sockaddr_un address{};
+    if(path.size() >= sizeof(address.sun_path))
+        return -1;
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(server == -1)
+        return -1;
+    if(connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1){
+        close(server);
+        return -1;
+    }
+    return server;
+}
+
+//the relative paths of the command line are the ones of its directory, the server has another one
+std::string get_absolute_path(const std::string& path){
+    return path.empty() ? path : std::filesystem::absolute(path).string();
+}
+
+//the size and the modification time of a file the compilation reads, so a changed file is compiled again
+std::string get_file_stamp(const std::string& path){
+    struct stat status;
+    if(path.empty() || stat(path.c_str(), &status) != 0)
+        return "-";
+    return std::to_string(status.st_ino) + ':' + std::to_string(status.st_size) + ':' +
+     std::to_string(status.st_mtim.tv_sec) + '.' + std::to_string(status.st_mtim.tv_nsec);
+}
+
+std::string encode_request(const compile_options& options, const std::vector<source_file>& sources){
+    message_writer request;
+    request.add(protocol);
+    request.add(compile_server::get_compiler_stamp());
+    request.add(options.executable_name);
+    request.add(options.profile_generate_file);
+    request.add(get_absolute_path(options.profile_use_file));
+    request.add(std::string_view(&options.optimization_level, 1));
+    for(const auto* passes : {&options.enabled_passes, &options.disabled_passes}){
+        //sorted, so the same command line is the same request
+        std::vector<std::string> names(passes->begin(), passes->end());
+        std::sort(names.begin(), names.end());
+        request.add_number(names.size());
+        for(const auto& name : names){
+            request.add(name);
+        }
+    }
+    request.add_number(options.evaluation_steps);
+    //a database that doesn't exist is an empty one, so the request doesn't depend on the directory
+    request.add(std::filesystem::exists(options.superopt_database) ? get_absolute_path(options.superopt_database) : "");
+    request.add(options.backend);
+    request.add_number(options.is_shared);
+    request.add_number(sources.size());
+    for(const auto& source : sources){
+        request.add(source.name);
+        request.add(source.text);
+    }
+    return request.get_bytes();
+}
+
+//the fields after the protocol and the stamp, the texts of the sources are views of the request
+void decode_request(message_reader& request, compile_options& options, std::vector<source_file>& sources){
+    options.executable_name = request.read();
+    options.profile_generate_file = request.read();
+    options.profile_use_file = request.read();
+    auto level = request.read();
+    if(level.size() != 1)
+        throw std::runtime_error("the request has a wrong optimization level\n");
+    options.optimization_level = level[0];
+    for(auto* passes : {&options.enabled_passes, &options.disabled_passes}){
+        for(int64_t i = 0, count = request.read_number(); i < count; i++){
+            passes->emplace(request.read());
+        }
+    }
+    options.evaluation_steps = request.read_number();
+    options.superopt_database = request.read();
+    options.backend = request.read();
+    options.is_shared = request.read_number() != 0;
+    for(int64_t i = 0, count = request.read_number(); i < count; i++){
+        std::string name(request.read());
+        sources.push_back({name, request.read()});
+    }
+}
+
+std::string encode_response(const compile_result& result){
+    message_writer response;
+    response.add("compiled");
+    response.add_number(result.is_success);
+    response.add(result.errors);
+    response.add(result.artifacts.assembly);
+    response.add(result.artifacts.c_source);
+    response.add_bytes(result.artifacts.object);
+    response.add_bytes(result.artifacts.executable);
+    response.add(result.artifacts.header);
+    return response.get_bytes();
+}
+
+//return false for a refused request
+bool decode_response(message_reader& response, compile_result& result){
+    if(response.read() != "compiled")
+        return false;
+    result.is_success = response.read_number() != 0;
+    result.errors = response.read();
+    result.artifacts.assembly = response.read();
+    result.artifacts.c_source = response.read();
+    result.artifacts.object = response.read_bytes();
+    result.artifacts.executable = response.read_bytes();
+    result.artifacts.header = response.read();
+    return true;
+}
+
+}
+
+compile_server::compile_server(const std::string& socket_path, size_t threads_count, size_t cache_limit) :
+ _socket_path(socket_path), _threads_count(threads_count), _cache_limit(cache_limit), _compiler_stamp(get_compiler_stamp()){
+    if(_threads_count == 0)
+        _threads_count = std::max(1u, std::thread::hardware_concurrency());
+}
+
+compile_server::~compile_server(){
+    if(_listener != -1)
+        close(_listener);
+}
+
+std::string compile_server::get_default_socket(){
+    if(const char* path = getenv("ENMA_SERVER_SOCKET"))
+        return path;
+    return "/tmp/enma-" + std::to_string(getuid()) + ".socket";
+}
+
+std::string compile_server::get_compiler_stamp(){
+    return get_file_stamp("/proc/self/exe");
+}
+
+void compile_server::add_to_cache(const std::string& key, const std::string& response){
+    size_t size = key.size() + response.size();
+    std::lock_guard lock(_cache_mutex);
+    if(size > _cache_limit)
+        return;
+    auto [it, is_added] = _cache.emplace(key, response);
+    if(!is_added)
+        return;
+    _cache_order.push_back(&it->first);
+    _cache_size += size;
+    while(_cache_size > _cache_limit){
+        auto oldest = _cache.find(*_cache_order.front());
+        _cache_order.pop_front();
+        _cache_size -= oldest->first.size() + oldest->second.size();
+        _cache.erase(oldest);
+    }
+}
+
+std::string compile_server::compile(const std::string& request){
+    message_reader reader(request);
+    if(reader.read() != protocol || reader.read() != _compiler_stamp){
+        message_writer refusal;
+        refusal.add("refused");
+        return refusal.get_bytes();
+    }
+    compile_options options;
+    std::vector<source_file> sources;
+    decode_request(reader, options, sources);
+    //the files the compilation reads are a part of the request
+    auto key = request + get_file_stamp(options.superopt_database) + '\n' + get_file_stamp(options.profile_use_file);
+    {
+        std::lock_guard lock(_cache_mutex);
+        auto it = _cache.find(key);
+        if(it != _cache.end()){
+            _cache_hits++;
+            return it->second;
+        }
+    }
+    compile_result result;
+    try{
+        enma_context context(options);
+        result = context.compile(sources);
+    }catch(std::runtime_error& err){
+        result.errors = err.what();
+    }
+    auto response = encode_response(result);
+    add_to_cache(key, response);
+    return response;
+}
+
+void compile_server::serve(int client){
+    //a broken request closes the connection, the command line compiles in its process then
+    std::string request;
+    try{
+        if(receive_message(client, request))
+            send_message(client, compile(request));
+    }catch(std::runtime_error&){
+    }
+    close(client);
+}
+
+void compile_server::work(){
+    while(true){
+        int client;
+        {
+            std::unique_lock lock(_clients_mutex);
+            _clients_ready.wait(lock, [this](){ return _is_stopping || !_clients.empty(); });
+            if(_clients.empty())
+                return;
+            client = _clients.front();
+            _clients.pop_front();
+        }
+        _requests_count++;
+        serve(client);
+    }
+}
+
+void compile_server::run(){
+    sockaddr_un address{};
+    if(_socket_path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("the socket path is too long: " + _socket_path + '\n');
+    //a socket no one listens on is left by a server that was killed
+    if(int server = connect_socket(_socket_path); server != -1){
+        close(server);
+        throw std::runtime_error("a server already listens on " + _socket_path + '\n');
+    }
+    struct stat status;
+    if(lstat(_socket_path.c_str(), &status) == 0){
+        if(!S_ISSOCK(status.st_mode))
+            throw std::runtime_error(_socket_path + " isn't a socket\n");
+        unlink(_socket_path.c_str());
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, _socket_path.c_str(), _socket_path.size() + 1);
+    _listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(_listener == -1)
+        throw std::runtime_error("failed to create the socket: " + std::string(strerror(errno)) + '\n');
+    //only the user of the server can connect, the others would get the programs of the user
+    auto mask = umask(0177);
+    bool is_bound = bind(_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    umask(mask);
+    if(!is_bound || listen(_listener, SOMAXCONN) == -1)
+        throw std::runtime_error("failed to listen on " + _socket_path + ": " + strerror(errno) + '\n');
+
+    //the signals are only taken while the server waits for a connection, so the workers aren't interrupted
+    //and a signal can't come between the check and the wait
+    sigset_t stop_signals, waiting_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, &waiting_signals);
+    sigdelset(&waiting_signals, SIGINT);
+    sigdelset(&waiting_signals, SIGTERM);
+    struct sigaction action{};
+    action.sa_handler = on_stop_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    is_signaled = 0;
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < _threads_count; i++){
+        workers.emplace_back(&compile_server::work, this);
+    }
+    std::cout << "listening on " << _socket_path << " with " << _threads_count << " workers\n" << std::flush;
+    std::string error;
+    while(!is_signaled){
+        pollfd listener{_listener, POLLIN, 0};
+        if(ppoll(&listener, 1, nullptr, &waiting_signals) == -1){
+            if(errno != EINTR){
+                error = strerror(errno);
+                break;
+            }
+            continue;
+        }
+        int client = accept4(_listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if(client == -1)
+            continue;
+        {
+            std::lock_guard lock(_clients_mutex);
+            _clients.push_back(client);
+        }
+        _clients_ready.notify_one();
+    }
+
+    //the accepted connections are served before the workers end
+    {
+        std::lock_guard lock(_clients_mutex);
+        _is_stopping = true;
+    }
+    _clients_ready.notify_all();
+    for(auto& worker : workers){
+        worker.join();
+    }
+    close(_listener);
+    _listener = -1;
+    unlink(_socket_path.c_str());
+    sigprocmask(SIG_UNBLOCK, &stop_signals, nullptr);
+    if(!error.empty())
+        throw std::runtime_error("the server stopped: " + error + '\n');
+    std::cout << _requests_count << " requests, " << _cache_hits << " from the cache\n";
+}
+
+bool compile_client::is_served(const compile_options& options){
+    return !options.is_verbose && !options.is_pass_stats && options.applied_remarks.empty() &&
+     options.missed_remarks.empty() && options.remarks_file.empty() && !options.is_superopt && !options.is_emit_asm &&
+     !options.is_run && (options.backend == "native" || options.backend == "baseline");
+}
+
+bool compile_client::compile(const std::string& socket_path, const compile_options& options,
+ const std::vector<source_file>& sources, compile_result& result){
+    int server = connect_socket(socket_path);
+    if(server == -1)
+        return false;
+    //the server of another user could give any program
+    ucred peer;
+    socklen_t peer_size = sizeof(peer);
+    std::string response;
+    bool is_answered = getsockopt(server, SOL_SOCKET, SO_PEERCRED, &peer, &peer_size) == 0 && peer.uid == getuid() &&
+     send_message(server, encode_request(options, sources)) && receive_message(server, response);
+    close(server);
+    if(!is_answered)
+        return false;
+    try{
+        message_reader reader(response);
+        return decode_response(reader, result);
+    }catch(std::runtime_error&){
+        return false;
+    }
+}
@@ -0,0 +1,72 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct compile_options;
+struct compile_result;
+struct source_file;
+
+//the compiler kept running for the command lines: `enma --server` listens on a unix domain socket, a command line
+//that finds it sends its options and the texts of its files and writes the artifacts it gets back,
+//so the process start, the tables built on the first use (the keywords, the passes, the runtime and the stencils)
+//and the compilation of a program compiled before are paid once
+//a request is compiled by a worker of the pool with an enma_context, the responses are cached by their requests
+//and the stamps of the files the compilation reads
+class compile_server{
+private:
+    std::string _socket_path;
+    size_t _threads_count;
+    //the bytes of the cached responses, the oldest ones are dropped first
+    size_t _cache_limit;
+    //the size and the time of the executable, a command line of another build compiles in its process
+    std::string _compiler_stamp;
+    int _listener = -1;
+
+    std::mutex _clients_mutex;
+    std::condition_variable _clients_ready;
+    std::deque<int> _clients;
+    bool _is_stopping = false;
+
+    std::mutex _cache_mutex;
+    std::unordered_map<std::string, std::string> _cache;
+    //the keys of _cache in the order they were added
+    std::deque<const std::string*> _cache_order;
+    size_t _cache_size = 0;
+
+    std::atomic<uint64_t> _requests_count = 0;
+    std::atomic<uint64_t> _cache_hits = 0;
+private:
+    void work();
+    void serve(int client);
+    std::string get_response(const std::string& request);
+    std::string compile(const std::string& request);
+    void add_to_cache(const std::string& key, const std::string& response);
+public:
+    //the threads are the ones of the machine for 0
+    compile_server(const std::string& socket_path, size_t threads_count = 0, size_t cache_limit = 256 << 20);
+    ~compile_server();
+
+    //serve until SIGINT or SIGTERM, then remove the socket,
+    //throw std::runtime_error if the socket can't be listened on or another server listens on it
+    void run();
+    //$ENMA_SERVER_SOCKET or /tmp/enma-<uid>.socket
+    static std::string get_default_socket();
+    //the size and the modification time of the running executable
+    static std::string get_compiler_stamp();
+};
+
+class compile_client{
+public:
+    //the compilations the server does: the ones of enma_context that print nothing and run no other tool,
+    //for the native and the baseline backend
+    static bool is_served(const compile_options& options);
+    //send the sources to the server on the socket, the result is the one of the compilation in the process,
+    //return false if no server of the same user and the same executable listens on it or the connection breaks
+    static bool compile(const std::string& socket_path, const compile_options& options,
+     const std::vector<source_file>& sources, compile_result& result);
+};
@@ -0,0 +1,241 @@
+#include "dataflow.h"
+
+namespace{
+
+//a register or a variable, an empty string for immediates and addresses
+std::string get_location(const std::string& operand){
+    auto reg = asm_program::get_full_register(operand);
+    if(asm_program::is_register(reg))
+        return reg;
+    return asm_program::get_memory_symbol(operand);
+}
+
+}
+
+instruction_effects get_instruction_effects(const asm_line& line){
+    instruction_effects effects;
+    const auto& opcode = line.opcode;
+    const auto& ops = line.operands;
+    auto use = [&effects](const std::string& operand){
+        auto location = get_location(operand);
+        if(!location.empty())
+            effects.uses.push_back(location);
+    };
+    auto def = [&effects](const std::string& operand){
+        auto location = get_location(operand);
+        if(!location.empty()){
+            effects.defs.push_back(location);
+        }else{
+            //a store to an address which isn't a variable
+            effects.has_side_effects = true;
+        }
+    };
+
+    //a write to a 32-bit register clears the upper half, so it's a write of the whole register
+    if((opcode == "mov" || opcode == "movzx") && ops.size() == 2){
+        def(ops[0]);
+        use(ops[1]);
+    }else if((opcode == "add" || opcode == "sub" || opcode == "imul" || opcode == "and" || opcode == "or" || opcode == "xor") && ops.size() == 2){
+        def(ops[0]);
+        if(!(opcode == "xor" && ops[0] == ops[1]))
+            use(ops[0]);
+        use(ops[1]);
+        effects.defs.push_back("flags");
+    }else if(opcode == "imul" && ops.size() == 3){
+        def(ops[0]);
+        use(ops[1]);
+        effects.defs.push_back("flags");
+    }else if((opcode == "shl" || opcode == "sar" || opcode == "shr") && ops.size() == 2 && asm_program::is_immediate(ops[1])){
+        def(ops[0]);
+        use(ops[0]);
+        effects.defs.push_back("flags");
+    }else if(opcode == "lea" && ops.size() == 2){
+        //the address is computed, the memory isn't read
+        def(ops[0]);
+        std::string reg;
+        for(char c : ops[1] + ' '){
+            if(isalnum(c)){
+                reg += c;
+                continue;
+            }
+            if(asm_program::is_register(reg))
+                effects.uses.push_back(reg);
+            reg.clear();
+        }
+    }else if((opcode == "inc" || opcode == "dec" || opcode == "neg") && ops.size() == 1){
+        def(ops[0]);
+        use(ops[0]);
+        effects.defs.push_back("flags");
+    }else if((opcode == "cmp" || opcode == "test") && ops.size() == 2){
+        use(ops[0]);
+        use(ops[1]);
+        effects.defs.push_back("flags");
+    }else if(opcode.starts_with("set") && ops.size() == 1){
+        //only the low byte is written
+        def(ops[0]);
+        use(ops[0]);
+        effects.uses.push_back("flags");
+    }else if(opcode.starts_with("cmov") && ops.size() == 2){
+        def(ops[0]);
+        use(ops[0]);
+        use(ops[1]);
+        effects.uses.push_back("flags");
+    }else if(opcode == "cqo"){
+        effects.uses.push_back("rax");
+        effects.defs.push_back("rdx");
+    }else if(opcode == "idiv" && ops.size() == 1){
+        //a division by zero faults
+        effects.has_side_effects = true;
+        use(ops[0]);
+        effects.uses.insert(effects.uses.end(), {"rax", "rdx"});
+        effects.defs.insert(effects.defs.end(), {"rax", "rdx", "flags"});
+    }else if(opcode == "call"){
+        effects.has_side_effects = true;
+        //the generated calls are printf, fflush and fwrite, their arguments are in rdi, rsi, rdx and rcx
+        effects.uses = {"rdi", "rsi", "rdx", "rcx", "rax", "rsp"};
+        effects.defs = {"rax", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "flags"};
+    }else if(opcode == "syscall"){
+        effects.has_side_effects = true;
+        effects.uses = {"rax", "rdi", "rsi", "rdx", "r10", "r8", "r9"};
+        effects.defs = {"rax", "rcx", "r11"};
+    }else if(opcode == "push" && ops.size() == 1){
+        effects.has_side_effects = true;
+        use(ops[0]);
+        effects.uses.push_back("rsp");
+    }else if(opcode == "pop" && ops.size() == 1){
+        effects.has_side_effects = true;
+        def(ops[0]);
+    }else if(line.is_jump()){
+        effects.has_side_effects = true;
+        if(line.is_conditional_jump())
+            effects.uses.push_back("flags");
+    }else if(opcode == "ret"){
+        effects.has_side_effects = true;
+        effects.uses.push_back("rax");
+    }else{
+        effects.has_side_effects = true;
+        effects.is_unknown = true;
+    }
+    //the stack frame is kept as it is
+    for(const auto& location : effects.defs){
+        if(location == "rsp" || location == "rbp")
+            effects.has_side_effects = true;
+    }
+    return effects;
+}
+
+dataflow_result<location_set> compute_liveness(const asm_program& program, const std::vector<basic_block>& blocks){
+    const auto& lines = program.get_lines();
+    auto meet = [](location_set a, const location_set& b){
+        a.insert(b.begin(), b.end());
+        return a;
+    };
+    auto transfer = [&](int block, location_set live){
+        for(int i = blocks[block].end - 1; i >= blocks[block].begin; i--){
+            if(!lines[i].is_instruction())
+                continue;
+            auto effects = get_instruction_effects(lines[i]);
+            for(const auto& location : effects.defs){
+                live.erase(location);
+            }
+            live.insert(effects.uses.begin(), effects.uses.end());
+        }
+        return live;
+    };
+    return solve_dataflow<location_set>(blocks, false, location_set{}, location_set{}, meet, transfer);
+}
+
+std::vector<std::map<std::string, std::string>> track_register_constants(const asm_program& program, const basic_block& block){
+    const auto& lines = program.get_lines();
+    std::vector<std::map<std::string, std::string>> constants;
+    std::map<std::string, std::string> known;
+    for(int i = block.begin; i < block.end; i++){
+        constants.push_back(known);
+        if(!lines[i].is_instruction())
+            continue;
+        const auto& ops = lines[i].operands;
+        auto effects = get_instruction_effects(lines[i]);
+        std::string value;
+        if(lines[i].opcode == "mov" && ops.size() == 2 && asm_program::is_register(ops[0])){
+            if(asm_program::is_immediate(ops[1])){
+                value = ops[1];
+            }else if(known.contains(ops[1])){
+                value = known[ops[1]];
+            }
+        }
+        for(const auto& location : effects.defs){
+            known.erase(location);
+        }
+        if(!value.empty()){
+            known[ops[0]] = value;
+        }
+    }
+    return constants;
+}
+
+reaching_definitions compute_reaching_definitions(const asm_program& program, const std::vector<basic_block>& blocks){
+    const auto& lines = program.get_lines();
+    reaching_definitions reaching;
+    auto& definitions = reaching.definitions;
+    std::unordered_map<std::string, std::vector<int>> variable_definitions;
+    std::set<int> entry;
+
+    //the initial values, a variable of the data section is "name dq 0"
+    std::set<std::string> zero_variables;
+    for(int i = program.get_text_end(); i < static_cast<int>(lines.size()); i++){
+        auto text = lines[i].text;
+        auto pos = text.find(" dq 0");
+        if(pos != std::string::npos && pos + 5 == text.size()){
+            auto name = text.substr(text.find_first_not_of(" \t"));
+            zero_variables.insert(name.substr(0, name.find(' ')));
+        }
+    }
+    auto add_definition = [&](int line, const std::string& variable, const std::string& constant){
+        variable_definitions[variable].push_back(definitions.size());
+        definitions.push_back(variable_definition{line, variable, constant});
+    };
+
+    auto& line_definitions = reaching.line_definitions;
+    for(const auto& block : blocks){
+        auto constants = track_register_constants(program, block);
+        for(int i = block.begin; i < block.end; i++){
+            if(!lines[i].is_instruction())
+                continue;
+            for(const auto& location : get_instruction_effects(lines[i]).defs){
+                if(asm_program::is_register(location) || location == "flags")
+                    continue;
+                if(!variable_definitions.contains(location)){
+                    add_definition(-1, location, zero_variables.contains(location) ? "0" : "");
+                    entry.insert(definitions.size() - 1);
+                }
+                std::string constant;
+                const auto& ops = lines[i].operands;
+                if(lines[i].opcode == "mov"){
+                    const auto& known = constants[i - block.begin];
+                    constant = asm_program::is_immediate(ops[1]) ? ops[1] : known.contains(ops[1]) ? known.at(ops[1]) : "";
+                }
+                line_definitions[i] = definitions.size();
+                add_definition(i, location, constant);
+            }
+        }
+    }
+
+    auto meet = [](std::set<int> a, const std::set<int>& b){
+        a.insert(b.begin(), b.end());
+        return a;
+    };
+    auto transfer = [&](int block, std::set<int> reaching_set){
+        for(int i = blocks[block].begin; i < blocks[block].end; i++){
+            auto it = line_definitions.find(i);
+            if(it == line_definitions.end())
+                continue;
+            for(int killed : variable_definitions[definitions[it->second].variable]){
+                reaching_set.erase(killed);
+            }
+            reaching_set.insert(it->second);
+        }
+        return reaching_set;
+    };
+    reaching.result = solve_dataflow<std::set<int>>(blocks, true, entry, std::set<int>{}, meet, transfer);
+    return reaching;
+}
@@ -0,0 +1,95 @@
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include "asm_program.h"
+
+//the locations an instruction reads and writes: registers by their 64-bit names,
+//variables by their symbols and "flags" for the flags register
+struct instruction_effects{
+    std::vector<std::string> uses;
+    std::vector<std::string> defs;
+    //the instruction has to stay even if nothing uses its results
+    bool has_side_effects = false;
+    //the instruction isn't known to the analysis
+    bool is_unknown = false;
+};
+instruction_effects get_instruction_effects(const asm_line& line);
+
+template<class T>
+struct dataflow_result{
+    //the values at the entry and at the exit of every block
+    std::vector<T> in;
+    std::vector<T> out;
+};
+
+//iterative solver of a dataflow problem over the blocks of a program
+//a forward problem meets the exit values of the predecessors at a block entry, the entry block starts with the boundary value,
+//a backward problem meets the entry values of the successors at a block exit, the blocks without successors end with the boundary value
+//transfer(block index, value) gives the value at the other end of the block
+template<class T, class Meet, class Transfer>
+dataflow_result<T> solve_dataflow(const std::vector<basic_block>& blocks, bool is_forward, const T& boundary, const T& initial,
+ Meet meet, Transfer transfer){
+    int blocks_count = blocks.size();
+    dataflow_result<T> result{std::vector<T>(blocks_count, initial), std::vector<T>(blocks_count, initial)};
+    bool is_changed = true;
+    while(is_changed){
+        is_changed = false;
+        for(int k = 0; k < blocks_count; k++){
+            int i = is_forward ? k : blocks_count - 1 - k;
+            std::vector<int> neighbours;
+            if(is_forward){
+                neighbours = blocks[i].predecessors;
+            }else{
+                for(int successor : {blocks[i].taken, blocks[i].fallthrough}){
+                    if(successor != -1)
+                        neighbours.push_back(successor);
+                }
+            }
+
+            T value = initial;
+            bool is_boundary = is_forward ? i == 0 : neighbours.empty();
+            if(is_boundary){
+                value = boundary;
+            }
+            for(int neighbour : neighbours){
+                value = meet(value, is_forward ? result.out[neighbour] : result.in[neighbour]);
+            }
+            T transferred = transfer(i, value);
+            auto& meet_value = is_forward ? result.in[i] : result.out[i];
+            auto& transferred_value = is_forward ? result.out[i] : result.in[i];
+            if(meet_value != value || transferred_value != transferred){
+                meet_value = std::move(value);
+                transferred_value = std::move(transferred);
+                is_changed = true;
+            }
+        }
+    }
+    return result;
+}
+
+using location_set = std::set<std::string>;
+//the locations whose values are used later, nothing is live at the program exit
+dataflow_result<location_set> compute_liveness(const asm_program& program, const std::vector<basic_block>& blocks);
+
+//a store to a variable, or its initial value if the line is -1
+struct variable_definition{
+    int line;
+    std::string variable;
+    //the stored immediate, empty if it isn't known
+    std::string constant;
+};
+//the definitions of the variables that reach every block
+struct reaching_definitions{
+    std::vector<variable_definition> definitions;
+    //the definition index of every store line
+    std::unordered_map<int, int> line_definitions;
+    dataflow_result<std::set<int>> result;
+};
+//the variables of the data section start with 0
+reaching_definitions compute_reaching_definitions(const asm_program& program, const std::vector<basic_block>& blocks);
+
+//the immediates known to be in the registers before every line of a block, computed from the block only,
+//the index is the line number minus the beginning of the block
+std::vector<std::map<std::string, std::string>> track_register_constants(const asm_program& program, const basic_block& block);
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <map>
+#include <unordered_set>
+#include "dataflow_optimizer.h"
+#include "pass_manager.h"
+#include "dataflow.h"
+#include "remarks.h"
+
+dataflow_optimizer::dataflow_optimizer(remark_emitter* remarks) : _remarks(remarks){}
+
+//the name of the variable of the source for the remarks
+static std::string describe_variable(const std::string& symbol){
+    if(symbol.starts_with("rbp - "))
+        return "the local variable at [" + symbol + "]";
+    //the user variables are "_<id code>_<name>"
+    auto name_begin = symbol.find('_', 1);
+    if(symbol.size() > 1 && symbol[0] == '_' && isdigit(symbol[1]) && name_begin != std::string::npos)
+        return "'" + symbol.substr(name_begin + 1) + "'";
+    return "'" + symbol + "'";
+}
+
+int dataflow_optimizer::forward_stores(asm_program& program) const{
+    auto& lines = program.get_lines();
+    auto blocks = program.build_cfg();
+    auto reaching = compute_reaching_definitions(program, blocks);
+    const auto& definitions = reaching.definitions;
+
+    int forwarded_count = 0;
+    for(int b = 0; b < static_cast<int>(blocks.size()); b++){
+        auto reaching_set = reaching.result.in[b];
+        //variable -> the register which has its value since the store in this block
+        std::unordered_map<std::string, std::string> stored_registers;
+        for(int i = blocks[b].begin; i < blocks[b].end; i++){
+            auto& line = lines[i];
+            if(!line.is_instruction())
+                continue;
+            auto variable = line.opcode == "mov" && line.operands.size() == 2 ? asm_program::get_memory_symbol(line.operands[1]) : "";
+            if(!variable.empty()){
+                std::string constant;
+                bool is_constant = true;
+                for(int id : reaching_set){
+                    if(definitions[id].variable != variable)
+                        continue;
+                    if(definitions[id].constant.empty() || (!constant.empty() && constant != definitions[id].constant)){
+                        is_constant = false;
+                        break;
+                    }
+                    constant = definitions[id].constant;
+                }
+                std::string replacement;
+                if(is_constant && !constant.empty()){
+                    replacement = "the constant " + constant;
+                    line.operands[1] = constant;
+                }else if(stored_registers.contains(variable)){
+                    replacement = "the register " + stored_registers[variable] + " stored earlier";
+                    line.operands[1] = stored_registers[variable];
+                }
+                if(!replacement.empty()){
+                    forwarded_count++;
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "store-forwarding", line.source_line,
+                         "the load of " + describe_variable(variable) + " is replaced with " + replacement);
+                }
+            }
+            auto effects = get_instruction_effects(line);
+            std::erase_if(stored_registers, [&effects](const auto& stored){
+                return std::find(effects.defs.begin(), effects.defs.end(), stored.first) != effects.defs.end() ||
+                 std::find(effects.defs.begin(), effects.defs.end(), stored.second) != effects.defs.end();
+            });
+            if(line.opcode == "mov" && line.operands.size() == 2){
+                auto stored_variable = asm_program::get_memory_symbol(line.operands[0]);
+                if(!stored_variable.empty() && asm_program::is_register(line.operands[1])){
+                    stored_registers[stored_variable] = line.operands[1];
+                }
+            }
+            auto it = reaching.line_definitions.find(i);
+            if(it != reaching.line_definitions.end()){
+                std::erase_if(reaching_set, [&](int id){ return definitions[id].variable == definitions[it->second].variable; });
+                reaching_set.insert(it->second);
+            }
+        }
+    }
+    return forwarded_count;
+}
+
+int dataflow_optimizer::remove_dead_code(asm_program& program) const{
+    auto& lines = program.get_lines();
+    int text_end = program.get_text_end();
+    for(int i = 0; i < text_end; i++){
+        if(lines[i].is_instruction() && get_instruction_effects(lines[i]).is_unknown)
+            return 0;
+    }
+
+    int removed_count = 0;
+    for(int round = 0; round < _max_rounds; round++){
+        auto blocks = program.build_cfg();
+        auto liveness = compute_liveness(program, blocks);
+        std::vector<bool> is_removed(lines.size(), false);
+        int round_count = 0;
+        for(int b = 0; b < static_cast<int>(blocks.size()); b++){
+            auto constants = track_register_constants(program, blocks[b]);
+            auto live = liveness.out[b];
+            for(int i = blocks[b].end - 1; i >= blocks[b].begin; i--){
+                if(!lines[i].is_instruction())
+                    continue;
+                auto effects = get_instruction_effects(lines[i]);
+                bool has_side_effects = effects.has_side_effects;
+                if(lines[i].opcode == "idiv"){
+                    //a division by a known divisor except 0 and -1 can't fault
+                    const auto& known = constants[i - blocks[b].begin];
+                    auto it = known.find(lines[i].operands[0]);
+                    has_side_effects = it == known.end() || it->second == "0" || it->second == "-1";
+                }
+                bool is_used = effects.defs.empty();
+                for(const auto& location : effects.defs){
+                    is_used = is_used || live.contains(location);
+                }
+                const auto& ops = lines[i].operands;
+                bool is_noop = lines[i].opcode == "mov" && ops.size() == 2 && ops[0] == ops[1];
+                if(!has_side_effects && (!is_used || is_noop)){
+                    is_removed[i] = true;
+                    round_count++;
+                    if(_remarks && lines[i].opcode == "mov" && !is_noop){
+                        auto variable = asm_program::get_memory_symbol(lines[i].operands[0]);
+                        if(!variable.empty())
+                            _remarks->emit(remark_kind::APPLIED, "dead-code-elimination", lines[i].source_line,
+                             "the store to " + describe_variable(variable) + " is removed, the value isn't read later");
+                    }
+                    continue;
+                }
+                if(_remarks && !is_used && lines[i].opcode == "idiv"){
+                    _remarks->emit(remark_kind::MISSED, "dead-code-elimination", lines[i].source_line,
+                     "the unused division is kept, it can fault on a zero divisor");
+                }
+                for(const auto& location : effects.defs){
+                    live.erase(location);
+                }
+                live.insert(effects.uses.begin(), effects.uses.end());
+            }
+        }
+        for(int i = lines.size() - 1; i >= 0; i--){
+            if(is_removed[i])
+                lines.erase(lines.begin() + i);
+        }
+        removed_count += round_count;
+        if(round_count == 0)
+            break;
+    }
+    return removed_count;
+}
+
+int dataflow_optimizer::remove_unused_variables(asm_program& program) const{
+    auto& lines = program.get_lines();
+    int text_end = program.get_text_end();
+    std::unordered_set<std::string> used_symbols;
+    for(int i = 0; i < text_end; i++){
+        for(const auto& operand : lines[i].operands){
+            auto symbol = asm_program::get_memory_symbol(operand);
+            used_symbols.insert(symbol.empty() ? operand : symbol);
+        }
+    }
+
+    //the user variables are "_<id code>_<name> dq 0"
+    int removed_count = 0;
+    for(int i = lines.size() - 1; i > text_end; i--){
+        const auto& text = lines[i].text;
+        auto begin = text.find_first_not_of(" \t");
+        if(begin == std::string::npos || text[begin] != '_' || !text.ends_with(" dq 0"))
+            continue;
+        auto name = text.substr(begin, text.find(' ', begin) - begin);
+        if(name.size() > 1 && isdigit(name[1]) && !used_symbols.contains(name)){
+            lines.erase(lines.begin() + i);
+            removed_count++;
+        }
+    }
+    return removed_count;
+}
+
+int dataflow_optimizer::shorten_encodings(asm_program& program) const{
+    auto& lines = program.get_lines();
+    int text_end = program.get_text_end();
+    for(int i = 0; i < text_end; i++){
+        if(lines[i].is_instruction() && get_instruction_effects(lines[i]).is_unknown)
+            return 0;
+    }
+    auto blocks = program.build_cfg();
+    auto liveness = compute_liveness(program, blocks);
+    //line -> the instructions replacing it
+    std::map<int, std::vector<asm_line>> replacements;
+    for(int b = 0; b < static_cast<int>(blocks.size()); b++){
+        auto live = liveness.out[b];
+        for(int i = blocks[b].end - 1; i >= blocks[b].begin; i--){
+            if(!lines[i].is_instruction())
+                continue;
+            const auto& line = lines[i];
+            const auto& ops = line.operands;
+            bool is_flags_dead = !live.contains("flags");
+            bool is_short_register = ops.size() == 2 && asm_program::is_register(ops[0]) && ops[0] != "rsp" && ops[0] != "rbp";
+            if(is_short_register && line.opcode == "mov" && asm_program::is_immediate(ops[1]) && ops[1].size() < 12){
+                int64_t value = std::stoll(ops[1]);
+                if(value == 0 && is_flags_dead){
+                    auto reg = asm_program::get_register_part(ops[0], 32);
+                    replacements[i] = {asm_line::instruction("xor", {reg, reg})};
+                }else if(value >= -128 && value <= 127){
+                    //push imm8 and pop take 3-4 bytes, mov with imm32 takes 5-7
+                    replacements[i] = {asm_line::instruction("push", {ops[1]}), asm_line::instruction("pop", {ops[0]})};
+                }else if(value > 0 && value <= 0xffffffffll){
+                    //a write to the 32-bit register clears the upper half
+                    replacements[i] = {asm_line::instruction("mov", {asm_program::get_register_part(ops[0], 32), ops[1]})};
+                }
+            }else if(is_short_register && line.opcode == "and" && ops[1] == "255" && is_flags_dead){
+                replacements[i] = {asm_line::instruction("movzx",
+                 {asm_program::get_register_part(ops[0], 32), asm_program::get_register_part(ops[0], 8)})};
+            }else if(is_short_register && (line.opcode == "add" || line.opcode == "sub") && (ops[1] == "1" || ops[1] == "-1") && is_flags_dead){
+                //inc and dec keep the carry flag, nobody reads it
+                bool is_increment = (line.opcode == "add") == (ops[1] == "1");
+                replacements[i] = {asm_line::instruction(is_increment ? "inc" : "dec", {ops[0]})};
+            }else if(is_short_register && line.opcode == "cmp" && ops[1] == "0"){
+                //the same flags without the immediate
+                replacements[i] = {asm_line::instruction("test", {ops[0], ops[0]})};
+            }
+
+            auto effects = get_instruction_effects(line);
+            for(const auto& location : effects.defs){
+                live.erase(location);
+            }
+            live.insert(effects.uses.begin(), effects.uses.end());
+        }
+    }
+    for(auto it = replacements.rbegin(); it != replacements.rend(); it++){
+        for(auto& replacement : it->second){
+            replacement.source_line = lines[it->first].source_line;
+        }
+        lines.erase(lines.begin() + it->first);
+        lines.insert(lines.begin() + it->first, it->second.begin(), it->second.end());
+    }
+    return replacements.size();
+}
+
+static pass_registration forwarding_registration({"store-forwarding", pass_stage::ASSEMBLY, 10, "12s", "loads forwarded",
+ [](pass_context& context){
+    return dataflow_optimizer(context.remarks).forward_stores(*context.program);
+}});
+
+static pass_registration elimination_registration({"dead-code-elimination", pass_stage::ASSEMBLY, 40, "12s",
+ "instructions and variables removed", [](pass_context& context){
+    dataflow_optimizer dataflow_opt(context.remarks);
+    int removed_count = dataflow_opt.remove_dead_code(*context.program);
+    return removed_count + dataflow_opt.remove_unused_variables(*context.program);
+}});
+
+static pass_registration encoding_registration({"short-encoding", pass_stage::ASSEMBLY, 60, "s", "instructions shortened",
+ [](pass_context& context){
+    return dataflow_optimizer().shorten_encodings(*context.program);
+}});
@@ -0,0 +1,23 @@
+class asm_program;
+class remark_emitter;
+
+//optimizations of the generated assembly driven by the dataflow analyses
+class dataflow_optimizer{
+private:
+    static constexpr int _max_rounds = 16;
+    remark_emitter* _remarks;
+public:
+    dataflow_optimizer(remark_emitter* remarks = nullptr);
+
+    //replace the loads of a variable with the constant every reaching store has written,
+    //return the number of replaced loads
+    int forward_stores(asm_program& program) const;
+    //remove the stores to variables which are not read later and the computations nobody uses,
+    //return the number of removed instructions
+    int remove_dead_code(asm_program& program) const;
+    //remove the data of the variables the code doesn't refer to, return the number of removed variables
+    int remove_unused_variables(asm_program& program) const;
+    //replace instructions with shorter encodings of the same effect: 32-bit registers for the values that fit,
+    //xor for zero, push and pop for small immediates, return the number of replaced instructions
+    int shorten_encodings(asm_program& program) const;
+};
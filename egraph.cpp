@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <climits>
+#include <tuple>
+#include "egraph.h"
+#include "ast.h"
+
+bool enode::operator<(const enode& other) const{
+    return std::tie(op, value, left, right) < std::tie(other.op, other.value, other.left, other.right);
+}
+
+enode egraph::canonicalize(enode node){
+    if(node.left != -1)
+        node.left = find(node.left);
+    if(node.right != -1)
+        node.right = find(node.right);
+    return node;
+}
+
+std::optional<int64_t> egraph::evaluate(const enode& node){
+    if(node.op == ast_node_type::NUM)
+        return node.value;
+    if(node.op == ast_node_type::ID)
+        return std::nullopt;
+    auto left = _classes[find(node.left)].constant;
+    auto right = _classes[find(node.right)].constant;
+    if(!left || !right)
+        return std::nullopt;
+    //the registers wrap around like the unsigned numbers
+    uint64_t l = *left, r = *right;
+    switch (node.op){
+        case ast_node_type::ADD: return static_cast<int64_t>(l + r);
+        case ast_node_type::SUB: return static_cast<int64_t>(l - r);
+        case ast_node_type::MUL: return static_cast<int64_t>(l * r);
+        case ast_node_type::DIV:
+            //idiv faults, the program has to fault as well
+            if(*right == 0 || (*left == INT64_MIN && *right == -1))
+                return std::nullopt;
+            return *left / *right;
+        case ast_node_type::EQUAL: return *left == *right;
+        case ast_node_type::NEQUAl: return *left != *right;
+        case ast_node_type::GREATER: return *left > *right;
+        case ast_node_type::GREATER_EQ: return *left >= *right;
+        case ast_node_type::LESS: return *left < *right;
+        case ast_node_type::LESS_EQ: return *left <= *right;
+        default:
+            return std::nullopt;
+    }
+}
+
+void egraph::set_constant(int id, int64_t value){
+    id = find(id);
+    if(_classes[id].constant)
+        return;
+    _classes[id].constant = value;
+    //a number of the ast is an int
+    if(value >= INT_MIN && value <= INT_MAX){
+        merge(id, add(enode{ast_node_type::NUM, value}));
+    }
+}
+
+int egraph::add(const enode& node){
+    auto canonical = canonicalize(node);
+    auto it = _memo.find(canonical);
+    if(it != _memo.end())
+        return find(it->second);
+    int id = _classes.size();
+    _parents.push_back(id);
+    _classes.push_back(eclass{{canonical}, std::nullopt});
+    _memo.emplace(canonical, id);
+    _nodes_count++;
+    auto value = evaluate(canonical);
+    if(value)
+        set_constant(id, *value);
+    return find(id);
+}
+
+int egraph::find(int id){
+    int root = id;
+    while(_parents[root] != root){
+        root = _parents[root];
+    }
+    while(_parents[id] != root){
+        int next = _parents[id];
+        _parents[id] = root;
+        id = next;
+    }
+    return root;
+}
+
+bool egraph::merge(int left, int right){
+    left = find(left);
+    right = find(right);
+    if(left == right)
+        return false;
+    //the nodes of the smaller class are moved
+    if(_classes[left].nodes.size() < _classes[right].nodes.size())
+        std::swap(left, right);
+    _parents[right] = left;
+    auto& nodes = _classes[left].nodes;
+    nodes.insert(nodes.end(), _classes[right].nodes.begin(), _classes[right].nodes.end());
+    _classes[right].nodes.clear();
+    if(!_classes[left].constant)
+        _classes[left].constant = _classes[right].constant;
+    _is_congruent = false;
+    return true;
+}
+
+void egraph::rebuild(){
+    while(!_is_congruent){
+        _is_congruent = true;
+        _memo.clear();
+        _nodes_count = 0;
+        std::vector<std::pair<int, int>> merges;
+        for(int id : get_classes()){
+            auto& nodes = _classes[id].nodes;
+            for(auto& node : nodes){
+                node = canonicalize(node);
+            }
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end(), [](const enode& left, const enode& right){
+                return !(left < right) && !(right < left);
+            }), nodes.end());
+            _nodes_count += nodes.size();
+            for(const auto& node : nodes){
+                auto [it, is_new] = _memo.emplace(node, id);
+                if(!is_new)
+                    merges.emplace_back(it->second, id);
+            }
+        }
+        for(auto [left, right] : merges){
+            merge(left, right);
+        }
+        //a merge can tell the values of the operations on the merged classes
+        for(int id : get_classes()){
+            if(_classes[id].constant)
+                continue;
+            for(size_t i = 0; i < _classes[id].nodes.size(); i++){
+                auto value = evaluate(_classes[id].nodes[i]);
+                if(value){
+                    set_constant(id, *value);
+                    _is_congruent = false;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+std::vector<int> egraph::get_classes(){
+    std::vector<int> ids;
+    for(int id = 0; id < static_cast<int>(_classes.size()); id++){
+        if(_parents[id] == id)
+            ids.push_back(id);
+    }
+    return ids;
+}
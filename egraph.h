@@ -0,0 +1,57 @@
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+enum class ast_node_type;
+
+//an operation whose operands are classes of equal expressions
+struct enode{
+    ast_node_type op;
+    //the number of NUM, the identifier code of ID
+    int64_t value = 0;
+    //the operand classes of the binary operations, -1 for the leaves
+    int left = -1;
+    int right = -1;
+
+    bool operator<(const enode& other) const;
+};
+
+//classes of expressions proven equal, every node of a class is another way to compute the same value
+//the nodes with the same operation and operand classes are kept once (hash-consing),
+//so the graph holds all rewritten forms of an expression without copying the trees
+class egraph{
+private:
+    struct eclass{
+        std::vector<enode> nodes;
+        //the value all nodes compute if it's known at compile time
+        std::optional<int64_t> constant;
+    };
+    //union-find of the class ids, a merged class points to the class it was merged into
+    std::vector<int> _parents;
+    std::vector<eclass> _classes;
+    std::map<enode, int> _memo;
+    int _nodes_count = 0;
+    bool _is_congruent = true;
+private:
+    enode canonicalize(enode node);
+    //the value of the node if the values of its operands are known
+    std::optional<int64_t> evaluate(const enode& node);
+    //a class with a known value gets the number node, so the extraction can choose it
+    void set_constant(int id, int64_t value);
+public:
+    //return the class of the node, the existing one if there is the same node
+    int add(const enode& node);
+    int find(int id);
+    //the values of both classes are equal: the classes become one, return false if they already are
+    bool merge(int left, int right);
+    //merge the classes whose nodes became the same after the merges of their operands
+    void rebuild();
+
+    //the nodes of the class, find() of the id has to be used
+    inline const std::vector<enode>& get_nodes(int id) const{ return _classes[id].nodes; }
+    inline std::optional<int64_t> get_constant(int id){ return _classes[find(id)].constant; }
+    inline int get_nodes_count() const noexcept{ return _nodes_count; }
+    //the ids of the classes which aren't merged into others
+    std::vector<int> get_classes();
+};
@@ -0,0 +1,361 @@
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include "elf_linker.h"
+#include "elf_object.h"
+
+namespace{
+
+constexpr uint16_t elf_executable = 2;
+constexpr uint16_t elf_shared_object = 3;
+constexpr uint16_t elf_machine_x86_64 = 62;
+constexpr uint32_t segment_load = 1;
+constexpr uint32_t segment_dynamic = 2;
+constexpr uint32_t segment_gnu_stack = 0x6474e551;
+constexpr uint32_t segment_executable = 0x1;
+constexpr uint32_t segment_writable = 0x2;
+constexpr uint32_t segment_readable = 0x4;
+constexpr uint32_t section_progbits = 1;
+constexpr uint32_t section_strtab = 3;
+constexpr uint32_t section_hash = 5;
+constexpr uint32_t section_dynamic = 6;
+constexpr uint32_t section_dynsym = 11;
+constexpr uint64_t header_size = 64;
+constexpr uint64_t segment_header_size = 56;
+constexpr uint64_t section_header_size = 64;
+//two loaded segments and the one that makes the stack not executable
+constexpr uint64_t segments_count = 3;
+//and the one of the dynamic section in a shared library
+constexpr uint64_t shared_segments_count = 4;
+constexpr uint64_t dynamic_symbol_size = 24;
+constexpr uint64_t dynamic_entry_size = 16;
+constexpr int64_t dynamic_null = 0;
+constexpr int64_t dynamic_hash = 4;
+constexpr int64_t dynamic_strtab = 5;
+constexpr int64_t dynamic_symtab = 6;
+constexpr int64_t dynamic_strsz = 10;
+constexpr int64_t dynamic_syment = 11;
+constexpr int64_t dynamic_soname = 14;
+//a global function
+constexpr uint8_t symbol_global_function = 0x12;
+
+//the fields are little-endian like the host
+template<typename T>
+void put(std::vector<uint8_t>& bytes, T value){
+    uint8_t buffer[sizeof(T)];
+    memcpy(buffer, &value, sizeof(T));
+    bytes.insert(bytes.end(), buffer, buffer + sizeof(T));
+}
+
+uint64_t align(uint64_t value, uint64_t alignment){
+    return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+
+bool is_loaded(const object_section& section){
+    return (section.flags & elf_object::allocated) != 0;
+}
+
+bool is_writable(const object_section& section){
+    return (section.flags & elf_object::writable) != 0;
+}
+
+void put_file_header(std::vector<uint8_t>& headers, uint16_t type, uint64_t entry, uint64_t section_headers_offset,
+ uint16_t segments, uint16_t sections){
+    headers = {0x7f, 'E', 'L', 'F', 2, 1, 1, 0};
+    headers.resize(16, 0);
+    put<uint16_t>(headers, type);
+    put<uint16_t>(headers, elf_machine_x86_64);
+    put<uint32_t>(headers, 1);
+    put<uint64_t>(headers, entry);
+    put<uint64_t>(headers, header_size);
+    put<uint64_t>(headers, section_headers_offset);
+    put<uint32_t>(headers, 0);
+    put<uint16_t>(headers, header_size);
+    put<uint16_t>(headers, segment_header_size);
+    put<uint16_t>(headers, segments);
+    put<uint16_t>(headers, section_header_size);
+    put<uint16_t>(headers, sections);
+    //the names of the sections are the last section
+    put<uint16_t>(headers, sections - 1);
+}
+
+void put_segment(std::vector<uint8_t>& headers, uint64_t base_address, uint32_t type, uint32_t flags, uint64_t offset,
+ uint64_t size, uint64_t alignment){
+    bool has_address = type == segment_load || type == segment_dynamic;
+    put<uint32_t>(headers, type);
+    put<uint32_t>(headers, flags);
+    put<uint64_t>(headers, offset);
+    put<uint64_t>(headers, has_address ? base_address + offset : 0);
+    put<uint64_t>(headers, has_address ? base_address + offset : 0);
+    put<uint64_t>(headers, size);
+    put<uint64_t>(headers, size);
+    put<uint64_t>(headers, alignment);
+}
+
+void put_section(std::vector<uint8_t>& image, uint64_t base_address, uint32_t name, uint32_t type, uint64_t flags,
+ uint64_t offset, uint64_t size, uint64_t alignment, uint32_t link = 0, uint32_t info = 0, uint64_t entry_size = 0){
+    put<uint32_t>(image, name);
+    put<uint32_t>(image, type);
+    put<uint64_t>(image, flags);
+    put<uint64_t>(image, flags != 0 ? base_address + offset : 0);
+    put<uint64_t>(image, offset);
+    put<uint64_t>(image, size);
+    put<uint32_t>(image, link);
+    put<uint32_t>(image, info);
+    put<uint64_t>(image, alignment);
+    put<uint64_t>(image, entry_size);
+}
+
+
+}
+
+std::vector<std::vector<uint64_t>> elf_linker::layout(uint64_t base_address, uint64_t headers_size, uint64_t& text_end,
+ uint64_t& data_begin, uint64_t& data_end) const{
+    //the file offsets are the addresses without the base, so every segment is congruent to its offset modulo the page
+    std::vector<std::vector<uint64_t>> addresses(_objects.size());
+    uint64_t offset = headers_size;
+    for(int pass = 0; pass < 2; pass++){
+        if(pass == 1){
+            text_end = offset;
+            offset = align(offset, _page_size);
+            data_begin = offset;
+        }
+        for(size_t k = 0; k < _objects.size(); k++){
+            const auto& sections = _objects[k]->get_sections();
+            addresses[k].resize(sections.size(), 0);
+            for(size_t i = 0; i < sections.size(); i++){
+                if(!is_loaded(sections[i]) || is_writable(sections[i]) != (pass == 1))
+                    continue;
+                offset = align(offset, sections[i].alignment);
+                addresses[k][i] = base_address + offset;
+                offset += sections[i].bytes.size();
+            }
+        }
+    }
+    data_end = offset;
+    return addresses;
+}
+
+uint64_t elf_linker::get_image_size() const{
+    uint64_t text_end, data_begin, data_end;
+    layout(0, header_size + segments_count * segment_header_size, text_end, data_begin, data_end);
+    return data_end;
+}
+
+linked_image elf_linker::link_image(uint64_t base_address, const std::string& entry) const{
+    return link_image(base_address, header_size + segments_count * segment_header_size, entry);
+}
+
+linked_image elf_linker::link_image(uint64_t base_address, uint64_t headers_size, const std::string& entry) const{
+    linked_image image;
+    uint64_t data_end;
+    auto addresses = layout(base_address, headers_size, image.text_end, image.data_begin, data_end);
+
+    auto& globals = image.globals;
+    for(size_t k = 0; k < _objects.size(); k++){
+        for(const auto& symbol : _objects[k]->get_symbols()){
+            if(!symbol.is_global || symbol.section == -1)
+                continue;
+            if(globals.contains(symbol.name))
+                throw std::runtime_error("the symbol is defined twice: " + symbol.name);
+            globals[symbol.name] = addresses[k][symbol.section] + symbol.value;
+        }
+    }
+    auto get_address = [&](size_t k, int index){
+        const auto& symbol = _objects[k]->get_symbols()[index];
+        if(symbol.section != -1)
+            return addresses[k][symbol.section] + symbol.value;
+        auto it = globals.find(symbol.name);
+        if(it == globals.end())
+            throw std::runtime_error("undefined symbol: " + symbol.name);
+        return it->second;
+    };
+
+    image.bytes.resize(data_end, 0);
+    for(size_t k = 0; k < _objects.size(); k++){
+        const auto& sections = _objects[k]->get_sections();
+        for(size_t i = 0; i < sections.size(); i++){
+            if(!is_loaded(sections[i]))
+                continue;
+            uint64_t section_offset = addresses[k][i] - base_address;
+            std::copy(sections[i].bytes.begin(), sections[i].bytes.end(), image.bytes.begin() + section_offset);
+            for(const auto& relocation : sections[i].relocations){
+                uint64_t field = section_offset + relocation.offset;
+                uint64_t value = get_address(k, relocation.symbol) + relocation.addend;
+                int64_t signed_value = static_cast<int64_t>(value);
+                switch (relocation.type){
+                    case relocation_type::ABSOLUTE_64:
+                        memcpy(&image.bytes[field], &value, 8);
+                        break;
+                    case relocation_type::PC_RELATIVE_32:
+                        signed_value -= base_address + field;
+                        [[fallthrough]];
+                    case relocation_type::ABSOLUTE_32S:{
+                        if(signed_value < INT32_MIN || signed_value > INT32_MAX)
+                            throw std::runtime_error("the relocation of " + _objects[k]->get_symbols()[relocation.symbol].name +
+                             " doesn't fit 32 bits");
+                        auto field_value = static_cast<int32_t>(signed_value);
+                        memcpy(&image.bytes[field], &field_value, 4);
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error("unknown relocation type " + std::to_string(static_cast<uint32_t>(relocation.type)));
+                }
+            }
+        }
+    }
+    //a shared library has no entry
+    if(entry.empty())
+        return image;
+    if(!globals.contains(entry))
+        throw std::runtime_error("undefined entry symbol: " + entry);
+    image.entry_address = globals[entry];
+    return image;
+}
+
+std::vector<uint8_t> elf_linker::get_executable(const std::string& entry) const{
+    auto linked = link_image(_base_address, entry);
+    auto& image = linked.bytes;
+    uint64_t text_end = linked.text_end;
+    uint64_t data_begin = linked.data_begin;
+    uint64_t data_end = image.size();
+
+    //the section headers only name the two parts of the image for the tools like objdump
+    std::vector<uint8_t> shstrtab(1, 0);
+    for(const char* name : {".text", ".data", ".shstrtab"}){
+        shstrtab.insert(shstrtab.end(), name, name + strlen(name) + 1);
+    }
+    uint64_t shstrtab_offset = data_end;
+    uint64_t section_headers_offset = align(shstrtab_offset + shstrtab.size(), 8);
+
+    std::vector<uint8_t> headers;
+    put_file_header(headers, elf_executable, linked.entry_address, section_headers_offset, segments_count, 4);
+    //the headers are loaded with the code, so the offsets and the addresses start at the same page
+    put_segment(headers, _base_address, segment_load, segment_readable | segment_executable, 0, text_end, _page_size);
+    put_segment(headers, _base_address, segment_load, segment_readable | segment_writable, data_begin, data_end - data_begin,
+     _page_size);
+    put_segment(headers, _base_address, segment_gnu_stack, segment_readable | segment_writable, 0, 0, 16);
+    std::copy(headers.begin(), headers.end(), image.begin());
+
+    image.insert(image.end(), shstrtab.begin(), shstrtab.end());
+    image.resize(section_headers_offset, 0);
+    uint64_t code_begin = header_size + segments_count * segment_header_size;
+    put_section(image, _base_address, 0, 0, 0, 0, 0, 0);
+    put_section(image, _base_address, 1, section_progbits, elf_object::allocated | elf_object::executable, code_begin,
+     text_end - code_begin, 16);
+    put_section(image, _base_address, 7, section_progbits, elf_object::allocated | elf_object::writable, data_begin,
+     data_end - data_begin, 4);
+    put_section(image, _base_address, 13, section_strtab, 0, shstrtab_offset, shstrtab.size(), 1);
+
+    return image;
+}
+
+std::vector<uint8_t> elf_linker::get_shared_library(const std::vector<std::string>& exported, const std::string& soname) const{
+    //the image is loaded at any address and the dynamic linker applies no relocation
+    for(const auto* object : _objects){
+        for(const auto& section : object->get_sections()){
+            if(!is_loaded(section))
+                continue;
+            for(const auto& relocation : section.relocations){
+                if(relocation.type != relocation_type::PC_RELATIVE_32)
+                    throw std::runtime_error("the relocation of " + object->get_symbols()[relocation.symbol].name +
+                     " isn't relative to rip");
+            }
+        }
+    }
+
+    //the names of the exported symbols and of the library, the dynamic symbol 0 is the null symbol
+    std::vector<uint8_t> dynstr(1, 0);
+    std::vector<uint32_t> name_offsets;
+    for(const auto& name : exported){
+        name_offsets.push_back(dynstr.size());
+        dynstr.insert(dynstr.end(), name.begin(), name.end());
+        dynstr.push_back(0);
+    }
+    uint32_t soname_offset = dynstr.size();
+    dynstr.insert(dynstr.end(), soname.begin(), soname.end());
+    dynstr.push_back(0);
+    uint32_t symbols_count = exported.size() + 1;
+    //the tables of the dynamic linker are read-only, they are in the room of the headers before the code
+    uint64_t hash_offset = header_size + shared_segments_count * segment_header_size;
+    uint64_t hash_size = (3 + symbols_count) * 4;
+    uint64_t dynsym_offset = align(hash_offset + hash_size, 8);
+    uint64_t dynstr_offset = dynsym_offset + symbols_count * dynamic_symbol_size;
+    uint64_t code_begin = dynstr_offset + dynstr.size();
+
+    auto linked = link_image(0, code_begin, "");
+    auto& image = linked.bytes;
+    uint64_t text_end = linked.text_end;
+    uint64_t data_begin = linked.data_begin;
+
+    //one bucket: a lookup walks the chain of the few exported symbols, the chain of a symbol is the next one
+    std::vector<uint8_t> tables;
+    put<uint32_t>(tables, 1);
+    put<uint32_t>(tables, symbols_count);
+    put<uint32_t>(tables, symbols_count > 1 ? 1 : 0);
+    for(uint32_t i = 0; i < symbols_count; i++){
+        put<uint32_t>(tables, i == 0 || i + 1 == symbols_count ? 0 : i + 1);
+    }
+    tables.resize(dynsym_offset - hash_offset, 0);
+    tables.resize(tables.size() + dynamic_symbol_size, 0);
+    for(size_t i = 0; i < exported.size(); i++){
+        auto it = linked.globals.find(exported[i]);
+        if(it == linked.globals.end())
+            throw std::runtime_error("undefined exported symbol: " + exported[i]);
+        put<uint32_t>(tables, name_offsets[i]);
+        put<uint8_t>(tables, symbol_global_function);
+        put<uint8_t>(tables, 0);
+        //the section header of the code
+        put<uint16_t>(tables, 4);
+        put<uint64_t>(tables, it->second);
+        put<uint64_t>(tables, 0);
+    }
+    tables.insert(tables.end(), dynstr.begin(), dynstr.end());
+    std::copy(tables.begin(), tables.end(), image.begin() + hash_offset);
+
+    //the dynamic section ends the writable segment, the dynamic linker may write to it
+    uint64_t dynamic_offset = align(image.size(), 8);
+    image.resize(dynamic_offset, 0);
+    for(auto [tag, value] : {std::pair<int64_t, uint64_t>{dynamic_hash, hash_offset}, {dynamic_strtab, dynstr_offset},
+     {dynamic_symtab, dynsym_offset}, {dynamic_strsz, dynstr.size()}, {dynamic_syment, dynamic_symbol_size},
+     {dynamic_soname, soname_offset}, {dynamic_null, 0}}){
+        put<int64_t>(image, tag);
+        put<uint64_t>(image, value);
+    }
+    uint64_t data_end = image.size();
+
+    std::vector<uint8_t> shstrtab(1, 0);
+    std::vector<uint32_t> section_names;
+    for(const char* name : {".hash", ".dynsym", ".dynstr", ".text", ".data", ".dynamic", ".shstrtab"}){
+        section_names.push_back(shstrtab.size());
+        shstrtab.insert(shstrtab.end(), name, name + strlen(name) + 1);
+    }
+    uint64_t shstrtab_offset = data_end;
+    uint64_t section_headers_offset = align(shstrtab_offset + shstrtab.size(), 8);
+
+    std::vector<uint8_t> headers;
+    put_file_header(headers, elf_shared_object, 0, section_headers_offset, shared_segments_count, 8);
+    put_segment(headers, 0, segment_load, segment_readable | segment_executable, 0, text_end, _page_size);
+    put_segment(headers, 0, segment_load, segment_readable | segment_writable, data_begin, data_end - data_begin, _page_size);
+    put_segment(headers, 0, segment_dynamic, segment_readable | segment_writable, dynamic_offset, data_end - dynamic_offset, 8);
+    put_segment(headers, 0, segment_gnu_stack, segment_readable | segment_writable, 0, 0, 16);
+    std::copy(headers.begin(), headers.end(), image.begin());
+
+    image.insert(image.end(), shstrtab.begin(), shstrtab.end());
+    image.resize(section_headers_offset, 0);
+    uint64_t allocated = elf_object::allocated;
+    put_section(image, 0, 0, 0, 0, 0, 0, 0);
+    put_section(image, 0, section_names[0], section_hash, allocated, hash_offset, hash_size, 8, 2, 0, 4);
+    put_section(image, 0, section_names[1], section_dynsym, allocated, dynsym_offset, symbols_count * dynamic_symbol_size, 8,
+     3, 1, dynamic_symbol_size);
+    put_section(image, 0, section_names[2], section_strtab, allocated, dynstr_offset, dynstr.size(), 1);
+    put_section(image, 0, section_names[3], section_progbits, allocated | elf_object::executable, code_begin,
+     text_end - code_begin, 16);
+    put_section(image, 0, section_names[4], section_progbits, allocated | elf_object::writable, data_begin,
+     dynamic_offset - data_begin, 4);
+    put_section(image, 0, section_names[5], section_dynamic, allocated | elf_object::writable, dynamic_offset,
+     data_end - dynamic_offset, 8, 3, 0, dynamic_entry_size);
+    put_section(image, 0, section_names[6], section_strtab, 0, shstrtab_offset, shstrtab.size(), 1);
+
+    return image;
+}
@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class elf_object;
+
+//the linked segments of the objects, the offsets are from the base address
+struct linked_image{
+    //the code and the read-only data up to text_end, the writable data from the page of data_begin to the end
+    std::vector<uint8_t> bytes;
+    uint64_t text_end = 0;
+    uint64_t data_begin = 0;
+    uint64_t entry_address = 0;
+    //the addresses of the global symbols
+    std::unordered_map<std::string, uint64_t> globals;
+};
+
+//a static executable of x86-64 from relocatable objects, without the dynamic linker and the C library:
+//the allocated sections of all objects are put together, the code and the read-only data in one segment,
+//the writable data in another one, and the relocations are applied with the final addresses
+//a shared library is the same image at the address 0 with the tables the dynamic linker looks the exported symbols up in,
+//so its code has to be position independent: it has no relocation for the dynamic linker to apply
+class elf_linker{
+private:
+    //the address of the first segment, the default of ld for the executables that aren't position independent
+    static constexpr uint64_t _base_address = 0x400000;
+    static constexpr uint64_t _page_size = 0x1000;
+
+    std::vector<const elf_object*> _objects;
+private:
+    //the address of every section of every object, 0 for the sections that aren't loaded,
+    //the code starts after the room of the headers
+    std::vector<std::vector<uint64_t>> layout(uint64_t base_address, uint64_t headers_size, uint64_t& text_end,
+     uint64_t& data_begin, uint64_t& data_end) const;
+    linked_image link_image(uint64_t base_address, uint64_t headers_size, const std::string& entry) const;
+public:
+    //the object has to live until the executable is written
+    inline void add_object(const elf_object& object){ _objects.push_back(&object); }
+
+    //the size of the image, it doesn't depend on the base address
+    uint64_t get_image_size() const;
+    //the segments with the relocations applied for the page-aligned base address, the room of the headers is left empty,
+    //throw std::runtime_error like link
+    linked_image link_image(uint64_t base_address, const std::string& entry) const;
+
+    //the executable which starts at the entry symbol, throw std::runtime_error for a symbol that isn't defined
+    //or is defined twice or a relocation that doesn't fit its field
+    std::vector<uint8_t> get_executable(const std::string& entry = "_start") const;
+    //the shared library with the dynamic symbols of the exported functions and the name the programs linked with it
+    //load it by, throw std::runtime_error like get_executable and for a relocation that isn't relative to rip
+    std::vector<uint8_t> get_shared_library(const std::vector<std::string>& exported, const std::string& soname) const;
+};
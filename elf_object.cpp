@@ -0,0 +1,194 @@
+#include <cstring>
+#include "elf_object.h"
+
+namespace{
+
+//the constants of the ELF specification the writer uses
+constexpr uint16_t elf_relocatable = 1;
+constexpr uint16_t elf_machine_x86_64 = 62;
+constexpr uint32_t section_progbits = 1;
+constexpr uint32_t section_symtab = 2;
+constexpr uint32_t section_strtab = 3;
+constexpr uint32_t section_rela = 4;
+constexpr uint64_t section_info_link = 0x40;
+constexpr uint8_t symbol_local = 0;
+constexpr uint8_t symbol_global = 1;
+constexpr uint8_t symbol_notype = 0;
+constexpr uint8_t symbol_section = 3;
+constexpr uint64_t header_size = 64;
+constexpr uint64_t section_header_size = 64;
+constexpr uint64_t symbol_size = 24;
+constexpr uint64_t relocation_size = 24;
+
+//the fields are little-endian like the host
+template<typename T>
+void put(std::vector<uint8_t>& bytes, T value){
+    uint8_t buffer[sizeof(T)];
+    memcpy(buffer, &value, sizeof(T));
+    bytes.insert(bytes.end(), buffer, buffer + sizeof(T));
+}
+
+void align(std::vector<uint8_t>& bytes, uint64_t alignment){
+    while(bytes.size() % alignment != 0){
+        bytes.push_back(0);
+    }
+}
+
+//return the offset of the name in the string table
+uint32_t add_string(std::vector<uint8_t>& table, const std::string& str){
+    uint32_t offset = table.size();
+    table.insert(table.end(), str.begin(), str.end());
+    table.push_back(0);
+    return offset;
+}
+
+struct section_header{
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t alignment;
+    uint64_t entry_size;
+};
+
+}
+
+int elf_object::add_section(const std::string& name, uint64_t flags, uint64_t alignment){
+    int index = _sections.size();
+    _sections.push_back(object_section{name, flags, alignment, {}, {}, static_cast<int>(_symbols.size())});
+    _symbols.push_back(object_symbol{name, index, 0, false, true});
+    return index;
+}
+
+int elf_object::add_symbol(const std::string& name, int section, uint64_t value, bool is_global){
+    _symbols.push_back(object_symbol{name, section, value, is_global, false});
+    return _symbols.size() - 1;
+}
+
+int elf_object::find_section(const std::string& name) const{
+    for(int i = 0; i < static_cast<int>(_sections.size()); i++){
+        if(_sections[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+int elf_object::find_symbol(const std::string& name) const{
+    for(int i = 0; i < static_cast<int>(_symbols.size()); i++){
+        if(!_symbols[i].is_section && _symbols[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+std::vector<uint8_t> elf_object::get_file() const{
+    //the section headers: the null one, the sections, the symbol table, the two string tables and the relocations
+    int sections_count = _sections.size();
+    int symtab_index = sections_count + 1;
+    int strtab_index = sections_count + 2;
+    int shstrtab_index = sections_count + 3;
+
+    //the symbol indices of the file: the null symbol, the local symbols, the global ones
+    auto is_global = [](const object_symbol& symbol){ return symbol.is_global || symbol.section == -1; };
+    std::vector<int> file_order;
+    for(int pass = 0; pass < 2; pass++){
+        for(int i = 0; i < static_cast<int>(_symbols.size()); i++){
+            if(is_global(_symbols[i]) == (pass == 1))
+                file_order.push_back(i);
+        }
+    }
+    std::vector<int> symbol_indices(_symbols.size());
+    int first_global = 1;
+    for(int k = 0; k < static_cast<int>(file_order.size()); k++){
+        symbol_indices[file_order[k]] = k + 1;
+        if(!is_global(_symbols[file_order[k]]))
+            first_global = k + 2;
+    }
+
+    std::vector<uint8_t> strtab(1, 0);
+    std::vector<uint8_t> symtab(symbol_size, 0);
+    for(int i : file_order){
+        const auto& symbol = _symbols[i];
+        put<uint32_t>(symtab, symbol.is_section ? 0 : add_string(strtab, symbol.name));
+        put<uint8_t>(symtab, ((is_global(symbol) ? symbol_global : symbol_local) << 4) | (symbol.is_section ? symbol_section : symbol_notype));
+        put<uint8_t>(symtab, 0);
+        put<uint16_t>(symtab, symbol.section == -1 ? 0 : symbol.section + 1);
+        put<uint64_t>(symtab, symbol.value);
+        put<uint64_t>(symtab, 0);
+    }
+
+    std::vector<uint8_t> shstrtab(1, 0);
+    std::vector<section_header> headers(1, section_header{});
+    std::vector<uint8_t> contents;
+    auto add_contents = [&contents](const std::vector<uint8_t>& bytes, uint64_t alignment){
+        align(contents, alignment);
+        uint64_t offset = header_size + contents.size();
+        contents.insert(contents.end(), bytes.begin(), bytes.end());
+        return offset;
+    };
+    for(const auto& section : _sections){
+        uint64_t offset = add_contents(section.bytes, section.alignment);
+        headers.push_back(section_header{add_string(shstrtab, section.name), section_progbits, section.flags, offset,
+         section.bytes.size(), 0, 0, section.alignment, 0});
+    }
+    headers.push_back(section_header{add_string(shstrtab, ".symtab"), section_symtab, 0, add_contents(symtab, 8),
+     symtab.size(), static_cast<uint32_t>(strtab_index), static_cast<uint32_t>(first_global), 8, symbol_size});
+    headers.push_back(section_header{add_string(shstrtab, ".strtab"), section_strtab, 0, add_contents(strtab, 1),
+     strtab.size(), 0, 0, 1, 0});
+    //the names of the table and of the sections after it are in the table, so they are added before its contents
+    uint32_t shstrtab_name = add_string(shstrtab, ".shstrtab");
+    std::vector<uint32_t> rela_names(sections_count);
+    for(int i = 0; i < sections_count; i++){
+        if(!_sections[i].relocations.empty())
+            rela_names[i] = add_string(shstrtab, ".rela" + _sections[i].name);
+    }
+    headers.push_back(section_header{shstrtab_name, section_strtab, 0, add_contents(shstrtab, 1), shstrtab.size(), 0, 0, 1, 0});
+    for(int i = 0; i < sections_count; i++){
+        const auto& section = _sections[i];
+        if(section.relocations.empty())
+            continue;
+        std::vector<uint8_t> rela;
+        for(const auto& relocation : section.relocations){
+            put<uint64_t>(rela, relocation.offset);
+            put<uint64_t>(rela, (static_cast<uint64_t>(symbol_indices[relocation.symbol]) << 32) | static_cast<uint32_t>(relocation.type));
+            put<int64_t>(rela, relocation.addend);
+        }
+        headers.push_back(section_header{rela_names[i], section_rela, section_info_link, add_contents(rela, 8), rela.size(),
+         static_cast<uint32_t>(symtab_index), static_cast<uint32_t>(i + 1), 8, relocation_size});
+    }
+    align(contents, 8);
+    uint64_t headers_offset = header_size + contents.size();
+
+    std::vector<uint8_t> file{0x7f, 'E', 'L', 'F', 2, 1, 1, 0};
+    file.resize(16, 0);
+    put<uint16_t>(file, elf_relocatable);
+    put<uint16_t>(file, elf_machine_x86_64);
+    put<uint32_t>(file, 1);
+    put<uint64_t>(file, 0);
+    put<uint64_t>(file, 0);
+    put<uint64_t>(file, headers_offset);
+    put<uint32_t>(file, 0);
+    put<uint16_t>(file, header_size);
+    put<uint16_t>(file, 0);
+    put<uint16_t>(file, 0);
+    put<uint16_t>(file, section_header_size);
+    put<uint16_t>(file, headers.size());
+    put<uint16_t>(file, shstrtab_index);
+    file.insert(file.end(), contents.begin(), contents.end());
+    for(const auto& header : headers){
+        put<uint32_t>(file, header.name);
+        put<uint32_t>(file, header.type);
+        put<uint64_t>(file, header.flags);
+        put<uint64_t>(file, 0);
+        put<uint64_t>(file, header.offset);
+        put<uint64_t>(file, header.size);
+        put<uint32_t>(file, header.link);
+        put<uint32_t>(file, header.info);
+        put<uint64_t>(file, header.alignment);
+        put<uint64_t>(file, header.entry_size);
+    }
+    return file;
+}
@@ -0,0 +1,69 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//the relocations of x86-64 the encoder makes, the values are the ELF types
+enum class relocation_type : uint32_t{
+    //the 64-bit address of the symbol: mov rsi, d_fmt
+    ABSOLUTE_64 = 1,
+    //the 32-bit distance from the end of the field: call printf
+    PC_RELATIVE_32 = 2,
+    //the sign-extended 32-bit address: mov rdi, [stdout]
+    ABSOLUTE_32S = 11
+};
+
+//a field of a section the linker fills with the address of a symbol
+struct object_relocation{
+    uint64_t offset;
+    relocation_type type;
+    //the index of the symbol in the object
+    int symbol;
+    int64_t addend;
+};
+
+struct object_section{
+    std::string name;
+    uint64_t flags;
+    uint64_t alignment;
+    std::vector<uint8_t> bytes;
+    std::vector<object_relocation> relocations;
+    //the symbol of the section the relocations of the local labels refer to
+    int symbol;
+};
+
+struct object_symbol{
+    std::string name;
+    //the index of the section, -1 for an undefined symbol
+    int section;
+    uint64_t value;
+    bool is_global;
+    bool is_section;
+};
+
+//a relocatable ELF64 object of x86-64: the sections, their symbols and the relocations of their bytes
+class elf_object{
+public:
+    static constexpr uint64_t writable = 0x1;
+    static constexpr uint64_t allocated = 0x2;
+    static constexpr uint64_t executable = 0x4;
+private:
+    std::vector<object_section> _sections;
+    std::vector<object_symbol> _symbols;
+public:
+    //return the index of the section, a section symbol is added with it
+    int add_section(const std::string& name, uint64_t flags, uint64_t alignment);
+    //return the index of the symbol, the section is -1 for an undefined symbol
+    int add_symbol(const std::string& name, int section, uint64_t value, bool is_global);
+
+    //return -1 if there is no such section or symbol
+    int find_section(const std::string& name) const;
+    int find_symbol(const std::string& name) const;
+
+    inline std::vector<object_section>& get_sections() noexcept{ return _sections; }
+    inline const std::vector<object_section>& get_sections() const noexcept{ return _sections; }
+    inline std::vector<object_symbol>& get_symbols() noexcept{ return _symbols; }
+    inline const std::vector<object_symbol>& get_symbols() const noexcept{ return _symbols; }
+
+    //the bytes of the relocatable file, the local symbols go before the global ones
+    std::vector<uint8_t> get_file() const;
+};
@@ -1,7 +1,9 @@
 #include <iostream>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 #include "enma_compiler.h"
+#include "compile_server.h"
 
 int main(int argc, char* argv[]){
     if(argc == 1){
@@ -13,27 +15,181 @@ int main(int argc, char* argv[]){
         "enma [options] <path-to-source-files>\n" << 
         "Options\n" <<
         "-o <executable-name>\tto specify the executable name\n" <<
-        "-v to output details\n";
+        "-v to output details\n" <<
+        "--profile-generate[=<file>]\tthe executable writes branch counts to the file (<executable-name>.profdata)\n" <<
+        "--profile-use[=<file>]\tlay out the code using the branch counts from the file\n" <<
+        "-O0, -O1, -O2, -Os\tno optimizations, the cheap passes, all passes (default), the passes that don't grow the code\n" <<
+        "--enable-pass=<name>\tadd an optimization pass to the level\n" <<
+        "--disable-pass=<name>\tturn off an optimization pass\n" <<
+        "--pass-stats\tprint the time and the number of changes of every pass\n" <<
+        "-Rpass[=<name>]\tshow what the passes (or the named pass) changed\n" <<
+        "-Rpass-missed[=<name>]\tshow what the passes (or the named pass) considered and didn't change\n" <<
+        "--remarks-file=<file>\twrite all remarks to the file as json lines\n" <<
+        "--eval-steps=<n>\tthe steps the program can be run for at compile time (1000000 by default)\n" <<
+        "--superopt\tsearch shorter instruction sequences for the expressions of the input files and save them\n" <<
+        "--superopt-db=<file>\tthe database of the found sequences (enma.superopt by default)\n" <<
+        "--emit=asm|obj\twrite the assembly and build it with nasm, or encode the object with the built-in encoder (default)\n" <<
+        "--run\tcompile the program in memory and run it, no file is written\n" <<
+        "--backend=native|vm|tiered|baseline|c\tgenerate the machine code (default), run the program with the bytecode interpreter,\n"
+        "\tstart in the interpreter and compile a hot loop with the rest of the program to machine code,\n"
+        "\tcopy the machine code stencils of the nodes without the code generator or write C and build it with cc -O2\n" <<
+        "--osr-threshold=<n>\tthe iterations that make a loop hot for --backend=tiered (1000 by default)\n" <<
+        "--tier-stats\tprint the time of every tier of --backend=tiered\n" <<
+        "--shared\twrite the position independent lib<executable-name>.so with the function <executable-name>_run\n"
+        "\tthat runs the program and its C header <executable-name>.h\n" <<
+        "--server[=<socket>]\tcompile the files the command lines send to the socket ($ENMA_SERVER_SOCKET or /tmp/enma-<uid>.socket)\n"
+        "\tuntil SIGINT or SIGTERM, the command lines of the native and the baseline backend use it when it listens\n" <<
+        "--no-server\tcompile in the process even if a server listens\n" <<
+        "Passes (levels)\n";
+        for(const auto& pass : pass_registry::get_instance().get_passes()){
+            std::cout << "  " << pass.name << " (" << pass.levels << ")\n";
+        }
         return 0;
     }
 
     std::vector<const char*> input_files;
-    int exe_name_idx = -1;
-    bool is_verbose = false;
+    compile_options options;
+    bool is_profile_generate = false;
+    bool is_profile_use = false;
+    bool is_server = false;
+    options.server_socket = compile_server::get_default_socket();
     for(int i = 1; i < argc; i++){
         if(strcmp(argv[i], "-o") == 0){
             if(i + 1 >= argc){
                 std::cerr << "Please, enter the name of the executable.\n";
                 return 1;
             }
-            exe_name_idx = ++i;
+            options.executable_name = argv[++i];
         }else if(strcmp(argv[i], "-v") == 0){
-            is_verbose = true;
+            options.is_verbose = true;
+        }else if(strcmp(argv[i], "--profile-generate") == 0){
+            is_profile_generate = true;
+        }else if(strncmp(argv[i], "--profile-generate=", 19) == 0){
+            is_profile_generate = true;
+            options.profile_generate_file = argv[i] + 19;
+        }else if(strcmp(argv[i], "--profile-use") == 0){
+            is_profile_use = true;
+        }else if(strncmp(argv[i], "--profile-use=", 14) == 0){
+            is_profile_use = true;
+            options.profile_use_file = argv[i] + 14;
+        }else if(strncmp(argv[i], "-O", 2) == 0){
+            if(strlen(argv[i]) != 3 || !pass_manager::is_optimization_level(argv[i][2])){
+                std::cerr << "Unknown optimization level " << argv[i] << ", use -O0, -O1, -O2 or -Os.\n";
+                return 1;
+            }
+            options.optimization_level = argv[i][2];
+        }else if(strncmp(argv[i], "--enable-pass=", 14) == 0 || strncmp(argv[i], "--disable-pass=", 15) == 0){
+            bool is_enable = argv[i][2] == 'e';
+            const char* name = strchr(argv[i], '=') + 1;
+            if(!pass_registry::get_instance().find(name)){
+                std::cerr << "Unknown pass '" << name << "', use --help to show the passes.\n";
+                return 1;
+            }
+            (is_enable ? options.enabled_passes : options.disabled_passes).emplace(name);
+        }else if(strcmp(argv[i], "--pass-stats") == 0){
+            options.is_pass_stats = true;
+        }else if(strcmp(argv[i], "-Rpass") == 0 || strncmp(argv[i], "-Rpass=", 7) == 0){
+            options.applied_remarks.emplace(argv[i][6] == '=' ? argv[i] + 7 : "");
+        }else if(strcmp(argv[i], "-Rpass-missed") == 0 || strncmp(argv[i], "-Rpass-missed=", 14) == 0){
+            options.missed_remarks.emplace(argv[i][13] == '=' ? argv[i] + 14 : "");
+        }else if(strncmp(argv[i], "--remarks-file=", 15) == 0){
+            options.remarks_file = argv[i] + 15;
+        }else if(strncmp(argv[i], "--eval-steps=", 13) == 0){
+            char* end;
+            options.evaluation_steps = std::strtoll(argv[i] + 13, &end, 10);
+            if(end == argv[i] + 13 || *end != '\0' || options.evaluation_steps < 0){
+                std::cerr << "The steps of --eval-steps have to be a number that isn't negative.\n";
+                return 1;
+            }
+        }else if(strcmp(argv[i], "--superopt") == 0){
+            options.is_superopt = true;
+        }else if(strncmp(argv[i], "--superopt-db=", 14) == 0){
+            options.superopt_database = argv[i] + 14;
+        }else if(strncmp(argv[i], "--emit=", 7) == 0){
+            if(strcmp(argv[i] + 7, "asm") != 0 && strcmp(argv[i] + 7, "obj") != 0){
+                std::cerr << "Unknown output " << argv[i] << ", use --emit=asm or --emit=obj.\n";
+                return 1;
+            }
+            options.is_emit_asm = strcmp(argv[i] + 7, "asm") == 0;
+        }else if(strcmp(argv[i], "--run") == 0){
+            options.is_run = true;
+        }else if(strncmp(argv[i], "--backend=", 10) == 0){
+            const char* backend = argv[i] + 10;
+            if(strcmp(backend, "native") != 0 && strcmp(backend, "vm") != 0 && strcmp(backend, "tiered") != 0 &&
+             strcmp(backend, "baseline") != 0 && strcmp(backend, "c") != 0){
+                std::cerr << "Unknown backend " << argv[i] << ", use --backend=native, vm, tiered, baseline or c.\n";
+                return 1;
+            }
+            options.backend = backend;
+        }else if(strncmp(argv[i], "--osr-threshold=", 16) == 0){
+            char* end;
+            options.osr_threshold = std::strtoll(argv[i] + 16, &end, 10);
+            if(end == argv[i] + 16 || *end != '\0' || options.osr_threshold < 1){
+                std::cerr << "The threshold of --osr-threshold has to be a positive number.\n";
+                return 1;
+            }
+        }else if(strcmp(argv[i], "--tier-stats") == 0){
+            options.is_tier_stats = true;
+        }else if(strcmp(argv[i], "--shared") == 0){
+            options.is_shared = true;
+        }else if(strcmp(argv[i], "--server") == 0 || strncmp(argv[i], "--server=", 9) == 0){
+            is_server = true;
+            if(argv[i][8] == '=')
+                options.server_socket = argv[i] + 9;
+        }else if(strcmp(argv[i], "--no-server") == 0){
+            options.server_socket.clear();
         }else{
             input_files.push_back(argv[i]);
         }
     }
-    ENMA_compiler compiler(exe_name_idx == -1 ? "output" : argv[exe_name_idx], is_verbose);
+    if(is_server){
+        //the options of the compilations are the ones of the requests
+        if(!input_files.empty() || options.server_socket.empty()){
+            std::cerr << "--server takes no input files and can't be used with --no-server.\n";
+            return 1;
+        }
+        try{
+            compile_server(options.server_socket).run();
+        }catch(std::runtime_error& err){
+            std::cerr << err.what();
+            return 1;
+        }
+        return 0;
+    }
+    if(is_profile_generate && is_profile_use){
+        std::cerr << "--profile-generate and --profile-use can't be used together.\n";
+        return 1;
+    }
+    if(options.is_run && options.is_emit_asm){
+        std::cerr << "--run and --emit=asm can't be used together.\n";
+        return 1;
+    }
+    if(options.backend == "baseline" && (options.is_emit_asm || is_profile_generate)){
+        std::cerr << "--backend=baseline doesn't generate the assembly, it can't be used with --emit=asm or --profile-generate.\n";
+        return 1;
+    }
+    if(options.backend == "c" && (options.is_run || options.is_emit_asm || is_profile_generate)){
+        std::cerr << "--backend=c builds the executable with the C compiler, it can't be used with --run, --emit=asm "
+         "or --profile-generate.\n";
+        return 1;
+    }
+    if((options.backend == "vm" || options.backend == "tiered") && (options.is_run || options.is_emit_asm || is_profile_generate)){
+        std::cerr << "--backend=" << options.backend << " runs the program itself, it can't be used with --run, --emit=asm "
+         "or --profile-generate.\n";
+        return 1;
+    }
+    if(options.is_shared && (options.backend != "native" || options.is_run || options.is_emit_asm || is_profile_generate)){
+        std::cerr << "--shared links the machine code of --backend=native, it can't be used with another backend, --run, "
+         "--emit=asm or --profile-generate.\n";
+        return 1;
+    }
+    if(is_profile_generate && options.profile_generate_file.empty()){
+        options.profile_generate_file = options.executable_name + ".profdata";
+    }
+    if(is_profile_use && options.profile_use_file.empty()){
+        options.profile_use_file = options.executable_name + ".profdata";
+    }
+    ENMA_compiler compiler(options);
 
     if(compiler.process_input(input_files)){
         return 0;
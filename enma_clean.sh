@@ -1,3 +1,3 @@
 #!/bin/bash
 
-rm -f *.o *.out *.asm output
\ No newline at end of file
+rm -f *.o *.out *.asm *.profdata output
\ No newline at end of file
@@ -2,38 +2,180 @@
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include "enma_compiler.h"
 #include "token_types.h"
 #include "ast.h"
 #include "lexer.h"
 #include "code_generator.h"
+#include "profile.h"
+#include "x86_encoder.h"
+#include "elf_object.h"
+#include "elf_linker.h"
+#include "runtime_library.h"
+#include "jit_engine.h"
+#include "bytecode_compiler.h"
+#include "bytecode_vm.h"
+#include "on_stack_replacement.h"
+#include "baseline_generator.h"
+#include "c_generator.h"
+#include "compile_server.h"
 
-extern std::unique_ptr<symbol_table> global_sym_table;
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
 
-ENMA_compiler::ENMA_compiler(const char* exe_name, bool is_verbose):
- _executable_name(exe_name), _is_verbose(is_verbose){}
+ENMA_compiler::ENMA_compiler(const compile_options& options, std::ostream& errors): _options(options), _errors(&errors),
+ _pass_manager(options.optimization_level, options.enabled_passes, options.disabled_passes, options.is_verbose){
+    _parser.set_error_stream(errors);
+    for(const auto& pass : options.applied_remarks){
+        _remarks.show_applied(pass);
+    }
+    for(const auto& pass : options.missed_remarks){
+        _remarks.show_missed(pass);
+    }
+    //-v says why the loops weren't fused, as before the remarks
+    if(options.is_verbose)
+        _remarks.show_missed("loop-fusion");
+}
 
 ENMA_compiler::~ENMA_compiler(){}
 
+bool ENMA_compiler::open_databases(){
+    try{
+        if(!_options.remarks_file.empty())
+            _remarks.open_json_file(_options.remarks_file);
+        _rewrites.load(_options.superopt_database);
+    }catch(std::runtime_error& err){
+        *_errors << err.what();
+        return false;
+    }
+    return true;
+}
+
+//the statements of the files run in the order of the files, the later files see the variables of the earlier ones
+static void append_statements(std::shared_ptr<statement>& program, std::shared_ptr<statement>& last,
+ const std::shared_ptr<statement>& ast){
+    if(!ast)
+        return;
+    if(last){
+        last->set_next(ast);
+    }else{
+        program = ast;
+    }
+    for(last = ast; last->get_next(); last = last->get_next());
+}
+
+bool ENMA_compiler::compile_sources(const std::vector<source_file>& sources){
+    if(sources.empty()){
+        *_errors << "no input files\n";
+        return false;
+    }
+    if(!open_databases())
+        return false;
+    std::shared_ptr<statement> program;
+    std::shared_ptr<statement> last;
+    int first_line = 0;
+    for(const auto& source : sources){
+        std::shared_ptr<statement> ast;
+        try{
+            auto source_lexer = lexer::from_source(source.text);
+            if(!parse_source(source_lexer, source.name, ast, first_line))
+                return false;
+        }catch(std::runtime_error& err){
+            *_errors << err.what();
+            return false;
+        }
+        append_statements(program, last, ast);
+    }
+    return compile_program(program);
+}
+
 bool ENMA_compiler::process_input(const std::vector<const char*>& args){
     if(args.empty()){
-        std::cerr << "no input files\n";
+        *_errors << "no input files\n";
         return false;
     }
+    bool is_success;
+    if(compile_on_server(args, is_success))
+        return is_success;
+    if(!open_databases())
+        return false;
+    std::shared_ptr<statement> program;
+    std::shared_ptr<statement> last;
+    int first_line = 0;
     for(auto& arg : args){
-        if(!process_input_file(arg)){
+        std::shared_ptr<statement> ast;
+        if(!parse_input_file(arg, ast, first_line)){
             return false;
         }
+        append_statements(program, last, ast);
+    }
+    auto asm_filename = get_asm_filename(args);
+    if(!compile_program(program)){
+        return false;
+    }
+    if(_options.is_pass_stats)
+        _pass_manager.print_stats(std::cout);
+    if(_options.is_superopt){
+        try{
+            _rewrites.save(_options.superopt_database);
+        }catch(std::runtime_error& err){
+            *_errors << err.what();
+            return false;
+        }
+        if(_options.is_verbose)
+            std::cout << _options.superopt_database << ": " << _rewrites.get_size() << " templates\n";
+        return true;
+    }
+    try{
+        write_artifacts(asm_filename);
+    }catch(std::runtime_error& err){
+        *_errors << err.what();
+        return false;
     }
 
-    std::string command = "nasm -f elf64 -o " + _executable_name + ".o ";
-    for(auto i : args){
-        std::string s(i);
-        command += s.substr(0, s.size()-2) + "asm ";
+    if(_options.is_emit_asm){
+        //the assembly is built with the tools, the executable uses the C library
+        std::string command = "nasm -f elf64 -o " + _options.executable_name + ".o " + asm_filename;
+        system(command.c_str());
+        command = "gcc -o " + _options.executable_name + " " + _options.executable_name + ".o -no-pie";
+        system(command.c_str());
+    }
+    if(_options.backend == "c"){
+        std::string command = "cc -O2 -o " + _options.executable_name + " " + c_source_name(asm_filename);
+        if(system(command.c_str()) != 0){
+            *_errors << "the C compiler failed: " << command << '\n';
+            return false;
+        }
+        return true;
+    }
+    if(_bytecode && _options.backend == "tiered"){
+        try{
+            run_tiered();
+        }catch(std::runtime_error& err){
+            *_errors << err.what();
+            return false;
+        }
+        return true;
+    }
+    if(_bytecode){
+        bytecode_vm().run(*_bytecode);
+        return true;
+    }
+    if(_options.is_run){
+        //the program ends the process, so the remarks are written before it starts
+        _remarks.flush();
+        try{
+            jit_engine().run(*_program_object);
+        }catch(std::runtime_error& err){
+            *_errors << err.what();
+            return false;
+        }
     }
-    system(command.c_str());
-    command = "gcc -o " + _executable_name + " " + _executable_name + ".o -no-pie";
-    system(command.c_str());
     return true;
 }
 
@@ -186,7 +328,37 @@ void ENMA_debugger::debug_ast(const class std::shared_ptr<class ast_node>& node)
     }
 }
 
-bool ENMA_compiler::process_input_file(const std::string& filename){
+//the statements of a file are numbered after the lines of the files before it
+static void shift_lines(const std::shared_ptr<statement>& stat, int offset){
+    for(auto node = stat; node; node = node->get_next()){
+        if(node->get_line() != 0)
+            node->set_line(node->get_line() + offset);
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:
+                shift_lines(std::static_pointer_cast<compound_statement>(node)->get_inner_statement(), offset);
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                shift_lines(if_stat->get_if_inner_statement(), offset);
+                shift_lines(if_stat->get_else_inner_statement(), offset);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                shift_lines(std::static_pointer_cast<while_statement>(node)->get_inner_statement(), offset);
+                break;
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                shift_lines(for_stat->get_start_statement(), offset);
+                shift_lines(for_stat->get_inner_statement(), offset);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+bool ENMA_compiler::parse_input_file(const std::string& filename, std::shared_ptr<statement>& ast, int& first_line){
     try{
         bool is_correct_ext = false;
         for(int i = filename.size() - 1; i >= 0; i--){
@@ -201,38 +373,321 @@ bool ENMA_compiler::process_input_file(const std::string& filename){
             throw std::runtime_error(filename + " - input file extension is not recognized.\nPossible extensions - '.em,'\n");
         }
 
+        lexer my_lexer(filename);
+        return parse_source(my_lexer, filename, ast, first_line);
+    }catch(std::runtime_error& err){
+        *_errors << err.what();
+    }
+    return false;
+}
+
+bool ENMA_compiler::read_sources(const std::vector<const char*>& args, std::vector<std::string>& texts){
+    for(const auto& arg : args){
+        if(std::filesystem::path(arg).extension() != ".em")
+            return false;
+        std::ifstream file(arg, std::ios::binary);
+        if(!file.is_open())
+            return false;
+        std::ostringstream text;
+        text << file.rdbuf();
+        texts.push_back(text.str());
+    }
+    return true;
+}
+
+bool ENMA_compiler::compile_on_server(const std::vector<const char*>& args, bool& is_success){
+    if(_options.server_socket.empty() || !compile_client::is_served(_options))
+        return false;
+    std::vector<std::string> texts;
+    if(!read_sources(args, texts))
+        return false;
+    std::vector<source_file> sources;
+    for(size_t i = 0; i < args.size(); i++){
+        sources.push_back({args[i], texts[i]});
+    }
+    compile_result result;
+    if(!compile_client::compile(_options.server_socket, _options, sources, result))
+        return false;
+    *_errors << result.errors;
+    is_success = result.is_success;
+    if(!is_success)
+        return true;
+    _artifacts = std::move(result.artifacts);
+    try{
+        write_artifacts(get_asm_filename(args));
+    }catch(std::runtime_error& err){
+        *_errors << err.what();
+        is_success = false;
+    }
+    return true;
+}
+
+std::string ENMA_compiler::get_asm_filename(const std::vector<const char*>& args) const{
+    std::string single_file(args.front());
+    return args.size() == 1 ? single_file.substr(0, single_file.size() - 2) + "asm" : _options.executable_name + ".asm";
+}
+
+bool ENMA_compiler::parse_source(lexer& source_lexer, const std::string& name, std::shared_ptr<statement>& ast, int& first_line){
+    try{
         bool result;
 
-        lexer my_lexer(filename);
-        if(_is_verbose)
-            std::cout << filename << " - compiling.\n";
-        auto tokens = my_lexer.lexical_analysis();
+        if(_options.is_verbose)
+            std::cout << name << " - compiling.\n";
+        auto tokens = source_lexer.lexical_analysis();
         
-        if(_is_verbose)
+        if(_options.is_verbose)
             ENMA_debugger::debug_tokens(tokens);
 
         token_storage storage(tokens);
-        auto ast = _parser.generate_ast(storage, result);
+        ast = _parser.generate_ast(storage, result);
         if(!result){
             return false;
-        }else if(_is_verbose){
+        }else if(_options.is_verbose){
             auto temp_root = ast;
             ENMA_debugger::debug_ast(temp_root);
             std::cout << '\n';
         }
-        
-        code_generator code_gen(filename.substr(0, filename.size() - 2) + "asm");
-        result = code_gen.generate_code(ast);
 
+        _remarks.add_source_file(name, first_line);
+        shift_lines(ast, first_line);
+        first_line += std::count_if(tokens.begin(), tokens.end(), [](const std::shared_ptr<token>& t){
+            return t->get_type() == token_type::NEW_LINE;
+        });
+        return true;
+    }catch(std::runtime_error& err){
+        *_errors << err.what();
+    }
+    return false;
+}
 
+bool ENMA_compiler::compile_program(std::shared_ptr<statement> ast){
+    try{
+        bool result;
+        if(_options.is_superopt){
+            //the search sees the expressions the way the code generator gets them
+            branch_profile profile(ast);
+            pass_context context{ast, nullptr, &profile, &_remarks};
+            _pass_manager.run(pass_stage::AST, context);
+            int added = superoptimizer(_options.is_verbose).optimize(context.ast, _rewrites);
+            std::cout << added << " sequences added to " << _options.superopt_database << '\n';
+            return true;
+        }
+        code_generator code_gen;
+        code_gen.set_remarks(&_remarks);
+        code_gen.set_error_stream(*_errors);
+        //main of the shared library returns to the entry function, which returns to the caller
+        code_gen.set_returning(_options.is_shared);
+        code_gen.set_position_independent(_options.is_shared);
+        branch_profile profile(ast);
+        if(!_options.profile_generate_file.empty()){
+            //the instrumented executable has to count every branch, so the branches are kept as they are
+            code_gen.instrument_branches(profile, _options.profile_generate_file);
+        }else{
+            bool has_profile = !_options.profile_use_file.empty() && profile.load(_options.profile_use_file, *_errors);
+            if(has_profile){
+                code_gen.use_branch_profile(profile);
+                if(_options.is_verbose)
+                    std::cout << "profile: " << profile.get_branches_count() << " branches\n";
+            }
+            pass_context context{ast, nullptr, &profile, &_remarks};
+            context.evaluation_steps = _options.evaluation_steps;
+            _pass_manager.run(pass_stage::AST, context);
+            ast = context.ast;
+            if(_options.backend == "c"){
+                //the file is compiled with the C compiler like the assembly with nasm
+                _artifacts.c_source = c_generator().generate(ast, context.precomputed_output);
+                return true;
+            }
+            if(_options.backend == "baseline"){
+                //the stencils of the nodes make the object at once, the code generator and its passes aren't run
+                baseline_generator generator;
+                auto start = std::chrono::steady_clock::now();
+                auto object = generator.generate(ast, context.precomputed_output);
+                std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+                if(_options.is_verbose)
+                    std::cout << "baseline: " << generator.get_nodes_count() << " nodes in " << elapsed.count() << " ms\n";
+                output_program(std::move(object));
+                return true;
+            }
+            if(_options.backend != "native"){
+                auto start = std::chrono::steady_clock::now();
+                _bytecode = std::make_unique<bytecode_program>(bytecode_compiler(_options.backend == "tiered").compile(ast,
+                 context.precomputed_output));
+                _bytecode_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if(_options.is_verbose)
+                    std::cout << "bytecode: " << _bytecode->code.size() << " instructions, " << _bytecode->registers_count
+                     << " registers\n";
+                return true;
+            }
+            code_gen.set_precomputed_output(context.precomputed_output);
+            if(_options.optimization_level != '0')
+                code_gen.use_rewrite_database(_rewrites);
+        }
+        result = code_gen.generate_code(ast);
+        if(result && _options.profile_generate_file.empty()){
+            pass_context context{ast, &code_gen.get_program(), &profile, &_remarks};
+            _pass_manager.run(pass_stage::ASSEMBLY, context);
+        }
         if(!result){
             return false;
         }
-        if(_is_verbose)
-            std::cout << "generated " << filename.substr(0, filename.size() - 2) << "asm\n";
+
+        if(_options.is_emit_asm){
+            _artifacts.assembly = code_gen.get_program().to_string();
+            return true;
+        }
+        output_program(x86_encoder().encode(code_gen.get_program()));
         return true;
     }catch(std::runtime_error& err){
-        std::cerr << err.what();
+        *_errors << err.what();
     }
     return false;
-}
\ No newline at end of file
+}
+
+std::string ENMA_compiler::c_source_name(const std::string& asm_filename){
+    return asm_filename.substr(0, asm_filename.size() - 3) + "c";
+}
+
+void ENMA_compiler::output_program(elf_object&& object){
+    if(_options.is_run){
+        _program_object = std::make_unique<elf_object>(std::move(object));
+        return;
+    }
+    _artifacts.object = object.get_file();
+    //the program and the runtime are linked to a static executable, no tool is run
+    const auto& runtime = runtime_library::get_object();
+    elf_linker linker;
+    linker.add_object(object);
+    linker.add_object(runtime);
+    if(_options.is_shared){
+        //the runtime is in the library, so it needs no other library and exports only the entry function
+        auto entry = shared_entry_name(_options.executable_name);
+        auto entry_object = runtime_library::get_entry_object(entry);
+        linker.add_object(entry_object);
+        _artifacts.executable = linker.get_shared_library({entry},
+         std::filesystem::path(shared_library_name(_options.executable_name)).filename().string());
+        _artifacts.header = get_shared_header(entry);
+        return;
+    }
+    _artifacts.executable = linker.get_executable();
+}
+
+//throw std::runtime_error if the file can't be written
+static void write_file(const std::string& filename, std::string_view contents){
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+        throw std::runtime_error("failed to open the file: " + filename + '\n');
+    file.write(contents.data(), contents.size());
+}
+
+static std::string_view as_text(const std::vector<uint8_t>& bytes){
+    return std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void ENMA_compiler::write_artifacts(const std::string& asm_filename) const{
+    if(!_artifacts.assembly.empty()){
+        write_file(asm_filename, _artifacts.assembly);
+        if(_options.is_verbose)
+            std::cout << "generated " << asm_filename << '\n';
+    }
+    if(!_artifacts.c_source.empty()){
+        write_file(c_source_name(asm_filename), _artifacts.c_source);
+        if(_options.is_verbose)
+            std::cout << "generated " << c_source_name(asm_filename) << '\n';
+    }
+    if(_artifacts.executable.empty())
+        return;
+    write_file(_options.executable_name + ".o", as_text(_artifacts.object));
+    if(_options.is_shared){
+        auto library = shared_library_name(_options.executable_name);
+        write_file(library, as_text(_artifacts.executable));
+        write_file(_options.executable_name + ".h", _artifacts.header);
+        if(_options.is_verbose)
+            std::cout << "generated " << _options.executable_name << ".o, " << library << " and " << _options.executable_name << ".h\n";
+        return;
+    }
+    write_file(_options.executable_name, as_text(_artifacts.executable));
+    std::filesystem::permissions(_options.executable_name, std::filesystem::perms::owner_all | std::filesystem::perms::group_read |
+     std::filesystem::perms::group_exec | std::filesystem::perms::others_read | std::filesystem::perms::others_exec);
+    if(_options.is_verbose)
+        std::cout << "generated " << _options.executable_name << ".o and " << _options.executable_name << '\n';
+}
+
+std::string ENMA_compiler::shared_library_name(const std::string& executable_name){
+    auto name = std::filesystem::path(executable_name);
+    return (name.parent_path() / ("lib" + name.filename().string() + ".so")).string();
+}
+
+std::string ENMA_compiler::shared_entry_name(const std::string& executable_name){
+    auto name = std::filesystem::path(executable_name).filename().string();
+    for(char& c : name){
+        if(!isalnum(static_cast<unsigned char>(c)))
+            c = '_';
+    }
+    if(name.empty() || isdigit(static_cast<unsigned char>(name[0])))
+        name = '_' + name;
+    return name + "_run";
+}
+
+std::string ENMA_compiler::get_shared_header(const std::string& entry) const{
+    std::ostringstream header;
+    header << "/* generated by enma, the program of " << std::filesystem::path(shared_library_name(_options.executable_name)).filename().string()
+           << " as a function */\n"
+           << "#pragma once\n\n"
+           << "#ifdef __cplusplus\n"
+           << "extern \"C\" {\n"
+           << "#endif\n\n"
+           << "/* runs the whole program every time it's called: the output is written to the file descriptor 1\n"
+           << "   with write() before the function returns, so flush stdout before the call to keep the order,\n"
+           << "   the variables and the output buffer are in the library, so the calls have to be serialized */\n"
+           << "void " << entry << "(void);\n\n"
+           << "#ifdef __cplusplus\n"
+           << "}\n"
+           << "#endif\n";
+    return header.str();
+}
+
+void ENMA_compiler::run_tiered(){
+    using milliseconds = std::chrono::duration<double, std::milli>;
+    auto start = std::chrono::steady_clock::now();
+    bytecode_vm vm(_options.osr_threshold);
+    int loop = vm.run(*_bytecode);
+    double interpreter_time = milliseconds(std::chrono::steady_clock::now() - start).count();
+    double native_compile_time = 0, native_time = 0;
+    if(loop != -1){
+        //the rest of the program is optimized again, its variables are constants now, but it isn't run at compile time:
+        //the interpreter has printed the output before the loop
+        start = std::chrono::steady_clock::now();
+        auto ast = on_stack_replacement::build_continuation(_bytecode->loops[loop], vm.get_registers());
+        branch_profile profile(ast);
+        pass_context context{ast, nullptr, &profile, &_remarks};
+        context.evaluation_steps = 0;
+        _pass_manager.run(pass_stage::AST, context);
+        code_generator code_gen;
+        code_gen.set_returning(true);
+        if(_options.optimization_level != '0')
+            code_gen.use_rewrite_database(_rewrites);
+        if(!code_gen.generate_code(context.ast))
+            throw std::runtime_error("failed to compile the hot loop\n");
+        pass_context asm_context{context.ast, &code_gen.get_program(), &profile, &_remarks};
+        _pass_manager.run(pass_stage::ASSEMBLY, asm_context);
+        auto object = x86_encoder().encode(code_gen.get_program());
+        native_compile_time = milliseconds(std::chrono::steady_clock::now() - start).count();
+        if(_options.is_verbose)
+            std::cout << "loop " << loop << " is hot, the program goes on in the machine code\n" << std::flush;
+
+        start = std::chrono::steady_clock::now();
+        jit_engine().call(object);
+        fflush(stdout);
+        native_time = milliseconds(std::chrono::steady_clock::now() - start).count();
+    }
+    if(_options.is_tier_stats){
+        std::cerr << std::fixed << std::setprecision(3)
+         << "bytecode compilation: " << _bytecode_time << " ms\n"
+         << "interpreter: " << interpreter_time << " ms\n"
+         << "native compilation: " << native_compile_time << " ms\n"
+         << "native code: " << native_time << " ms\n";
+        if(loop == -1)
+            std::cerr << "no loop reached " << _options.osr_threshold << " iterations\n";
+    }
+}
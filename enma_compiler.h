@@ -1,5 +1,14 @@
+#include <cstdint>
+#include <iostream>
 #include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "libenma.h"
 #include "parser.h"
+#include "pass_manager.h"
+#include "remarks.h"
+#include "superoptimizer.h"
 
 enum class ast_node_type;
 
@@ -13,15 +22,59 @@ public:
 
 class ENMA_compiler{
 private:
-    std::string _executable_name;
+    compile_options _options;
+    //where the errors are reported
+    std::ostream* _errors;
     parser _parser;
-    bool _is_verbose;
+    pass_manager _pass_manager;
+    remark_emitter _remarks;
+    rewrite_database _rewrites;
+    //the encoded program for --run
+    std::unique_ptr<class elf_object> _program_object;
+    //the bytecode for --backend=vm and --backend=tiered
+    std::unique_ptr<struct bytecode_program> _bytecode;
+    //the time of the bytecode compilation for --tier-stats
+    double _bytecode_time = 0;
+    compile_artifacts _artifacts;
 
 private:
-    bool process_input_file(const std::string& filename);
+    //open the remarks file and load the rewrite database, return false for an error
+    bool open_databases();
+    //parse a file into statements numbered after the lines of the files before it, return false for an error
+    bool parse_input_file(const std::string& filename, std::shared_ptr<class statement>& ast, int& first_line);
+    bool parse_source(class lexer& source_lexer, const std::string& name, std::shared_ptr<class statement>& ast, int& first_line);
+    //the files of the command line as the sources of the server, return false if one isn't an .em file or can't be read,
+    //then the files are compiled in the process, which reports it
+    static bool read_sources(const std::vector<const char*>& args, std::vector<std::string>& texts);
+    //send the files to the server and write what it compiled, return false if no server listens on the socket
+    bool compile_on_server(const std::vector<const char*>& args, bool& is_success);
+    //the assembly and the C file of a single file are next to it, the ones of several files are named after the executable
+    std::string get_asm_filename(const std::vector<const char*>& args) const;
+    //optimize and generate the whole program, all the files are one module with one entry point,
+    //link the executable, or keep the assembly with --emit=asm, or keep the object for --run,
+    //or keep the bytecode for --backend=vm, or keep the C file for --backend=c
+    bool compile_program(std::shared_ptr<class statement> ast);
+    //the C file of --backend=c is next to the assembly file
+    static std::string c_source_name(const std::string& asm_filename);
+    //keep the object for --run or link the executable or the shared library, throw std::runtime_error if it can't be linked
+    void output_program(class elf_object&& object);
+    //the artifacts as the files next to the executable, throw std::runtime_error if a file can't be written
+    void write_artifacts(const std::string& asm_filename) const;
+    //lib<name>.so in the directory of the executable
+    static std::string shared_library_name(const std::string& executable_name);
+    //the function of the shared library: <name>_run with the characters of the name a C identifier can't have as '_'
+    static std::string shared_entry_name(const std::string& executable_name);
+    //the declaration of the function for the C and C++ callers
+    std::string get_shared_header(const std::string& entry) const;
+    //run the bytecode until a loop is hot, then compile the rest of the program from the loop and call it
+    void run_tiered();
 public:
-    ENMA_compiler(const char* exe_name, bool is_verbose);
+    ENMA_compiler(const compile_options& options, std::ostream& errors = std::cerr);
     ~ENMA_compiler();
 
+    //compile the files and write the artifacts, or run the program
     bool process_input(const class std::vector<const char*>& args);
+    //compile the sources of the files of one program without writing anything
+    bool compile_sources(const std::vector<source_file>& sources);
+    inline const compile_artifacts& get_artifacts() const noexcept{ return _artifacts; }
 };
\ No newline at end of file
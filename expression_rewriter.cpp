@@ -0,0 +1,377 @@
+#include <climits>
+#include <stdexcept>
+#include "expression_rewriter.h"
+#include "egraph.h"
+#include "pass_manager.h"
+#include "remarks.h"
+#include "parser.h"
+#include "ast.h"
+
+expression_rewriter::expression_rewriter(remark_emitter* remarks) : _remarks(remarks){}
+
+static arithmetical_operation get_arithmetical_operation(ast_node_type type){
+    switch (type){
+        case ast_node_type::ADD: return arithmetical_operation::ADD;
+        case ast_node_type::SUB: return arithmetical_operation::SUB;
+        case ast_node_type::MUL: return arithmetical_operation::MUL;
+        case ast_node_type::DIV: return arithmetical_operation::DIV;
+        case ast_node_type::EQUAL: return arithmetical_operation::EQUAL;
+        case ast_node_type::NEQUAl: return arithmetical_operation::NEQUAL;
+        case ast_node_type::GREATER: return arithmetical_operation::GREATER;
+        case ast_node_type::GREATER_EQ: return arithmetical_operation::GREATER_EQ;
+        case ast_node_type::LESS: return arithmetical_operation::LESS;
+        case ast_node_type::LESS_EQ: return arithmetical_operation::LESS_EQ;
+        default:
+            throw std::runtime_error("undefined binary operation\n");
+    }
+}
+
+//a op b is b swapped_op a
+static ast_node_type get_swapped_comparison(ast_node_type type){
+    switch (type){
+        case ast_node_type::GREATER: return ast_node_type::LESS;
+        case ast_node_type::GREATER_EQ: return ast_node_type::LESS_EQ;
+        case ast_node_type::LESS: return ast_node_type::GREATER;
+        case ast_node_type::LESS_EQ: return ast_node_type::GREATER_EQ;
+        default:
+            return type;
+    }
+}
+
+static bool is_int(int64_t value){
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+int expression_rewriter::get_operation_cost(const enode& node){
+    switch (node.op){
+        case ast_node_type::NUM:
+        case ast_node_type::ID:
+            return _leaf_cost;
+        case ast_node_type::ADD:
+        case ast_node_type::SUB:
+            return _add_cost;
+        case ast_node_type::MUL:
+            return _mul_cost;
+        case ast_node_type::DIV:
+            return _div_cost;
+        default:
+            return _compare_cost;
+    }
+}
+
+int expression_rewriter::get_expression_cost(const std::shared_ptr<expression>& expr){
+    int cost = get_operation_cost(enode{expr->get_type()});
+    if(expr->get_type() != ast_node_type::NUM && expr->get_type() != ast_node_type::ID){
+        const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+        cost += get_expression_cost(bin_expr->get_left()) + get_expression_cost(bin_expr->get_right());
+    }
+    return cost;
+}
+
+int expression_rewriter::add_expression(egraph& graph, const std::shared_ptr<expression>& expr) const{
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            return graph.add(enode{ast_node_type::NUM, std::static_pointer_cast<number_expression>(expr)->get_number()});
+        case ast_node_type::ID:
+            return graph.add(enode{ast_node_type::ID, std::static_pointer_cast<identifier_expression>(expr)->get_id()});
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            int left = add_expression(graph, bin_expr->get_left());
+            int right = add_expression(graph, bin_expr->get_right());
+            return graph.add(enode{expr->get_type(), 0, left, right});
+        }
+    }
+}
+
+bool expression_rewriter::apply_rules(egraph& graph, int id, const enode& node) const{
+    //a class with a known value already has its number
+    if(node.left == -1 || graph.get_constant(id))
+        return false;
+    bool is_changed = false;
+    //over the node limit the rules make nothing: -1 is the missing class
+    auto is_full = [&](){ return graph.get_nodes_count() >= _max_nodes; };
+    auto equal = [&](int other){ is_changed = (other != -1 && graph.merge(id, other)) || is_changed; };
+    auto make = [&](ast_node_type op, int left, int right){
+        return left == -1 || right == -1 || is_full() ? -1 : graph.add(enode{op, 0, left, right});
+    };
+    auto number = [&](int64_t value){ return is_full() ? -1 : graph.add(enode{ast_node_type::NUM, value}); };
+    //a copy, the rules add nodes to the classes
+    auto nodes_of = [&](int class_id){ return graph.get_nodes(graph.find(class_id)); };
+    auto is_same = [&](int left, int right){ return graph.find(left) == graph.find(right); };
+
+    int left = graph.find(node.left);
+    int right = graph.find(node.right);
+    auto right_value = graph.get_constant(right);
+    switch (node.op){
+        case ast_node_type::ADD:
+            equal(make(ast_node_type::ADD, right, left));
+            if(right_value == 0)
+                equal(left);
+            if(left == right)
+                equal(make(ast_node_type::MUL, left, number(2)));
+            for(const auto& l : nodes_of(left)){
+                if(l.op == ast_node_type::ADD){
+                    equal(make(ast_node_type::ADD, l.left, make(ast_node_type::ADD, l.right, right)));
+                }else if(l.op == ast_node_type::SUB){
+                    //(a - b) + b is a
+                    if(is_same(l.right, right))
+                        equal(l.left);
+                    equal(make(ast_node_type::SUB, make(ast_node_type::ADD, l.left, right), l.right));
+                }else if(l.op == ast_node_type::MUL){
+                    //x*a + x is x*(a + 1), x*a + x*b is x*(a + b)
+                    if(is_same(l.left, right))
+                        equal(make(ast_node_type::MUL, right, make(ast_node_type::ADD, l.right, number(1))));
+                    for(const auto& r : nodes_of(right)){
+                        if(r.op == ast_node_type::MUL && is_same(r.left, l.left))
+                            equal(make(ast_node_type::MUL, l.left, make(ast_node_type::ADD, l.right, r.right)));
+                    }
+                }
+            }
+            break;
+        case ast_node_type::SUB:
+            if(left == right)
+                equal(number(0));
+            if(right_value == 0){
+                equal(left);
+            }else if(right_value && is_int(-*right_value)){
+                //the constants are gathered by the rules of the addition
+                equal(make(ast_node_type::ADD, left, number(-*right_value)));
+            }
+            for(const auto& l : nodes_of(left)){
+                if(l.op == ast_node_type::ADD){
+                    //(a + b) - b is a
+                    if(is_same(l.right, right))
+                        equal(l.left);
+                    if(is_same(l.left, right))
+                        equal(l.right);
+                    equal(make(ast_node_type::ADD, l.left, make(ast_node_type::SUB, l.right, right)));
+                }else if(l.op == ast_node_type::SUB){
+                    equal(make(ast_node_type::SUB, l.left, make(ast_node_type::ADD, l.right, right)));
+                }else if(l.op == ast_node_type::MUL){
+                    //x*a - x is x*(a - 1), x*a - x*b is x*(a - b)
+                    if(is_same(l.left, right))
+                        equal(make(ast_node_type::MUL, right, make(ast_node_type::SUB, l.right, number(1))));
+                    for(const auto& r : nodes_of(right)){
+                        if(r.op == ast_node_type::MUL && is_same(r.left, l.left))
+                            equal(make(ast_node_type::MUL, l.left, make(ast_node_type::SUB, l.right, r.right)));
+                    }
+                }
+            }
+            for(const auto& r : nodes_of(right)){
+                //x - x*a is x*(1 - a)
+                if(r.op == ast_node_type::MUL && is_same(r.left, left))
+                    equal(make(ast_node_type::MUL, left, make(ast_node_type::SUB, number(1), r.right)));
+            }
+            break;
+        case ast_node_type::MUL:
+            equal(make(ast_node_type::MUL, right, left));
+            if(right_value == 1)
+                equal(left);
+            //the expression can't fault, so nothing is lost with the dropped operand
+            if(right_value == 0)
+                equal(number(0));
+            for(const auto& l : nodes_of(left)){
+                if(l.op == ast_node_type::MUL){
+                    equal(make(ast_node_type::MUL, l.left, make(ast_node_type::MUL, l.right, right)));
+                }else if(right_value && (l.op == ast_node_type::ADD || l.op == ast_node_type::SUB)){
+                    //only a constant is distributed, so the graph doesn't grow with every product
+                    equal(make(l.op, make(ast_node_type::MUL, l.left, right), make(ast_node_type::MUL, l.right, right)));
+                }
+            }
+            break;
+        case ast_node_type::DIV:{
+            //an expression that can't fault divides only by constants
+            if(!right_value)
+                break;
+            int64_t divisor = *right_value;
+            if(divisor == 1)
+                equal(left);
+            for(const auto& l : nodes_of(left)){
+                if(l.left == -1)
+                    continue;
+                auto factor = graph.get_constant(l.right);
+                if(!factor || graph.get_constant(l.left))
+                    continue;
+                //(x*8)/4 isn't x*2: x*8 wraps around, so it's kept
+                if(l.op == ast_node_type::DIV && *factor > 0 && divisor > 0 && is_int(*factor * divisor)){
+                    //the truncations of both divisions give the truncation of the division by the product
+                    equal(make(ast_node_type::DIV, l.left, number(*factor * divisor)));
+                }
+            }
+            break;
+        }
+        default:{
+            bool is_reflexive = node.op == ast_node_type::EQUAL || node.op == ast_node_type::GREATER_EQ ||
+             node.op == ast_node_type::LESS_EQ;
+            if(left == right)
+                equal(number(is_reflexive ? 1 : 0));
+            equal(make(get_swapped_comparison(node.op), right, left));
+            for(const auto& l : nodes_of(left)){
+                //the addition wraps around, so only an equality can drop the same addend of both sides:
+                //a + c < b + c isn't a < b when one of the sums overflows
+                if(l.op == ast_node_type::ADD && (node.op == ast_node_type::EQUAL || node.op == ast_node_type::NEQUAl)){
+                    //a + c == b + c is a == b
+                    for(const auto& r : nodes_of(right)){
+                        if(r.op == ast_node_type::ADD && is_same(r.right, l.right))
+                            equal(make(node.op, l.left, r.left));
+                    }
+                    auto addend = graph.get_constant(l.right);
+                    if(addend && right_value && is_int(*addend) && is_int(*right_value) && is_int(*right_value - *addend))
+                        equal(make(node.op, l.left, number(*right_value - *addend)));
+                }else if(l.op == ast_node_type::SUB && right_value == 0 &&
+                 (node.op == ast_node_type::EQUAL || node.op == ast_node_type::NEQUAl)){
+                    //a - b == 0 is a == b even if the subtraction wraps around
+                    equal(make(node.op, l.left, l.right));
+                }
+            }
+            break;
+        }
+    }
+    return is_changed;
+}
+
+std::unordered_map<int, std::pair<int, enode>> expression_rewriter::extract(egraph& graph) const{
+    //a node is chosen only when it's cheaper than the chosen one, so its operands are always cheaper than it
+    //and the chosen nodes can't make a cycle
+    std::unordered_map<int, std::pair<int, enode>> best;
+    bool is_changed = true;
+    while(is_changed){
+        is_changed = false;
+        for(int id : graph.get_classes()){
+            for(const auto& node : graph.get_nodes(id)){
+                int cost = get_operation_cost(node);
+                if(node.left != -1){
+                    auto left = best.find(graph.find(node.left));
+                    auto right = best.find(graph.find(node.right));
+                    if(left == best.end() || right == best.end())
+                        continue;
+                    cost += left->second.first + right->second.first;
+                }
+                auto it = best.find(id);
+                if(it == best.end() || cost < it->second.first){
+                    best.insert_or_assign(id, std::pair(cost, node));
+                    is_changed = true;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<expression> expression_rewriter::build_expression(egraph& graph,
+ const std::unordered_map<int, std::pair<int, enode>>& best, int id) const{
+    const auto& node = best.at(graph.find(id)).second;
+    switch (node.op){
+        case ast_node_type::NUM:
+            return std::make_shared<number_expression>(node.value);
+        case ast_node_type::ID:
+            return std::make_shared<identifier_expression>(node.value);
+        default:
+            return std::make_shared<binary_expression>(get_arithmetical_operation(node.op),
+             build_expression(graph, best, node.left), build_expression(graph, best, node.right));
+    }
+}
+
+std::shared_ptr<expression> expression_rewriter::rewrite_expression(const std::shared_ptr<expression>& expr, int line){
+    if(!expr || expr->get_type() == ast_node_type::NUM || expr->get_type() == ast_node_type::ID)
+        return expr;
+    if(can_trap(expr)){
+        //the tree keeps its shape, so it faults the same way, and only its subtrees that can't fault are rewritten
+        const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+        bin_expr->set_left(rewrite_expression(bin_expr->get_left(), line));
+        bin_expr->set_right(rewrite_expression(bin_expr->get_right(), line));
+        return expr;
+    }
+
+    egraph graph;
+    int root = add_expression(graph, expr);
+    for(int i = 0; i < _max_iterations && graph.get_nodes_count() < _max_nodes; i++){
+        //the nodes are matched before the rules add others
+        std::vector<std::pair<int, enode>> matches;
+        for(int id : graph.get_classes()){
+            for(const auto& node : graph.get_nodes(id)){
+                matches.emplace_back(id, node);
+            }
+        }
+        bool is_changed = false;
+        for(const auto& [id, node] : matches){
+            is_changed = apply_rules(graph, id, node) || is_changed;
+            if(graph.get_nodes_count() >= _max_nodes)
+                break;
+        }
+        graph.rebuild();
+        if(!is_changed)
+            break;
+    }
+
+    auto best = extract(graph);
+    int old_cost = get_expression_cost(expr);
+    int new_cost = best.at(graph.find(root)).first;
+    if(new_cost >= old_cost)
+        return expr;
+    _rewritten_count++;
+    if(_remarks)
+        _remarks->emit(remark_kind::APPLIED, "expression-rewriting", line, "the expression is simplified, its cost goes from " +
+         std::to_string(old_cost) + " to " + std::to_string(new_cost) + " cycles");
+    return build_expression(graph, best, root);
+}
+
+void expression_rewriter::rewrite_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        int line = node->get_line();
+        switch (node->get_type()){
+            case ast_node_type::PRINT:{
+                const auto& print_stat = std::static_pointer_cast<print_statement>(node);
+                print_stat->set_expression(rewrite_expression(print_stat->get_expression(), line));
+                break;
+            }
+            case ast_node_type::VAR_DECL:
+            case ast_node_type::ASSIGN:{
+                //an assignment can be without any expression
+                const auto& id_stat = std::static_pointer_cast<statement_with_id>(node);
+                if(id_stat->get_expression())
+                    id_stat->set_expression(rewrite_expression(id_stat->get_expression(), line));
+                break;
+            }
+            case ast_node_type::COMPOUND:
+                rewrite_statements(std::static_pointer_cast<compound_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                if_stat->set_conditional_expression(rewrite_expression(if_stat->get_conditional_expression(), line));
+                rewrite_statements(if_stat->get_if_inner_statement());
+                rewrite_statements(if_stat->get_else_inner_statement());
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:{
+                const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+                while_stat->set_conditional_expression(rewrite_expression(while_stat->get_conditional_expression(), line));
+                rewrite_statements(while_stat->get_inner_statement());
+                break;
+            }
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                const auto& start_stat = for_stat->get_start_statement();
+                if(start_stat->get_expression())
+                    start_stat->set_expression(rewrite_expression(start_stat->get_expression(), line));
+                for_stat->set_final_expression(rewrite_expression(for_stat->get_final_expression(), line));
+                for_stat->set_after_iter_expression(rewrite_expression(for_stat->get_after_iter_expression(), line));
+                rewrite_statements(for_stat->get_inner_statement());
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+int expression_rewriter::rewrite(const std::shared_ptr<statement>& root){
+    _rewritten_count = 0;
+    rewrite_statements(root);
+    return _rewritten_count;
+}
+
+static pass_registration registration({"expression-rewriting", pass_stage::AST, 5, "2s", "expressions simplified",
+ [](pass_context& context){
+    return expression_rewriter(context.remarks).rewrite(context.ast);
+}});
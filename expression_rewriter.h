@@ -0,0 +1,47 @@
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class egraph;
+struct enode;
+
+//simplify the arithmetic with equality saturation: the rules add the equal forms of an expression to an e-graph
+//until nothing new is found or a limit is hit, then the form with the lowest x86-64 latency is chosen
+//the arithmetic wraps around in 64 bits like the generated code, so a rule holds for the values that overflow too:
+//a product isn't divided by a factor of it and only an equality drops the same addend of both sides
+class expression_rewriter{
+private:
+    //a large program doesn't blow up the compile time: the rules stop after these limits
+    static constexpr int _max_iterations = 8;
+    static constexpr int _max_nodes = 2000;
+    //latencies in cycles, the same as the cost model of if-conversion
+    static constexpr int _leaf_cost = 1;
+    static constexpr int _add_cost = 1;
+    static constexpr int _mul_cost = 3;
+    //cmp, setcc, and
+    static constexpr int _compare_cost = 3;
+    static constexpr int _div_cost = 26;
+
+    class remark_emitter* _remarks;
+    int _rewritten_count = 0;
+private:
+    static int get_operation_cost(const enode& node);
+    static int get_expression_cost(const std::shared_ptr<class expression>& expr);
+
+    int add_expression(egraph& graph, const std::shared_ptr<class expression>& expr) const;
+    //add the forms the rules find for the node of the class, return false if nothing is new
+    bool apply_rules(egraph& graph, int id, const enode& node) const;
+    //return the cheapest node of every class with its cost
+    std::unordered_map<int, std::pair<int, enode>> extract(egraph& graph) const;
+    std::shared_ptr<class expression> build_expression(egraph& graph,
+     const std::unordered_map<int, std::pair<int, enode>>& best, int id) const;
+
+    //return the simplified expression or the same one if no cheaper form was found
+    std::shared_ptr<class expression> rewrite_expression(const std::shared_ptr<class expression>& expr, int line);
+    void rewrite_statements(const std::shared_ptr<class statement>& stat);
+public:
+    expression_rewriter(class remark_emitter* remarks = nullptr);
+
+    //return the number of rewritten expressions
+    int rewrite(const std::shared_ptr<class statement>& root);
+};
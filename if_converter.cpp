@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+#include "if_converter.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "remarks.h"
+#include "ast.h"
+
+if_converter::if_converter(const branch_profile* profile, remark_emitter* remarks) : _profile(profile), _remarks(remarks){}
+
+int if_converter::get_expression_cost(const std::shared_ptr<expression>& expr){
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+        case ast_node_type::ID:
+            return 1;
+        case ast_node_type::DIV:{
+            //a speculative division must not trap
+            const auto& divisor = std::static_pointer_cast<binary_expression>(expr)->get_right();
+            if(divisor->get_type() != ast_node_type::NUM){
+                return -1;
+            }
+            int val = std::static_pointer_cast<number_expression>(divisor)->get_number();
+            if(val == 0 || val == -1){
+                return -1;
+            }
+            int left_cost = get_expression_cost(std::static_pointer_cast<binary_expression>(expr)->get_left());
+            return left_cost == -1 ? -1 : left_cost + 26;
+        }
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            int left_cost = get_expression_cost(bin_expr->get_left());
+            int right_cost = get_expression_cost(bin_expr->get_right());
+            if(left_cost == -1 || right_cost == -1){
+                return -1;
+            }
+            int op_cost = 1;
+            if(expr->get_type() == ast_node_type::MUL){
+                op_cost = 3;
+            }else if(expr->get_type() != ast_node_type::ADD && expr->get_type() != ast_node_type::SUB){
+                //cmp, setcc, and
+                op_cost = 3;
+            }
+            return left_cost + right_cost + op_cost;
+        }
+    }
+}
+
+bool if_converter::collect_assignments(const std::shared_ptr<compound_statement>& arm,
+ std::vector<conditional_assignment>& assignments, bool is_if_arm){
+    if(!arm){
+        return true;
+    }
+    std::unordered_set<int> assigned, read;
+    for(auto node = arm->get_inner_statement(); node; node = node->get_next()){
+        //print, declarations and nested control flow have side effects or can't be selected
+        if(node->get_type() != ast_node_type::ASSIGN){
+            return false;
+        }
+        const auto& assign_stat = std::static_pointer_cast<assignment_statement>(node);
+        if(!assign_stat->get_expression()){
+            continue;
+        }
+        if(get_expression_cost(assign_stat->get_expression()) == -1){
+            return false;
+        }
+        //all the values are computed before the stores, so they can't read a variable assigned before in the arm
+        read.clear();
+        collect_variables(assign_stat->get_expression(), read);
+        for(int id : read){
+            if(assigned.contains(id)){
+                return false;
+            }
+        }
+        int id = assign_stat->get_identifier_code();
+        assigned.emplace(id);
+        auto it = std::find_if(assignments.begin(), assignments.end(),
+         [id](const conditional_assignment& assignment){ return assignment.id_code == id; });
+        if(it == assignments.end()){
+            assignments.push_back({id, nullptr, nullptr});
+            it = assignments.end() - 1;
+        }
+        auto& expr = is_if_arm ? it->if_expr : it->else_expr;
+        //the variable is assigned twice in the same arm
+        if(expr){
+            return false;
+        }
+        expr = assign_stat->get_expression();
+    }
+    return true;
+}
+
+bool if_converter::is_profitable(const if_statement* stat, const std::vector<conditional_assignment>& assignments, std::string& reason) const{
+    //both values of every variable are computed, a missing one is loaded from the variable
+    int if_cost = 0, else_cost = 0, values_cost = 0;
+    for(const auto& assignment : assignments){
+        int if_expr_cost = assignment.if_expr ? get_expression_cost(assignment.if_expr) : 0;
+        int else_expr_cost = assignment.else_expr ? get_expression_cost(assignment.else_expr) : 0;
+        if_cost += if_expr_cost;
+        else_cost += else_expr_cost;
+        values_cost += std::max(if_expr_cost, 1) + std::max(else_expr_cost, 1);
+    }
+    //test and cmov for every variable
+    double branchless_cost = values_cost / _parallel_arms_speedup + assignments.size() * 2;
+
+    double taken_rate = 0.5;
+    double mispredict_rate = _unknown_mispredict_rate;
+    if(_profile && _profile->has_counts()){
+        uint64_t taken = _profile->get_taken_count(stat);
+        uint64_t not_taken = _profile->get_not_taken_count(stat);
+        if(taken + not_taken > 0){
+            taken_rate = static_cast<double>(taken) / (taken + not_taken);
+            //a biased branch is predicted well, a random one is mispredicted as often as the rarer arm is taken
+            mispredict_rate = std::min(taken_rate, 1.0 - taken_rate);
+        }
+    }
+    double branch_cost = taken_rate * if_cost + (1.0 - taken_rate) * else_cost + 1.0 + mispredict_rate * _mispredict_penalty;
+    if(branchless_cost <= branch_cost)
+        return true;
+    std::ostringstream costs;
+    costs << std::fixed << std::setprecision(1) << "the branch is cheaper: " << branch_cost
+     << " cycles against " << branchless_cost << " of the conditional moves";
+    reason = costs.str();
+    return false;
+}
+
+std::vector<if_converter::conditional_assignment> if_converter::get_conditional_assignments(const if_statement* stat){
+    std::vector<conditional_assignment> assignments;
+    if(!collect_assignments(stat->get_if_inner_statement(), assignments, true) ||
+     !collect_assignments(stat->get_else_inner_statement(), assignments, false) ||
+     assignments.size() > _max_assignments_count){
+        return {};
+    }
+
+    //a variable is stored after all the values that read it are computed
+    std::vector<std::unordered_set<int>> reads(assignments.size());
+    for(size_t i = 0; i < assignments.size(); i++){
+        collect_variables(assignments[i].if_expr, reads[i]);
+        collect_variables(assignments[i].else_expr, reads[i]);
+    }
+    std::vector<conditional_assignment> ordered;
+    std::vector<bool> is_ordered(assignments.size(), false);
+    while(ordered.size() < assignments.size()){
+        int next = -1;
+        for(size_t i = 0; i < assignments.size() && next == -1; i++){
+            if(is_ordered[i]){
+                continue;
+            }
+            next = i;
+            for(size_t j = 0; j < assignments.size(); j++){
+                if(j != i && !is_ordered[j] && reads[j].contains(assignments[i].id_code)){
+                    next = -1;
+                    break;
+                }
+            }
+        }
+        //the variables read each other, it needs temporary storage
+        if(next == -1){
+            return {};
+        }
+        is_ordered[next] = true;
+        ordered.push_back(assignments[next]);
+    }
+    return ordered;
+}
+
+void if_converter::convert_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:
+                convert_statements(std::static_pointer_cast<compound_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                auto assignments = get_conditional_assignments(if_stat.get());
+                std::string reason = "the arms don't only assign variables";
+                if(!assignments.empty() && is_profitable(if_stat.get(), assignments, reason)){
+                    if_stat->set_branchless(true);
+                    _converted_count++;
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "if-conversion", if_stat->get_line(), "the if is generated with conditional moves");
+                }else{
+                    if(_remarks)
+                        _remarks->emit(remark_kind::MISSED, "if-conversion", if_stat->get_line(), "the if stays a branch - " + reason);
+                    convert_statements(if_stat->get_if_inner_statement());
+                    convert_statements(if_stat->get_else_inner_statement());
+                }
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                convert_statements(std::static_pointer_cast<while_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::FOR_LOOP:
+                convert_statements(std::static_pointer_cast<for_statement>(node)->get_inner_statement());
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int if_converter::convert(const std::shared_ptr<statement>& root){
+    _converted_count = 0;
+    convert_statements(root);
+    return _converted_count;
+}
+
+static pass_registration registration({"if-conversion", pass_stage::AST, 40, "12s", "if statements converted",
+ [](pass_context& context){
+    return if_converter(context.profile, context.remarks).convert(context.ast);
+}});
@@ -0,0 +1,44 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+//mark small if statements whose arms only assign variables to be generated with conditional moves
+//both arms are computed and the result is chosen with cmov, so a data-dependent condition can't be mispredicted
+class if_converter{
+public:
+    //a variable gets the value of the if arm or the else arm, a missing value keeps the variable as it is
+    struct conditional_assignment{
+        int id_code;
+        std::shared_ptr<class expression> if_expr;
+        std::shared_ptr<class expression> else_expr;
+    };
+private:
+    //cycles lost on a mispredicted branch
+    static constexpr double _mispredict_penalty = 16.0;
+    //misprediction rate of a branch without a profile
+    static constexpr double _unknown_mispredict_rate = 0.25;
+    //both arms are independent of each other, so their instructions are executed in parallel
+    static constexpr double _parallel_arms_speedup = 2.0;
+    static constexpr int _max_assignments_count = 4;
+
+    const class branch_profile* _profile;
+    class remark_emitter* _remarks;
+    int _converted_count = 0;
+private:
+    //return -1 if the expression can't be computed speculatively
+    static int get_expression_cost(const std::shared_ptr<class expression>& expr);
+    static bool collect_assignments(const std::shared_ptr<class compound_statement>& arm,
+     std::vector<conditional_assignment>& assignments, bool is_if_arm);
+    //the reason tells the costs if it isn't
+    bool is_profitable(const class if_statement* stat, const std::vector<conditional_assignment>& assignments, std::string& reason) const;
+    void convert_statements(const std::shared_ptr<class statement>& stat);
+public:
+    if_converter(const class branch_profile* profile = nullptr, class remark_emitter* remarks = nullptr);
+
+    //return the assignments of both arms in the order their stores have to be done,
+    //so no value reads a variable that is already stored; empty if the statement can't be converted
+    static std::vector<conditional_assignment> get_conditional_assignments(const class if_statement* stat);
+
+    //return the number of converted if statements
+    int convert(const std::shared_ptr<class statement>& root);
+};
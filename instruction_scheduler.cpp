@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include "instruction_scheduler.h"
+#include "pass_manager.h"
+#include "dataflow.h"
+#include "remarks.h"
+
+namespace{
+
+constexpr unsigned port(int number){
+    return 1u << number;
+}
+constexpr unsigned alu_ports = port(0) | port(1) | port(5) | port(6);
+constexpr unsigned shift_ports = port(0) | port(6);
+constexpr unsigned lea_ports = port(1) | port(5);
+constexpr unsigned load_ports = port(2) | port(3);
+constexpr unsigned store_ports = port(4);
+constexpr int ports_count = 8;
+
+}
+
+instruction_scheduler::instruction_scheduler(remark_emitter* remarks) : _remarks(remarks){}
+
+instruction_scheduler::instruction_timing instruction_scheduler::get_timing(const asm_line& line){
+    const auto& opcode = line.opcode;
+    const auto& ops = line.operands;
+    bool is_store = !ops.empty() && asm_program::is_memory_operand(ops[0]);
+    bool is_load = opcode != "lea" && std::any_of(ops.begin() + std::min<size_t>(1, ops.size()), ops.end(), asm_program::is_memory_operand);
+    //an operation on a memory operand waits for the load first
+    int load_latency = is_load ? _load_latency : 0;
+
+    if((opcode == "mov" || opcode == "movzx") && is_store)
+        return {_alu_latency, store_ports};
+    if((opcode == "mov" || opcode == "movzx") && is_load)
+        return {_load_latency, load_ports};
+    if(opcode == "imul")
+        return {_mul_latency + load_latency, port(1)};
+    if(opcode == "idiv")
+        return {_div_latency, port(0), _div_latency};
+    if(opcode == "lea")
+        return {_alu_latency, lea_ports};
+    if(opcode == "shl" || opcode == "sar" || opcode == "shr" || opcode == "cqo" || opcode.starts_with("set") || opcode.starts_with("cmov"))
+        return {_alu_latency + load_latency, shift_ports};
+    return {_alu_latency + load_latency, alu_ports};
+}
+
+bool instruction_scheduler::is_barrier(const asm_line& line){
+    auto effects = get_instruction_effects(line);
+    //a division can fault, but only the registers see when, so it's moved like the other instructions
+    if(effects.is_unknown || (effects.has_side_effects && line.opcode != "idiv"))
+        return true;
+    //the analysis doesn't know the registers of an address like [r8 + 8]
+    if(line.opcode == "lea")
+        return false;
+    return std::any_of(line.operands.begin(), line.operands.end(), [](const std::string& operand){
+        return asm_program::is_memory_operand(operand) && asm_program::get_memory_symbol(operand).empty();
+    });
+}
+
+int instruction_scheduler::simulate(const std::vector<schedule_node>& nodes, const std::vector<int>& order){
+    std::vector<int> issue_cycles(nodes.size(), 0);
+    std::array<int, ports_count> busy_until{};
+    int cycle = 0;
+    int issued_count = 0;
+    int end = 0;
+    for(int k : order){
+        const auto& node = nodes[k];
+        int earliest = cycle;
+        for(auto [predecessor, latency] : node.predecessors){
+            earliest = std::max(earliest, issue_cycles[predecessor] + latency);
+        }
+        //the instructions issue in the order, so an instruction waits for the previous ones
+        while(true){
+            if(earliest > cycle){
+                cycle = earliest;
+                issued_count = 0;
+            }
+            if(issued_count < _issue_width){
+                int free_port = -1;
+                for(int p = 0; p < ports_count && free_port == -1; p++){
+                    if((node.timing.ports & port(p)) && busy_until[p] <= cycle)
+                        free_port = p;
+                }
+                if(free_port != -1){
+                    busy_until[free_port] = cycle + node.timing.occupancy;
+                    break;
+                }
+            }
+            earliest = cycle + 1;
+        }
+        issue_cycles[k] = cycle;
+        issued_count++;
+        end = std::max(end, cycle + node.timing.latency);
+    }
+    return end;
+}
+
+std::vector<instruction_scheduler::schedule_node> instruction_scheduler::build_dependences(const asm_program& program,
+ const std::vector<int>& region, const std::vector<bool>& flags_live){
+    const auto& lines = program.get_lines();
+    int nodes_count = region.size();
+    std::vector<schedule_node> nodes(nodes_count);
+    auto add_edge = [&nodes](int from, int to, int latency){
+        if(from == to)
+            return;
+        nodes[to].predecessors.emplace_back(from, latency);
+        nodes[from].successors.push_back(to);
+    };
+
+    //the registers and the variables: a read follows the write, a write follows the reads and the write before it
+    std::unordered_map<std::string, int> last_defs;
+    std::unordered_map<std::string, std::vector<int>> uses_since_def;
+    std::vector<int> flags_defs;
+    std::vector<int> flags_uses;
+    for(int k = 0; k < nodes_count; k++){
+        nodes[k].line = region[k];
+        nodes[k].timing = get_timing(lines[region[k]]);
+        auto effects = get_instruction_effects(lines[region[k]]);
+        for(const auto& location : effects.uses){
+            if(location == "flags"){
+                flags_uses.push_back(k);
+                continue;
+            }
+            if(last_defs.contains(location))
+                add_edge(last_defs[location], k, nodes[last_defs[location]].timing.latency);
+            uses_since_def[location].push_back(k);
+        }
+        for(const auto& location : effects.defs){
+            if(location == "flags"){
+                flags_defs.push_back(k);
+                continue;
+            }
+            if(last_defs.contains(location))
+                add_edge(last_defs[location], k, 0);
+            for(int use : uses_since_def[location]){
+                add_edge(use, k, 0);
+            }
+            last_defs[location] = k;
+            uses_since_def[location].clear();
+        }
+    }
+
+    //almost every instruction writes the flags, only the writes somebody reads keep their place:
+    //the other writes go before such a write or after its reads
+    for(int def : flags_defs){
+        if(!flags_live[region[def]])
+            continue;
+        for(int other : flags_defs){
+            if(other < def)
+                add_edge(other, def, 0);
+        }
+    }
+    for(int use : flags_uses){
+        int reaching_def = -1;
+        for(int def : flags_defs){
+            if(def < use)
+                reaching_def = def;
+        }
+        if(reaching_def != -1)
+            add_edge(reaching_def, use, nodes[reaching_def].timing.latency);
+        for(int other : flags_defs){
+            if(other > use)
+                add_edge(use, other, 0);
+        }
+    }
+
+    for(int k = nodes_count - 1; k >= 0; k--){
+        nodes[k].height = std::max(nodes[k].height, nodes[k].timing.latency);
+        for(auto [predecessor, latency] : nodes[k].predecessors){
+            nodes[predecessor].height = std::max(nodes[predecessor].height, latency + nodes[k].height);
+        }
+    }
+    return nodes;
+}
+
+std::vector<int> instruction_scheduler::list_schedule(const std::vector<schedule_node>& nodes){
+    int nodes_count = nodes.size();
+    std::vector<int> issue_cycles(nodes_count, -1);
+    std::array<int, ports_count> busy_until{};
+    std::vector<int> order;
+    for(int cycle = 0; static_cast<int>(order.size()) < nodes_count; cycle++){
+        int issued_count = 0;
+        while(issued_count < _issue_width){
+            //the ready instruction on the longest path goes first, the earlier one of the same height
+            int best = -1;
+            int best_port = -1;
+            for(int k = 0; k < nodes_count; k++){
+                if(issue_cycles[k] != -1 || (best != -1 && nodes[k].height <= nodes[best].height))
+                    continue;
+                bool is_ready = std::all_of(nodes[k].predecessors.begin(), nodes[k].predecessors.end(), [&](const auto& edge){
+                    return issue_cycles[edge.first] != -1 && issue_cycles[edge.first] + edge.second <= cycle;
+                });
+                if(!is_ready)
+                    continue;
+                for(int p = 0; p < ports_count; p++){
+                    if((nodes[k].timing.ports & port(p)) && busy_until[p] <= cycle){
+                        best = k;
+                        best_port = p;
+                        break;
+                    }
+                }
+            }
+            if(best == -1)
+                break;
+            issue_cycles[best] = cycle;
+            busy_until[best_port] = cycle + nodes[best].timing.occupancy;
+            order.push_back(best);
+            issued_count++;
+        }
+    }
+    return order;
+}
+
+int instruction_scheduler::schedule(asm_program& program) const{
+    auto& lines = program.get_lines();
+    auto blocks = program.build_cfg();
+    auto liveness = compute_liveness(program, blocks);
+
+    int scheduled_count = 0;
+    for(int b = 0; b < static_cast<int>(blocks.size()); b++){
+        const auto& block = blocks[b];
+        //the flags read after every instruction of the block
+        std::vector<bool> flags_live(lines.size(), false);
+        auto live = liveness.out[b];
+        for(int i = block.end - 1; i >= block.begin; i--){
+            if(!lines[i].is_instruction())
+                continue;
+            flags_live[i] = live.contains("flags");
+            auto effects = get_instruction_effects(lines[i]);
+            for(const auto& location : effects.defs){
+                live.erase(location);
+            }
+            live.insert(effects.uses.begin(), effects.uses.end());
+        }
+
+        //the regions between the barriers are scheduled one by one, the other lines stay in their places
+        std::vector<int> region;
+        for(int i = block.begin; i <= block.end; i++){
+            bool is_region_end = i == block.end || (lines[i].is_instruction() && is_barrier(lines[i]));
+            if(!is_region_end){
+                if(lines[i].is_instruction())
+                    region.push_back(i);
+                continue;
+            }
+            if(region.size() >= 3){
+                auto nodes = build_dependences(program, region, flags_live);
+                std::vector<int> original_order(nodes.size());
+                for(int k = 0; k < static_cast<int>(nodes.size()); k++){
+                    original_order[k] = k;
+                }
+                auto order = list_schedule(nodes);
+                int original_cycles = simulate(nodes, original_order);
+                int scheduled_cycles = simulate(nodes, order);
+                if(scheduled_cycles + _min_gain <= original_cycles){
+                    std::vector<asm_line> region_lines;
+                    for(int k : order){
+                        region_lines.push_back(lines[nodes[k].line]);
+                    }
+                    for(int k = 0; k < static_cast<int>(region.size()); k++){
+                        lines[region[k]] = std::move(region_lines[k]);
+                    }
+                    scheduled_count++;
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "instruction-scheduling", lines[region.front()].source_line,
+                         std::to_string(region.size()) + " instructions are reordered to hide the latencies, " +
+                         std::to_string(original_cycles) + " -> " + std::to_string(scheduled_cycles) + " cycles");
+                }
+            }
+            region.clear();
+        }
+    }
+    return scheduled_count;
+}
+
+//the reordered blocks have fewer identical tails to merge, so -Os keeps the order of the code generator
+static pass_registration scheduling_registration({"instruction-scheduling", pass_stage::ASSEMBLY, 45, "2", "regions scheduled",
+ [](pass_context& context){
+    return instruction_scheduler(context.remarks).schedule(*context.program);
+}});
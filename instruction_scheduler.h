@@ -0,0 +1,58 @@
+#include <string>
+#include <vector>
+
+class asm_program;
+class remark_emitter;
+struct asm_line;
+
+//list scheduling of the instructions of every basic block with a latency and port model of x86-64:
+//the independent instructions are moved between a multiplication or a division and its use
+//the registers stay as the code generator has allocated them, so the order can't need more registers than it has
+class instruction_scheduler{
+private:
+    //the instructions issued in a cycle
+    static constexpr int _issue_width = 4;
+    //latencies in cycles, the same as the cost model of if-conversion
+    static constexpr int _alu_latency = 1;
+    static constexpr int _mul_latency = 3;
+    static constexpr int _div_latency = 26;
+    static constexpr int _load_latency = 4;
+    //a block is reordered only if it gets faster by this many cycles
+    static constexpr int _min_gain = 1;
+
+    //the ports are bits of a mask: 0, 1, 5, 6 compute, 2, 3 load, 4 stores
+    struct instruction_timing{
+        int latency;
+        unsigned ports;
+        //the cycles the port is busy, the divider isn't pipelined
+        int occupancy = 1;
+    };
+    //an instruction of a scheduling region and the instructions it has to follow
+    struct schedule_node{
+        int line;
+        instruction_timing timing;
+        //the instruction index in the region and the cycles its result takes
+        std::vector<std::pair<int, int>> predecessors;
+        std::vector<int> successors;
+        //the longest latency path to the end of the region
+        int height = 0;
+    };
+
+    remark_emitter* _remarks;
+private:
+    static instruction_timing get_timing(const asm_line& line);
+    //the instructions that can't be moved: calls, jumps, stack operations, stores through registers
+    static bool is_barrier(const asm_line& line);
+
+    //the cycles of the region issued in the order
+    static int simulate(const std::vector<schedule_node>& nodes, const std::vector<int>& order);
+    //flags_live[i] tells if the flags written by the instruction i are read later
+    static std::vector<schedule_node> build_dependences(const asm_program& program, const std::vector<int>& region,
+     const std::vector<bool>& flags_live);
+    static std::vector<int> list_schedule(const std::vector<schedule_node>& nodes);
+public:
+    instruction_scheduler(remark_emitter* remarks = nullptr);
+
+    //return the number of reordered regions
+    int schedule(asm_program& program) const;
+};
@@ -0,0 +1,76 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "jit_engine.h"
+#include "asm_program.h"
+#include "x86_encoder.h"
+#include "elf_object.h"
+#include "elf_linker.h"
+#include "runtime_library.h"
+
+elf_object jit_engine::get_imports(){
+    //r11 is free at a call, like in the stubs of the dynamic linker
+    std::ostringstream code;
+    code << "section .note.GNU-stack\n"
+         << "section .text\n"
+         << "\textern main\n"
+         << "\tglobal printf\n"
+         << "\tglobal fflush\n"
+         << "\tglobal fwrite\n"
+         << "\tglobal stdout\n"
+         << "printf:\n"
+         << "\tmov r11, " << reinterpret_cast<uint64_t>(&printf) << '\n'
+         << "\tjmp r11\n"
+         << "fflush:\n"
+         << "\tmov r11, " << reinterpret_cast<uint64_t>(&fflush) << '\n'
+         << "\tjmp r11\n"
+         << "fwrite:\n"
+         << "\tmov r11, " << reinterpret_cast<uint64_t>(&fwrite) << '\n'
+         << "\tjmp r11\n"
+         << runtime_library::get_entry_code("_ENMA_CALL_MAIN")
+         << "section .data\n"
+         << "\tstdout dq " << reinterpret_cast<uint64_t>(stdout) << '\n';
+    return x86_encoder().encode(asm_program(code.str()));
+}
+
+uint64_t jit_engine::load(const elf_object& program, const std::string& entry, void*& memory, uint64_t& size){
+    auto imports = get_imports();
+    elf_linker linker;
+    linker.add_object(program);
+    linker.add_object(imports);
+    size = linker.get_image_size();
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if(memory == MAP_FAILED)
+        throw std::runtime_error(std::string("failed to map the memory of the program: ") + strerror(errno) + '\n');
+    auto image = linker.link_image(reinterpret_cast<uint64_t>(memory), entry);
+    memcpy(memory, image.bytes.data(), image.bytes.size());
+    if(mprotect(memory, image.data_begin, PROT_READ | PROT_EXEC) != 0)
+        throw std::runtime_error(std::string("failed to make the code executable: ") + strerror(errno) + '\n');
+    return image.entry_address;
+}
+
+void jit_engine::run(const elf_object& program) const{
+    void* memory;
+    uint64_t size;
+    uint64_t entry = load(program, "main", memory, size);
+    //the output of the compiler goes before the output of the program
+    std::cout.flush();
+    fflush(stdout);
+    reinterpret_cast<void (*)()>(entry)();
+    std::abort();
+}
+
+void jit_engine::call(const elf_object& program) const{
+    void* memory;
+    uint64_t size;
+    uint64_t entry = load(program, "_ENMA_CALL_MAIN", memory, size);
+    std::cout.flush();
+    fflush(stdout);
+    reinterpret_cast<void (*)()>(entry)();
+    munmap(memory, size);
+}
@@ -0,0 +1,23 @@
+#include <cstdint>
+#include <string>
+
+class elf_object;
+
+//runs the program in the compiler process without writing an executable: the object is linked at the address
+//of a mapping in the first 2GB, because the generated code addresses its variables with sign-extended 32-bit fields,
+//and the calls of the runtime go to the functions of the compiler process
+//the mapping is writable while the image is copied, then the code is made executable and isn't writable anymore
+class jit_engine{
+private:
+    //printf and fflush jump to the functions of the process, stdout is a copy of the FILE* of the process,
+    //_ENMA_CALL_MAIN saves the registers the generated code uses and the C++ caller keeps
+    static elf_object get_imports();
+    //link the program with the imports in a new mapping, return the address of the entry symbol and the mapping
+    static uint64_t load(const elf_object& program, const std::string& entry, void*& memory, uint64_t& size);
+public:
+    //main ends the process with the exit syscall, so it returns only by throwing std::runtime_error
+    //for an image that can't be linked or mapped
+    [[noreturn]] void run(const elf_object& program) const;
+    //call main of the code generated with code_generator::set_returning, the mapping is removed after it returns
+    void call(const elf_object& program) const;
+};
@@ -7,7 +7,8 @@ const std::unordered_set<std::string> lexer::_keywords = {
         "let", "return," "if", "for", "while"
     };
 
-std::unique_ptr<symbol_table> global_sym_table = std::make_unique<symbol_table>();
+//every thread has its own identifiers, a compilation uses the ones of the thread it runs on
+thread_local std::unique_ptr<symbol_table> global_sym_table = std::make_unique<symbol_table>();
 
 int lexer::read_number(const std::string& line, int& idx, bool is_negative) const noexcept{
     int num = 0;
@@ -195,24 +196,29 @@ void lexer::process_line(const std::string& line){
     }
 }
 
-lexer::lexer(const std::string& input_file) : _file(input_file){
-    if(!_file.is_open()){
-        _file.close();
+lexer::lexer(const std::string& input_file){
+    std::ifstream file(input_file);
+    if(!file.is_open()){
         throw std::runtime_error(input_file + " - failed to open,\n");
     }
-
+    std::ostringstream source;
+    source << file.rdbuf();
+    _input.str(source.str());
 }
-lexer::~lexer(){
-    _file.close();
+
+lexer lexer::from_source(std::string_view source){
+    lexer source_lexer;
+    source_lexer._input.str(std::string(source));
+    return source_lexer;
 }
 
 std::list<std::shared_ptr<token>> lexer::lexical_analysis(){
     _tokens.clear();
 
 
-    while(!_file.eof()){
+    while(!_input.eof()){
         std::string code_line;
-        std::getline(_file, code_line);
+        std::getline(_input, code_line);
         process_line(code_line);
         _tokens.emplace_back(std::make_shared<token_new_line>());
     }
@@ -2,6 +2,8 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <fstream>
+#include <sstream>
+#include <string_view>
 
 class symbol_table{
 private:
@@ -42,7 +44,8 @@ public:
 class lexer{
 private:
     static const std::unordered_set<std::string> _keywords;
-    std::ifstream _file;
+    //the whole source, read from the file or given in memory
+    std::istringstream _input;
     std::list<class std::shared_ptr<class token>> _tokens;
 
     int read_number(const std::string& line, int& idx, bool is_negative) const noexcept;
@@ -51,9 +54,12 @@ private:
     void emplace_identifier(const std::string& line, int& idx) noexcept;
 
     void process_line(const std::string& line);
+    lexer() = default;
 public:
+    //throw std::runtime_error if the file can't be read
     lexer(const std::string& input_file);
-    ~lexer();
+    //the source of a program that isn't a file
+    static lexer from_source(std::string_view source);
 
     std::list<class std::shared_ptr<class token>> lexical_analysis();
 };
\ No newline at end of file
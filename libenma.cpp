@@ -0,0 +1,59 @@
+#include <sstream>
+#include <stdexcept>
+#include "libenma.h"
+#include "enma_compiler.h"
+#include "lexer.h"
+
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
+
+namespace{
+
+//the table of the context is the one of the thread while the context compiles
+class symbol_table_scope{
+private:
+    std::unique_ptr<symbol_table>& _symbols;
+public:
+    symbol_table_scope(std::unique_ptr<symbol_table>& symbols) : _symbols(symbols){
+        std::swap(global_sym_table, _symbols);
+    }
+    ~symbol_table_scope(){
+        std::swap(global_sym_table, _symbols);
+    }
+};
+
+}
+
+enma_context::enma_context(const compile_options& options) : _options(options), _symbols(std::make_unique<symbol_table>()){
+    if(_options.backend == "vm" || _options.backend == "tiered" || _options.is_run || _options.is_superopt ||
+     !_options.remarks_file.empty())
+        throw std::runtime_error("the context only compiles: --backend=vm, --backend=tiered, --run, --superopt and "
+         "--remarks-file can't be used\n");
+    //the unknown passes and levels are found here instead of by every compilation
+    pass_manager(_options.optimization_level, _options.enabled_passes, _options.disabled_passes, false);
+    //the artifacts are returned, so nothing is printed
+    _options.is_verbose = false;
+    _options.is_pass_stats = false;
+    _options.applied_remarks.clear();
+    _options.missed_remarks.clear();
+}
+
+enma_context::~enma_context(){}
+
+enma_context::result enma_context::compile(std::string_view source, const std::string& name){
+    return compile(std::vector<source_file>{{name, source}});
+}
+
+enma_context::result enma_context::compile(const std::vector<source_file>& sources){
+    result compiled;
+    std::ostringstream errors;
+    *_symbols = symbol_table();
+    {
+        symbol_table_scope scope(_symbols);
+        ENMA_compiler compiler(_options, errors);
+        compiled.is_success = compiler.compile_sources(sources);
+        if(compiled.is_success)
+            compiled.artifacts = compiler.get_artifacts();
+    }
+    compiled.errors = errors.str();
+    return compiled;
+}
@@ -0,0 +1,109 @@
+//the public interface of libenma, the only header a program using the library includes
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+class symbol_table;
+
+struct compile_options{
+    std::string executable_name = "output";
+    bool is_verbose = false;
+    //the executable counts its branches and writes them to this file at exit
+    std::string profile_generate_file;
+    //branch counts of an instrumented run used to lay out the code
+    std::string profile_use_file;
+    //'0', '1', '2' or 's' of -O<level>, the level chooses the passes
+    char optimization_level = '2';
+    //names of the optimization passes added with --enable-pass and turned off with --disable-pass
+    std::unordered_set<std::string> enabled_passes;
+    std::unordered_set<std::string> disabled_passes;
+    //print the time and the changes of every pass
+    bool is_pass_stats = false;
+    //the passes whose remarks -Rpass and -Rpass-missed show, an empty name for all passes
+    std::unordered_set<std::string> applied_remarks;
+    std::unordered_set<std::string> missed_remarks;
+    //all remarks as json lines
+    std::string remarks_file;
+    //the steps the partial evaluator may run the program for at compile time
+    int64_t evaluation_steps = 1000000;
+    //search better sequences for the expressions of the program instead of compiling it
+    bool is_superopt = false;
+    //the rewrite database the superoptimizer fills and the code generator reads
+    std::string superopt_database = "enma.superopt";
+    //write the assembly and build it with nasm instead of encoding the machine code
+    bool is_emit_asm = false;
+    //link the program in memory and run it instead of writing the executable
+    bool is_run = false;
+    //"native" for the machine code, "vm" to run the program with the bytecode interpreter,
+    //"tiered" to start in the interpreter and go on in the machine code from a hot loop,
+    //"baseline" for the machine code of the stencils of the nodes without the code generator,
+    //"c" to write the program in C and build it with cc -O2
+    std::string backend = "native";
+    //the runs of the condition of a loop after which the tiered program goes on in the machine code
+    int64_t osr_threshold = 1000;
+    //print the time of every tier of the tiered program to stderr
+    bool is_tier_stats = false;
+    //write lib<name>.so with the position independent code of the program as the function <name>_run and its header <name>.h
+    bool is_shared = false;
+    //the socket of the compile server the files are sent to when one listens on it, empty to always compile in the process
+    std::string server_socket;
+};
+
+//a file of a program given in memory
+struct source_file{
+    //the name of the messages and the remarks
+    std::string name;
+    std::string_view text;
+};
+
+//the files of a compiled program, in memory until they are written
+struct compile_artifacts{
+    //the assembly of --emit=asm
+    std::string assembly;
+    //the C file of --backend=c
+    std::string c_source;
+    //the relocatable object of the program
+    std::vector<uint8_t> object;
+    //the executable linked with the runtime, or the shared library of --shared
+    std::vector<uint8_t> executable;
+    //the C header of the shared library
+    std::string header;
+};
+
+//a compilation without the command line
+struct compile_result{
+    bool is_success = false;
+    //the messages the command line prints to stderr
+    std::string errors;
+    compile_artifacts artifacts;
+};
+
+
+//the compiler as a library: a context compiles a source in memory to the artifacts ENMA_compiler would write as files,
+//the options are the ones of the command line without the files, and nothing is printed
+//every context has its own identifiers, so the contexts compile on their threads at the same time,
+//a context is used by one thread at a time
+class enma_context{
+public:
+    using result = compile_result;
+private:
+    compile_options _options;
+    //the identifiers of the program being compiled, the thread of the compilation uses them instead of its own ones
+    std::unique_ptr<symbol_table> _symbols;
+public:
+    //throw std::runtime_error for the options of the command line that run the program or write files:
+    //--backend=vm or tiered, --run, --superopt and the remarks file, and for an unknown pass or level
+    explicit enma_context(const compile_options& options = compile_options{});
+    ~enma_context();
+
+    //the codes of the identifiers of a program don't depend on the programs compiled before it,
+    //the name is the one of the remarks and of the messages
+    result compile(std::string_view source, const std::string& name = "input.em");
+    //the files of one program in the order of the command line
+    result compile(const std::vector<source_file>& sources);
+};
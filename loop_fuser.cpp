@@ -0,0 +1,270 @@
+#include <vector>
+#include "loop_fuser.h"
+#include "remarks.h"
+#include "pass_manager.h"
+#include "ast.h"
+#include "lexer.h"
+
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
+
+loop_fuser::loop_fuser(remark_emitter* remarks) : _remarks(remarks){}
+
+bool loop_fuser::has_side_effects(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::PRINT:
+                return true;
+            case ast_node_type::VAR_DECL:
+            case ast_node_type::ASSIGN:
+                if(can_trap(std::static_pointer_cast<statement_with_id>(node)->get_expression()))
+                    return true;
+                break;
+            case ast_node_type::COMPOUND:
+                if(has_side_effects(std::static_pointer_cast<compound_statement>(node)->get_inner_statement()))
+                    return true;
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                if(can_trap(if_stat->get_conditional_expression()) || has_side_effects(if_stat->get_if_inner_statement()) ||
+                 has_side_effects(if_stat->get_else_inner_statement()))
+                    return true;
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:{
+                const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+                if(can_trap(while_stat->get_conditional_expression()) || has_side_effects(while_stat->get_inner_statement()))
+                    return true;
+                break;
+            }
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                if(can_trap(for_stat->get_start_statement()->get_expression()) || can_trap(for_stat->get_final_expression()) ||
+                 can_trap(for_stat->get_after_iter_expression()) || has_side_effects(for_stat->get_inner_statement()))
+                    return true;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+bool loop_fuser::has_finite_trip_count(const std::shared_ptr<for_statement>& loop){
+    const auto& start = loop->get_start_statement()->get_expression();
+    const auto& final = loop->get_final_expression();
+    const auto& step = loop->get_after_iter_expression();
+    for(const auto& expr : {start, final, step}){
+        if(!expr || expr->get_type() != ast_node_type::NUM)
+            return false;
+    }
+    int64_t distance;
+    int64_t step_value = std::static_pointer_cast<number_expression>(step)->get_number();
+    if(step_value == 0 || __builtin_sub_overflow(std::static_pointer_cast<number_expression>(final)->get_number(),
+     std::static_pointer_cast<number_expression>(start)->get_number(), &distance))
+        return false;
+    //the iterator reaches the final value without wrapping around
+    return distance % step_value == 0 && distance / step_value >= 0;
+}
+
+void loop_fuser::rename_variable(const std::shared_ptr<expression>& expr, int from_id, int to_id){
+    if(!expr || expr->get_type() == ast_node_type::NUM)
+        return;
+    if(expr->get_type() == ast_node_type::ID){
+        const auto& id_expr = std::static_pointer_cast<identifier_expression>(expr);
+        if(id_expr->get_id() == from_id)
+            id_expr->set_id(to_id);
+        return;
+    }
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    rename_variable(bin_expr->get_left(), from_id, to_id);
+    rename_variable(bin_expr->get_right(), from_id, to_id);
+}
+
+//only the reads are renamed, the renamed variable is never written by the statements
+void loop_fuser::rename_variable(const std::shared_ptr<statement>& stat, int from_id, int to_id){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::PRINT:
+                rename_variable(std::static_pointer_cast<print_statement>(node)->get_expression(), from_id, to_id);
+                break;
+            case ast_node_type::VAR_DECL:
+            case ast_node_type::ASSIGN:
+                rename_variable(std::static_pointer_cast<statement_with_id>(node)->get_expression(), from_id, to_id);
+                break;
+            case ast_node_type::COMPOUND:
+                rename_variable(std::static_pointer_cast<compound_statement>(node)->get_inner_statement(), from_id, to_id);
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                rename_variable(if_stat->get_conditional_expression(), from_id, to_id);
+                rename_variable(if_stat->get_if_inner_statement(), from_id, to_id);
+                rename_variable(if_stat->get_else_inner_statement(), from_id, to_id);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:{
+                const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+                rename_variable(while_stat->get_conditional_expression(), from_id, to_id);
+                rename_variable(while_stat->get_inner_statement(), from_id, to_id);
+                break;
+            }
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                rename_variable(for_stat->get_start_statement()->get_expression(), from_id, to_id);
+                rename_variable(for_stat->get_final_expression(), from_id, to_id);
+                rename_variable(for_stat->get_after_iter_expression(), from_id, to_id);
+                rename_variable(for_stat->get_inner_statement(), from_id, to_id);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+std::string loop_fuser::check_fusion(const std::shared_ptr<for_statement>& first, const std::shared_ptr<for_statement>& second,
+ const std::unordered_set<int>& fused_iterators) const{
+    const auto& first_start = first->get_start_statement();
+    const auto& second_start = second->get_start_statement();
+    if(!first_start->get_expression() || !second_start->get_expression())
+        return "a loop continues from the current value of its iterator";
+    if(!are_equal_expressions(first_start->get_expression(), second_start->get_expression()))
+        return "different start expressions";
+    if(!are_equal_expressions(first->get_final_expression(), second->get_final_expression()))
+        return "different final expressions";
+    if(!are_equal_expressions(first->get_after_iter_expression(), second->get_after_iter_expression()))
+        return "different steps";
+
+    int first_iterator = first_start->get_identifier_code();
+    int second_iterator = second_start->get_identifier_code();
+    std::unordered_set<int> first_read, first_written, second_read, second_written;
+    collect_variables(first->get_inner_statement(), first_read, first_written);
+    collect_variables(second->get_inner_statement(), second_read, second_written);
+    if(first_written.contains(first_iterator) || second_written.contains(second_iterator))
+        return "a loop body changes its iterator";
+
+    //the range expressions have to give the same values before and during both loops
+    std::unordered_set<int> range_read;
+    collect_variables(first_start->get_expression(), range_read);
+    collect_variables(first->get_final_expression(), range_read);
+    collect_variables(first->get_after_iter_expression(), range_read);
+    for(int id : range_read){
+        if(id == first_iterator || id == second_iterator || first_written.contains(id) || second_written.contains(id) ||
+         fused_iterators.contains(id))
+            return "the range depends on '" + global_sym_table->get_identifier(id) + "' changed by the loops";
+    }
+
+    //the second loop sees the iterator of the first one instead of its own
+    if(first_iterator != second_iterator){
+        for(int id : {first_iterator, second_iterator}){
+            if(id == first_iterator ? (second_read.contains(id) || second_written.contains(id)) :
+             (first_read.contains(id) || first_written.contains(id)))
+                return "a loop body uses the iterator '" + global_sym_table->get_identifier(id) + "' of the other loop";
+        }
+    }
+    for(int id : fused_iterators){
+        if(second_read.contains(id) || second_written.contains(id))
+            return "the body uses the iterator '" + global_sym_table->get_identifier(id) + "' of a fused loop";
+    }
+
+    for(int id : first_written){
+        if(second_read.contains(id) || second_written.contains(id))
+            return "'" + global_sym_table->get_identifier(id) + "' is changed by the first loop and used by the second one";
+    }
+    for(int id : second_written){
+        if(first_read.contains(id))
+            return "'" + global_sym_table->get_identifier(id) + "' is changed by the second loop and used by the first one";
+    }
+    bool is_second_observable = has_side_effects(second->get_inner_statement());
+    if(has_side_effects(first->get_inner_statement()) && is_second_observable)
+        return "both bodies print or may fault on a division";
+    //a loop that never ends never runs the second one, which can't start printing in the fused loop
+    if(is_second_observable && !has_finite_trip_count(first))
+        return "the loops may not end and the second body prints or may fault on a division";
+    return "";
+}
+
+void loop_fuser::fuse_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:
+                fuse_statements(std::static_pointer_cast<compound_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                fuse_statements(if_stat->get_if_inner_statement());
+                fuse_statements(if_stat->get_else_inner_statement());
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                fuse_statements(std::static_pointer_cast<while_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::FOR_LOOP:
+                fuse_statements(std::static_pointer_cast<for_statement>(node)->get_inner_statement());
+                break;
+            default:
+                break;
+        }
+        if(node->get_type() != ast_node_type::FOR_LOOP)
+            continue;
+
+        //the iterators of the fused loops get their final values after the loop
+        const auto& first = std::static_pointer_cast<for_statement>(node);
+        int first_iterator = first->get_start_statement()->get_identifier_code();
+        std::unordered_set<int> fused_iterators;
+        std::vector<std::shared_ptr<statement_with_id>> iterator_stats;
+        while(first->get_next() && first->get_next()->get_type() == ast_node_type::FOR_LOOP){
+            auto second = std::static_pointer_cast<for_statement>(first->get_next());
+            auto reason = check_fusion(first, second, fused_iterators);
+            auto loops = "the loops over '" + first->get_start_statement()->get_identifier() + "' and '" +
+             second->get_start_statement()->get_identifier() + "' at lines " + std::to_string(first->get_line()) +
+             " and " + std::to_string(second->get_line());
+            if(!reason.empty()){
+                if(_remarks)
+                    _remarks->emit(remark_kind::MISSED, "loop-fusion", second->get_line(), loops + " are not fused - " + reason);
+                break;
+            }
+            if(_remarks)
+                _remarks->emit(remark_kind::APPLIED, "loop-fusion", second->get_line(), loops + " are fused");
+
+            int second_iterator = second->get_start_statement()->get_identifier_code();
+            auto second_body = second->get_inner_statement()->get_inner_statement();
+            if(second_iterator != first_iterator){
+                rename_variable(second_body, second_iterator, first_iterator);
+                auto iterator_stat = second->get_start_statement();
+                iterator_stat->set_expression(std::make_shared<identifier_expression>(first_iterator));
+                iterator_stats.push_back(iterator_stat);
+                fused_iterators.emplace(second_iterator);
+            }
+            const auto& first_body = first->get_inner_statement();
+            if(!first_body->get_inner_statement()){
+                first_body->set_inner_statement(second_body);
+            }else{
+                auto tail = first_body->get_inner_statement();
+                while(tail->get_next()){
+                    tail = tail->get_next();
+                }
+                tail->set_next(second_body);
+            }
+            first->set_next(second->get_next());
+            _fused_count++;
+        }
+
+        for(auto& iterator_stat : iterator_stats){
+            iterator_stat->set_next(node->get_next());
+            node->set_next(iterator_stat);
+            node = iterator_stat;
+        }
+    }
+}
+
+int loop_fuser::fuse(const std::shared_ptr<statement>& root){
+    _fused_count = 0;
+    fuse_statements(root);
+    return _fused_count;
+}
+
+static pass_registration registration({"loop-fusion", pass_stage::AST, 10, "2s", "loops fused",
+ [](pass_context& context){
+    return loop_fuser(context.remarks).fuse(context.ast);
+}});
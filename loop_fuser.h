@@ -0,0 +1,30 @@
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+//merge adjacent for loops with the same start, final and step expressions into one loop
+//the second body is executed right after the first one in every iteration, so the loops are fused
+//only when no variable written by one body is used by the other one and the bodies can't
+//reorder their side effects (prints and divisions that may fault), a second body with side effects
+//needs a constant range the iterator reaches, so the first loop ends
+class loop_fuser{
+private:
+    class remark_emitter* _remarks;
+    int _fused_count = 0;
+private:
+    static bool has_side_effects(const std::shared_ptr<class statement>& stat);
+    //the start, final and step are numbers and the steps reach the final value without wrapping around
+    static bool has_finite_trip_count(const std::shared_ptr<class for_statement>& loop);
+    static void rename_variable(const std::shared_ptr<class statement>& stat, int from_id, int to_id);
+    static void rename_variable(const std::shared_ptr<class expression>& expr, int from_id, int to_id);
+
+    //return an empty string if the loops can be fused or the reason why they can't
+    std::string check_fusion(const std::shared_ptr<class for_statement>& first, const std::shared_ptr<class for_statement>& second,
+     const std::unordered_set<int>& fused_iterators) const;
+    void fuse_statements(const std::shared_ptr<class statement>& stat);
+public:
+    loop_fuser(class remark_emitter* remarks = nullptr);
+
+    //return the number of loops merged into the previous ones
+    int fuse(const std::shared_ptr<class statement>& root);
+};
@@ -0,0 +1,128 @@
+#include "loop_unroller.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "remarks.h"
+#include "parser.h"
+#include "ast.h"
+
+loop_unroller::loop_unroller(const branch_profile& profile, remark_emitter* remarks) : _profile(profile), _remarks(remarks){}
+
+int loop_unroller::get_unroll_factor(const for_statement* stat, std::string& reason) const{
+    if(_profile.get_taken_count(stat) < _hot_iterations_count){
+        reason = "the loop is cold: " + std::to_string(_profile.get_taken_count(stat)) + " iterations";
+        return 1;
+    }
+
+    auto start_expr = stat->get_start_statement()->get_expression();
+    auto final_expr = stat->get_final_expression();
+    auto step_expr = stat->get_after_iter_expression();
+    if(!start_expr || start_expr->get_type() != ast_node_type::NUM ||
+     final_expr->get_type() != ast_node_type::NUM || step_expr->get_type() != ast_node_type::NUM){
+        reason = "the start, final and step values aren't constants";
+        return 1;
+    }
+    int64_t start = std::static_pointer_cast<number_expression>(start_expr)->get_number();
+    int64_t final = std::static_pointer_cast<number_expression>(final_expr)->get_number();
+    int64_t step = std::static_pointer_cast<number_expression>(step_expr)->get_number();
+    //the loop stops when the iterator becomes equal to the final value
+    if(step == 0 || (final - start) % step != 0 || (final - start) / step <= 0){
+        reason = "the iterator doesn't reach the final value";
+        return 1;
+    }
+    int64_t trip_count = (final - start) / step;
+
+    auto body = stat->get_inner_statement();
+    if(!body->get_inner_statement()){
+        reason = "the body is empty";
+        return 1;
+    }
+    std::unordered_set<int> read, written;
+    collect_variables(body->get_inner_statement(), read, written);
+    if(written.contains(stat->get_start_statement()->get_identifier_code())){
+        reason = "the body changes the iterator";
+        return 1;
+    }
+
+    int body_size = count_nodes(body);
+    for(int factor = _max_unroll_factor; factor > 1; factor /= 2){
+        if(trip_count % factor == 0 && body_size * factor <= _max_unrolled_size){
+            return factor;
+        }
+    }
+    reason = "the trip count " + std::to_string(trip_count) + " isn't divisible by 2 or the body of " +
+     std::to_string(body_size) + " nodes is too big";
+    return 1;
+}
+
+void loop_unroller::unroll_loop(for_statement* stat, int factor){
+    int iterator_id = stat->get_start_statement()->get_identifier_code();
+    int step = std::static_pointer_cast<number_expression>(stat->get_after_iter_expression())->get_number();
+    auto body = stat->get_inner_statement();
+
+    //every copy is a block of its own, so the variables it declares are the ones of one iteration like in the loop,
+    //the original statements stay as the first copy, so they keep their branch profile
+    auto statements = body->get_inner_statement();
+    std::shared_ptr<statement> tail = std::make_shared<compound_statement>(statements);
+    body->set_inner_statement(tail);
+    for(int i = 1; i < factor; i++){
+        auto iterator_step = std::make_shared<assignment_statement>(iterator_id,
+         std::make_shared<binary_expression>(arithmetical_operation::ADD,
+          std::make_shared<identifier_expression>(iterator_id), std::make_shared<number_expression>(step)));
+        tail->set_next(iterator_step);
+        iterator_step->set_next(std::make_shared<compound_statement>(copy_statements(statements)));
+        tail = iterator_step->get_next();
+    }
+    //the loop step stays the same, the last copy of the body is followed by the loop's own iterator change
+}
+
+void loop_unroller::unroll_statements(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:
+                unroll_statements(std::static_pointer_cast<compound_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                unroll_statements(if_stat->get_if_inner_statement());
+                unroll_statements(if_stat->get_else_inner_statement());
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                unroll_statements(std::static_pointer_cast<while_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                //inner loops first, so their size is known when the outer loop is checked
+                unroll_statements(for_stat->get_inner_statement());
+                std::string reason;
+                int factor = get_unroll_factor(for_stat.get(), reason);
+                if(factor > 1){
+                    unroll_loop(for_stat.get(), factor);
+                    _unrolled_loops_count++;
+                    if(_remarks)
+                        _remarks->emit(remark_kind::APPLIED, "loop-unroll", for_stat->get_line(),
+                         "the loop is unrolled " + std::to_string(factor) + " times");
+                }else if(_remarks){
+                    _remarks->emit(remark_kind::MISSED, "loop-unroll", for_stat->get_line(), "the loop isn't unrolled - " + reason);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+int loop_unroller::unroll(const std::shared_ptr<statement>& root){
+    _unrolled_loops_count = 0;
+    unroll_statements(root);
+    return _unrolled_loops_count;
+}
+
+//the trip counts are only known to be hot with a profile
+static pass_registration registration({"loop-unroll", pass_stage::AST, 30, "2", "loops unrolled",
+ [](pass_context& context){
+    if(!context.profile || !context.profile->has_counts())
+        return 0;
+    return loop_unroller(*context.profile, context.remarks).unroll(context.ast);
+}});
@@ -0,0 +1,29 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+
+//unroll the hot for-loops of a profiled program
+//a loop is unrolled only if its trip count is known at compile time and divisible by the unroll factor,
+//so the copies of the body don't need any remainder loop, every copy is a block with its own variables
+class loop_unroller{
+private:
+    static constexpr int _max_unroll_factor = 4;
+    //limit of the AST nodes of an unrolled loop body
+    static constexpr int _max_unrolled_size = 128;
+    //a loop is hot if its body was executed at least this number of times
+    static constexpr uint64_t _hot_iterations_count = 1000;
+
+    const class branch_profile& _profile;
+    class remark_emitter* _remarks;
+    int _unrolled_loops_count = 0;
+private:
+    //return 1 and the reason if the loop isn't unrolled
+    int get_unroll_factor(const class for_statement* stat, std::string& reason) const;
+    void unroll_loop(class for_statement* stat, int factor);
+    void unroll_statements(const std::shared_ptr<class statement>& stat);
+public:
+    loop_unroller(const class branch_profile& profile, class remark_emitter* remarks = nullptr);
+
+    //return the number of unrolled loops
+    int unroll(const std::shared_ptr<class statement>& root);
+};
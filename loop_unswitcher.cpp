@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <tuple>
+#include <unordered_set>
+#include "loop_unswitcher.h"
+#include "pass_manager.h"
+#include "profile.h"
+#include "remarks.h"
+#include "ast.h"
+#include "lexer.h"
+
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
+
+loop_unswitcher::loop_unswitcher(const branch_profile* profile, remark_emitter* remarks) : _profile(profile), _remarks(remarks){}
+
+void loop_unswitcher::collect_if_statements(const std::shared_ptr<statement>& stat, std::vector<if_statement*>& ifs){
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:
+                collect_if_statements(std::static_pointer_cast<compound_statement>(node)->get_inner_statement(), ifs);
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                ifs.push_back(if_stat.get());
+                collect_if_statements(if_stat->get_if_inner_statement(), ifs);
+                collect_if_statements(if_stat->get_else_inner_statement(), ifs);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                collect_if_statements(std::static_pointer_cast<while_statement>(node)->get_inner_statement(), ifs);
+                break;
+            case ast_node_type::FOR_LOOP:
+                collect_if_statements(std::static_pointer_cast<for_statement>(node)->get_inner_statement(), ifs);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+std::shared_ptr<statement> loop_unswitcher::splice_arm(const std::shared_ptr<statement>& stat, const if_statement* target, bool is_if_arm){
+    std::shared_ptr<statement> head = stat;
+    std::shared_ptr<statement> prev = nullptr;
+    for(auto node = stat; node; ){
+        auto next = node->get_next();
+        if(node.get() == target){
+            const auto& arm = is_if_arm ? target->get_if_inner_statement() : target->get_else_inner_statement();
+            auto replacement = arm ? arm->get_inner_statement() : nullptr;
+            if(replacement){
+                auto tail = replacement;
+                while(tail->get_next()){
+                    tail = tail->get_next();
+                }
+                tail->set_next(next);
+            }else{
+                replacement = next;
+            }
+            if(prev){
+                prev->set_next(replacement);
+            }else{
+                head = replacement;
+            }
+            return head;
+        }
+
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:{
+                const auto& compound_stat = std::static_pointer_cast<compound_statement>(node);
+                compound_stat->set_inner_statement(splice_arm(compound_stat->get_inner_statement(), target, is_if_arm));
+                break;
+            }
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                splice_arm(if_stat->get_if_inner_statement(), target, is_if_arm);
+                splice_arm(if_stat->get_else_inner_statement(), target, is_if_arm);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                splice_arm(std::static_pointer_cast<while_statement>(node)->get_inner_statement(), target, is_if_arm);
+                break;
+            case ast_node_type::FOR_LOOP:
+                splice_arm(std::static_pointer_cast<for_statement>(node)->get_inner_statement(), target, is_if_arm);
+                break;
+            default:
+                break;
+        }
+        prev = node;
+        node = next;
+    }
+    return head;
+}
+
+if_statement* loop_unswitcher::find_invariant_if(const std::shared_ptr<statement>& loop, std::string& reason) const{
+    std::unordered_set<int> read, written;
+    std::shared_ptr<compound_statement> body;
+    if(loop->get_type() == ast_node_type::FOR_LOOP){
+        const auto& for_stat = std::static_pointer_cast<for_statement>(loop);
+        written.emplace(for_stat->get_start_statement()->get_identifier_code());
+        body = for_stat->get_inner_statement();
+    }else{
+        body = std::static_pointer_cast<while_statement>(loop)->get_inner_statement();
+    }
+    collect_variables(body, read, written);
+
+    std::vector<if_statement*> ifs;
+    collect_if_statements(body, ifs);
+    for(auto* if_stat : ifs){
+        auto if_line = "the condition of the if at line " + std::to_string(if_stat->get_line());
+        if(can_trap(if_stat->get_conditional_expression())){
+            if(reason.empty())
+                reason = if_line + " can divide by zero";
+            continue;
+        }
+        read.clear();
+        collect_variables(if_stat->get_conditional_expression(), read);
+        bool is_invariant = true;
+        for(int id : read){
+            if(written.contains(id)){
+                if(reason.empty())
+                    reason = if_line + " reads '" + global_sym_table->get_identifier(id) + "' changed in the loop";
+                is_invariant = false;
+                break;
+            }
+        }
+        if(is_invariant){
+            return if_stat;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<statement> loop_unswitcher::unswitch_loop(const std::shared_ptr<statement>& loop, if_statement* target){
+    auto next = loop->get_next();
+    loop->set_next(nullptr);
+
+    //the clone has the same shape, so the target is found by its position
+    std::vector<if_statement*> ifs;
+    collect_if_statements(loop, ifs);
+    int target_idx = 0;
+    while(ifs[target_idx] != target){
+        target_idx++;
+    }
+    auto loop_copy = copy_statements(loop);
+    ifs.clear();
+    collect_if_statements(loop_copy, ifs);
+    auto* target_copy = ifs[target_idx];
+
+    auto cond = target->get_conditional_expression();
+    //the target is freed by the splicing
+    int target_line = target->get_line();
+    for(auto [version, target_if, is_if_arm] : {std::tuple(loop, target, true), std::tuple(loop_copy, target_copy, false)}){
+        std::shared_ptr<compound_statement> body = version->get_type() == ast_node_type::FOR_LOOP ?
+         std::static_pointer_cast<for_statement>(version)->get_inner_statement() :
+         std::static_pointer_cast<while_statement>(version)->get_inner_statement();
+        body->set_inner_statement(splice_arm(body->get_inner_statement(), target_if, is_if_arm));
+    }
+
+    //the condition is checked once in the preheader, a for-loop start statement is done before it
+    std::shared_ptr<statement_with_id> start_stat = nullptr;
+    if(loop->get_type() == ast_node_type::FOR_LOOP){
+        const auto& for_stat = std::static_pointer_cast<for_statement>(loop);
+        start_stat = for_stat->get_start_statement();
+        int iterator_id = start_stat->get_identifier_code();
+        for_stat->set_start_statement(std::make_shared<assignment_statement>(iterator_id));
+        std::static_pointer_cast<for_statement>(loop_copy)->set_start_statement(std::make_shared<assignment_statement>(iterator_id));
+    }
+    auto preheader_if = std::make_shared<if_statement>(cond, next,
+     std::make_shared<compound_statement>(loop), std::make_shared<compound_statement>(loop_copy));
+    preheader_if->set_line(target_line);
+    if(start_stat && start_stat->get_expression()){
+        start_stat->set_next(preheader_if);
+        return start_stat;
+    }
+    return preheader_if;
+}
+
+std::shared_ptr<statement> loop_unswitcher::unswitch_statements(const std::shared_ptr<statement>& stat){
+    std::shared_ptr<statement> head = stat;
+    std::shared_ptr<statement> prev = nullptr;
+    for(auto node = stat; node; node = node->get_next()){
+        //inner loops first, so an outer loop sees their checks and can unswitch them too
+        switch (node->get_type()){
+            case ast_node_type::COMPOUND:{
+                const auto& compound_stat = std::static_pointer_cast<compound_statement>(node);
+                compound_stat->set_inner_statement(unswitch_statements(compound_stat->get_inner_statement()));
+                break;
+            }
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                unswitch_statements(if_stat->get_if_inner_statement());
+                unswitch_statements(if_stat->get_else_inner_statement());
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:
+                unswitch_statements(std::static_pointer_cast<while_statement>(node)->get_inner_statement());
+                break;
+            case ast_node_type::FOR_LOOP:
+                unswitch_statements(std::static_pointer_cast<for_statement>(node)->get_inner_statement());
+                break;
+            default:
+                break;
+        }
+
+        if(node->get_type() == ast_node_type::WHILE_LOOP || node->get_type() == ast_node_type::FOR_LOOP){
+            //a cold loop isn't worth its clone
+            bool is_cold = _profile && _profile->has_counts() && _profile->get_branch_id(node.get()) != -1 &&
+             _profile->get_taken_count(node.get()) == 0;
+            int loop_size = count_nodes(node) - count_nodes(node->get_next());
+            std::string reason;
+            auto* target = find_invariant_if(node, reason);
+            if(target && is_cold){
+                reason = "the loop is cold";
+                target = nullptr;
+            }else if(target && loop_size > std::min(_max_loop_size, _growth_budget)){
+                reason = "the loop of " + std::to_string(loop_size) + " nodes doesn't fit into the code size budget of " +
+                 std::to_string(std::min(_max_loop_size, _growth_budget));
+                target = nullptr;
+            }
+            if(_remarks && !reason.empty())
+                _remarks->emit(remark_kind::MISSED, "loop-unswitch", node->get_line(), "the loop isn't unswitched - " + reason);
+            if(target){
+                _growth_budget -= loop_size;
+                _unswitched_count++;
+                if(_remarks)
+                    _remarks->emit(remark_kind::APPLIED, "loop-unswitch", node->get_line(),
+                     "the condition of the if at line " + std::to_string(target->get_line()) + " is moved out of the loop");
+                auto replacement = unswitch_loop(node, target);
+                if(prev){
+                    prev->set_next(replacement);
+                }else{
+                    head = replacement;
+                }
+                //both versions may have other invariant conditions
+                node = replacement->get_type() == ast_node_type::IF_HEAD ? replacement : replacement->get_next();
+                const auto& preheader_if = std::static_pointer_cast<if_statement>(node);
+                unswitch_statements(preheader_if->get_if_inner_statement());
+                unswitch_statements(preheader_if->get_else_inner_statement());
+            }
+        }
+        prev = node;
+    }
+    return head;
+}
+
+int loop_unswitcher::unswitch(std::shared_ptr<statement>& root){
+    _unswitched_count = 0;
+    int program_size = count_nodes(root);
+    _growth_budget = std::max(_min_growth_budget, static_cast<int>(program_size * _max_growth_ratio));
+    root = unswitch_statements(root);
+    return _unswitched_count;
+}
+
+static pass_registration registration({"loop-unswitch", pass_stage::AST, 20, "2", "loops unswitched",
+ [](pass_context& context){
+    return loop_unswitcher(context.profile, context.remarks).unswitch(context.ast);
+}});
@@ -0,0 +1,33 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+//move an if statement whose condition doesn't change in a loop outside of the loop:
+//the loop is cloned into one version for each arm and the condition is checked once before it
+//every clone is paid with code size, so a loop is unswitched only while it fits into the budget
+class loop_unswitcher{
+private:
+    //limit of the AST nodes of a loop to be cloned
+    static constexpr int _max_loop_size = 200;
+    //the whole program may grow by this part of its size, but by no less than the minimal budget
+    static constexpr double _max_growth_ratio = 0.5;
+    static constexpr int _min_growth_budget = 100;
+
+    const class branch_profile* _profile;
+    class remark_emitter* _remarks;
+    int _growth_budget = 0;
+    int _unswitched_count = 0;
+private:
+    static void collect_if_statements(const std::shared_ptr<class statement>& stat, std::vector<class if_statement*>& ifs);
+    static std::shared_ptr<class statement> splice_arm(const std::shared_ptr<class statement>& stat, const class if_statement* target, bool is_if_arm);
+
+    //return nullptr and the reason the first if of the loop isn't invariant
+    class if_statement* find_invariant_if(const std::shared_ptr<class statement>& loop, std::string& reason) const;
+    std::shared_ptr<class statement> unswitch_loop(const std::shared_ptr<class statement>& loop, class if_statement* target);
+    std::shared_ptr<class statement> unswitch_statements(const std::shared_ptr<class statement>& stat);
+public:
+    loop_unswitcher(const class branch_profile* profile = nullptr, class remark_emitter* remarks = nullptr);
+
+    //return the number of unswitched loops, the root can be replaced
+    int unswitch(std::shared_ptr<class statement>& root);
+};
@@ -0,0 +1,71 @@
+#include <unordered_set>
+#include "on_stack_replacement.h"
+#include "bytecode_compiler.h"
+#include "parser.h"
+#include "ast.h"
+
+std::shared_ptr<statement> on_stack_replacement::restart_loop(const std::shared_ptr<statement>& loop){
+    auto copy = copy_statements(loop);
+    if(copy->get_type() == ast_node_type::FOR_LOOP){
+        const auto& for_stat = std::static_pointer_cast<for_statement>(copy);
+        int iterator = for_stat->get_start_statement()->get_identifier_code();
+        for_stat->set_start_statement(std::make_shared<assignment_statement>(iterator,
+         std::make_shared<identifier_expression>(iterator)));
+    }
+    return copy;
+}
+
+void on_stack_replacement::append(std::shared_ptr<statement>& first, std::shared_ptr<statement>& last,
+ const std::shared_ptr<statement>& stat){
+    if(!stat)
+        return;
+    if(last){
+        last->set_next(stat);
+    }else{
+        first = stat;
+    }
+    for(last = stat; last->get_next(); last = last->get_next());
+}
+
+std::shared_ptr<statement> on_stack_replacement::build_continuation(const bytecode_loop& loop,
+ const std::vector<int64_t>& registers){
+    std::shared_ptr<statement> first, last;
+    append(first, last, restart_loop(loop.path.back()));
+    //the statements after the loop in its block are in the copy, the block ends and the statement around it goes on
+    for(int i = loop.path.size() - 2; i >= 0; i--){
+        const auto& parent = loop.path[i];
+        switch (parent->get_type()){
+            case ast_node_type::WHILE_LOOP:
+                append(first, last, restart_loop(parent));
+                break;
+            case ast_node_type::FOR_LOOP:{
+                //the increment of the iteration the interpreter was in
+                const auto& for_stat = std::static_pointer_cast<for_statement>(parent);
+                int iterator = for_stat->get_start_statement()->get_identifier_code();
+                append(first, last, std::make_shared<assignment_statement>(iterator, std::make_shared<binary_expression>(
+                 arithmetical_operation::ADD, std::make_shared<identifier_expression>(iterator),
+                 copy_expression(for_stat->get_after_iter_expression()))));
+                append(first, last, restart_loop(parent));
+                break;
+            }
+            default:
+                if(parent->get_next())
+                    append(first, last, copy_statements(parent->get_next()));
+                break;
+        }
+    }
+
+    //the variables of the blocks the loop is in become global ones, a block variable declared again after its block
+    //is a second declaration of the same global
+    std::unordered_set<int> read, written;
+    collect_variables(first, read, written);
+    read.insert(written.begin(), written.end());
+    for(auto it = loop.variables.rbegin(); it != loop.variables.rend(); it++){
+        if(!read.contains(it->first))
+            continue;
+        auto declaration = std::make_shared<variable_declaration>(it->first, make_constant(registers[it->second]));
+        declaration->set_next(first);
+        first = declaration;
+    }
+    return first;
+}
@@ -0,0 +1,21 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class statement;
+struct bytecode_loop;
+
+//the entry of the native code in the middle of a program the interpreter has run up to the condition of a hot loop:
+//the rest of the program is built as a program of its own, the variables the interpreter has are declared
+//with their values at its top and the loop starts from its condition, after the loop come the statements after it
+//and the loops around it continue from their next iterations, so the native code runs the program to its end
+class on_stack_replacement{
+private:
+    //a copy of the loop and the statements after it, a for loop starts from its condition with the iterator as it is
+    static std::shared_ptr<statement> restart_loop(const std::shared_ptr<statement>& loop);
+    //append the statements and the ones after them to the list
+    static void append(std::shared_ptr<statement>& first, std::shared_ptr<statement>& last, const std::shared_ptr<statement>& stat);
+public:
+    //the registers are the ones of the interpreter stopped at the loop
+    static std::shared_ptr<statement> build_continuation(const bytecode_loop& loop, const std::vector<int64_t>& registers);
+};
@@ -112,7 +112,7 @@ std::shared_ptr<expression> parser::get_primary_expr(){
             return std::make_shared<number_expression>(static_cast<token_constant&>(*t).get_value());
         case token_type::IDENTIFIER:{
             auto t_id = static_cast<token_identifier&>(*t);
-            if(_declared_identifiers.find(t_id.get_identifier_code()) == _declared_identifiers.end()){
+            if(!is_declared(t_id.get_identifier_code())){
                 throw parsing_error("undeclared identifier", *_tokens);
             }
             return std::make_shared<identifier_expression>(static_cast<token_identifier&>(*t).get_identifier_code());
@@ -153,6 +153,14 @@ std::shared_ptr<expression> parser::bin_expr(int prev_op_precedence){
     return left;
 }
 
+bool parser::is_declared(int id_code) const noexcept{
+    for(const auto& scope : _scopes){
+        if(scope.contains(id_code))
+            return true;
+    }
+    return false;
+}
+
 std::shared_ptr<statement> parser::generate_ast(token_storage& tokens, bool& result){
     try{
         _tokens = &tokens;
@@ -162,33 +170,44 @@ std::shared_ptr<statement> parser::generate_ast(token_storage& tokens, bool& res
         result = true;
         return root;
     }catch(parsing_error& err){
-        std::cerr << err.what();
+        *_errors << err.what();
     }
+    //the blocks left open by the error
+    _scopes.resize(1);
 
     result = false;
     return nullptr;
 }
 
 std::shared_ptr<statement> parser::parse_statement(const std::shared_ptr<token>& t){
+    int line = _tokens->get_current_line();
+    std::shared_ptr<statement> stat;
     switch (t->get_type()){
         case token_type::KEYWORD:{
             auto keyword_token = std::static_pointer_cast<token_keyword>(t);
             switch (keyword_token->get_keyword()){
-                case keyword_type::PRINT: return parse_print();
-                case keyword_type::LET: return parse_variable_declaration();
-                case keyword_type::IF: return parse_if_statement();
-                case keyword_type::WHILE: return parse_while_statement();
-                case keyword_type::FOR: return parse_for_statement();
+                case keyword_type::PRINT: stat = parse_print();
+                    break;
+                case keyword_type::LET: stat = parse_variable_declaration();
+                    break;
+                case keyword_type::IF: stat = parse_if_statement();
+                    break;
+                case keyword_type::WHILE: stat = parse_while_statement();
+                    break;
+                case keyword_type::FOR: stat = parse_for_statement();
+                    break;
                 default:
                     throw parsing_error("unexpected keyword", *_tokens);
             }
             break;
         }
-        case token_type::IDENTIFIER: return parse_assignment_statement();
-        default:
+        case token_type::IDENTIFIER: stat = parse_assignment_statement();
             break;
+        default:
+            throw parsing_error("unexpected token", *_tokens);
     }
-    throw parsing_error("unexpected token", *_tokens);
+    stat->set_line(line);
+    return stat;
 }
 
 std::shared_ptr<compound_statement> parser::expect_compound_statement(){
@@ -201,8 +220,10 @@ std::shared_ptr<compound_statement> parser::expect_compound_statement(){
     t = _tokens->get_next();
     //empty compound statement
     if(is_match(t, punctuation_type::RBRACE)){
+        _tokens->next();
         return root;
     }
+    _scopes.emplace_back();
 
     root->set_inner_statement(parse_statement(t));
     auto node = root->get_inner_statement();
@@ -225,6 +246,7 @@ std::shared_ptr<compound_statement> parser::expect_compound_statement(){
     }
     //skip a right brace
     _tokens->next();
+    _scopes.pop_back();
 
     return root;
 }
@@ -383,7 +405,7 @@ std::shared_ptr<class assignment_statement> parser::parse_assignment_statement(b
         throw parsing_error("identifier expected", *_tokens);
     }
     auto t_id = std::static_pointer_cast<token_identifier>(t);
-    if(_declared_identifiers.find(t_id->get_identifier_code()) == _declared_identifiers.end()){
+    if(!is_declared(t_id->get_identifier_code())){
         throw parsing_error("undeclared identifier", *_tokens);
     }
 
@@ -424,10 +446,10 @@ std::shared_ptr<variable_declaration> parser::parse_variable_declaration(bool ex
     }
 
     auto id_token = std::static_pointer_cast<token_identifier>(t);
-    if(_declared_identifiers.find(id_token->get_identifier_code()) != _declared_identifiers.end()){
+    if(is_declared(id_token->get_identifier_code())){
         throw parsing_error("identifier has already been declared", *_tokens);
     }
-    _declared_identifiers.emplace(id_token->get_identifier_code());
+    _scopes.back().emplace(id_token->get_identifier_code());
 
     t = _tokens->get_next();
     if(!is_match(t,operator_type::ASSIGN)){
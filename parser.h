@@ -1,6 +1,8 @@
+#include <iostream>
 #include <memory>
 #include <list>
 #include <unordered_set>
+#include <vector>
 
 class token_storage{
 private:
@@ -16,6 +18,8 @@ public:
 
     constexpr inline int get_token_number() const noexcept{return _prev_token;}
     constexpr inline int get_line_number() const noexcept{return _prev_line;}
+    //the line of the current token
+    constexpr inline int get_current_line() const noexcept{return _line_number;}
 
     std::shared_ptr<class token> get_current() noexcept;
     std::shared_ptr<class token> get_next() noexcept ;
@@ -52,9 +56,14 @@ enum class arithmetical_operation{
 class parser{
 private:
     token_storage* _tokens = nullptr;
-    //declared identifiers id to check if a variable is not declared
-    std::unordered_set<int> _declared_identifiers;
+    //declared identifiers id of every open block, the first one is the global scope
+    //a name can't be declared again while it's visible, but disjoint blocks can reuse it
+    std::vector<std::unordered_set<int>> _scopes = {{}};
+    //where the syntax errors are reported
+    std::ostream* _errors = &std::cerr;
 private:
+    bool is_declared(int id_code) const noexcept;
+
     bool is_end_binary_expression_token(const std::shared_ptr<token>& t) const noexcept;
 
     arithmetical_operation reinterpret_arith_op(const class std::shared_ptr<class token>& t);
@@ -73,4 +82,5 @@ private:
     std::shared_ptr<class statement> expect_statement();
 public:
     std::shared_ptr<class statement> generate_ast(token_storage& tokens, bool& result);
+    inline void set_error_stream(std::ostream& errors) noexcept{ _errors = &errors; }
 };
\ No newline at end of file
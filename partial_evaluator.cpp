@@ -0,0 +1,225 @@
+#include <climits>
+#include <unordered_set>
+#include "partial_evaluator.h"
+#include "pass_manager.h"
+#include "remarks.h"
+#include "parser.h"
+#include "ast.h"
+
+partial_evaluator::partial_evaluator(int64_t budget, remark_emitter* remarks) : _budget(budget), _remarks(remarks){}
+
+bool partial_evaluator::step(){
+    if(++_steps > _budget){
+        _stop = stop_reason::BUDGET;
+        return false;
+    }
+    return true;
+}
+
+int64_t& partial_evaluator::get_variable(int id_code){
+    for(auto scope = _scopes.rbegin(); scope != _scopes.rend(); scope++){
+        auto it = scope->find(id_code);
+        if(it != scope->end())
+            return it->second;
+    }
+    //the global variables start with 0 in the data section
+    return _globals[id_code];
+}
+
+void partial_evaluator::declare_variable(int id_code, int64_t value){
+    if(_scopes.empty()){
+        _globals[id_code] = value;
+    }else{
+        _scopes.back()[id_code] = value;
+    }
+}
+
+std::optional<int64_t> partial_evaluator::evaluate(const std::shared_ptr<expression>& expr){
+    if(!step())
+        return std::nullopt;
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            return std::static_pointer_cast<number_expression>(expr)->get_number();
+        case ast_node_type::ID:
+            return get_variable(std::static_pointer_cast<identifier_expression>(expr)->get_id());
+        default:
+            break;
+    }
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    auto left = evaluate(bin_expr->get_left());
+    if(!left)
+        return std::nullopt;
+    auto right = evaluate(bin_expr->get_right());
+    if(!right)
+        return std::nullopt;
+    //the same 64-bit arithmetic as the generated code
+    uint64_t l = *left, r = *right;
+    switch (expr->get_type()){
+        case ast_node_type::ADD: return static_cast<int64_t>(l + r);
+        case ast_node_type::SUB: return static_cast<int64_t>(l - r);
+        case ast_node_type::MUL: return static_cast<int64_t>(l * r);
+        case ast_node_type::DIV:
+            if(*right == 0 || (*left == INT64_MIN && *right == -1)){
+                _stop = stop_reason::FAULT;
+                return std::nullopt;
+            }
+            return *left / *right;
+        case ast_node_type::EQUAL: return *left == *right;
+        case ast_node_type::NEQUAl: return *left != *right;
+        case ast_node_type::GREATER: return *left > *right;
+        case ast_node_type::GREATER_EQ: return *left >= *right;
+        case ast_node_type::LESS: return *left < *right;
+        case ast_node_type::LESS_EQ: return *left <= *right;
+        default:
+            throw std::runtime_error("undefined binary expression operator");
+    }
+}
+
+bool partial_evaluator::execute(const std::shared_ptr<statement>& stat){
+    for(auto node = stat; node; node = node->get_next()){
+        if(!execute_statement(node))
+            return false;
+    }
+    return true;
+}
+
+bool partial_evaluator::execute_statement(const std::shared_ptr<statement>& stat){
+    if(!step())
+        return false;
+    switch (stat->get_type()){
+        case ast_node_type::PRINT:{
+            auto value = evaluate(std::static_pointer_cast<print_statement>(stat)->get_expression());
+            if(!value)
+                return false;
+            //printf("%d") prints the low half of the register
+            _output += std::to_string(static_cast<int32_t>(*value)) + '\n';
+            if(_output.size() > _max_output_size){
+                _stop = stop_reason::OUTPUT;
+                return false;
+            }
+            return true;
+        }
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto& id_stat = std::static_pointer_cast<statement_with_id>(stat);
+            //an assignment can be only an identifier
+            if(!id_stat->get_expression())
+                return true;
+            auto value = evaluate(id_stat->get_expression());
+            if(!value)
+                return false;
+            if(stat->get_type() == ast_node_type::VAR_DECL){
+                declare_variable(id_stat->get_identifier_code(), *value);
+            }else{
+                get_variable(id_stat->get_identifier_code()) = *value;
+            }
+            return true;
+        }
+        case ast_node_type::COMPOUND:{
+            _scopes.emplace_back();
+            const auto& inner = std::static_pointer_cast<compound_statement>(stat)->get_inner_statement();
+            bool is_finished = !inner || execute(inner);
+            _scopes.pop_back();
+            return is_finished;
+        }
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(stat);
+            auto cond = evaluate(if_stat->get_conditional_expression());
+            if(!cond)
+                return false;
+            if(*cond != 0)
+                return execute_statement(if_stat->get_if_inner_statement());
+            return !if_stat->get_else_inner_statement() || execute_statement(if_stat->get_else_inner_statement());
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(stat);
+            while(true){
+                auto cond = evaluate(while_stat->get_conditional_expression());
+                if(!cond)
+                    return false;
+                if(*cond == 0)
+                    return true;
+                if(!execute_statement(while_stat->get_inner_statement()))
+                    return false;
+            }
+        }
+        case ast_node_type::FOR_LOOP:{
+            const auto& for_stat = std::static_pointer_cast<for_statement>(stat);
+            if(!execute_statement(for_stat->get_start_statement()))
+                return false;
+            int iterator = for_stat->get_start_statement()->get_identifier_code();
+            //the loop runs while the iterator isn't equal to the final value
+            while(true){
+                auto final_value = evaluate(for_stat->get_final_expression());
+                if(!final_value)
+                    return false;
+                if(get_variable(iterator) == *final_value)
+                    return true;
+                if(!execute_statement(for_stat->get_inner_statement()))
+                    return false;
+                auto increment = evaluate(for_stat->get_after_iter_expression());
+                if(!increment)
+                    return false;
+                auto& value = get_variable(iterator);
+                value = static_cast<int64_t>(static_cast<uint64_t>(value) + static_cast<uint64_t>(*increment));
+            }
+        }
+        default:
+            throw std::runtime_error("undefined statement");
+    }
+}
+
+int partial_evaluator::evaluate_program(std::shared_ptr<statement>& root, std::string& output){
+    int evaluated_count = 0;
+    int64_t evaluated_steps = 0;
+    auto rest = root;
+    for(; rest; rest = rest->get_next()){
+        //a statement which doesn't finish is left to the program as a whole
+        auto globals = _globals;
+        auto output_size = _output.size();
+        if(!execute_statement(rest)){
+            _globals = std::move(globals);
+            _output.resize(output_size);
+            _scopes.clear();
+            break;
+        }
+        evaluated_count++;
+        evaluated_steps = _steps;
+    }
+    if(_remarks && rest){
+        std::string reason = _stop == stop_reason::BUDGET ? "the budget of " + std::to_string(_budget) + " steps is exhausted" :
+         _stop == stop_reason::FAULT ? "the statement divides by zero or overflows a division at run time" :
+         "the output is longer than " + std::to_string(_max_output_size) + " bytes";
+        _remarks->emit(remark_kind::MISSED, "partial-evaluation", rest->get_line(), reason + ", the program is compiled from here");
+    }
+    if(evaluated_count == 0)
+        return 0;
+
+    //the rest of the program starts with the values the evaluated statements have left
+    std::unordered_set<int> read, written;
+    if(rest)
+        collect_variables(rest, read, written);
+    read.insert(written.begin(), written.end());
+    auto new_root = rest;
+    for(auto it = _globals.rbegin(); it != _globals.rend(); it++){
+        if(!read.contains(it->first))
+            continue;
+        auto declaration = std::make_shared<variable_declaration>(it->first, make_constant(it->second));
+        declaration->set_next(new_root);
+        new_root = declaration;
+    }
+    if(_remarks)
+        _remarks->emit(remark_kind::APPLIED, "partial-evaluation", root->get_line(), std::to_string(evaluated_count) +
+         " statements are evaluated at compile time in " + std::to_string(evaluated_steps) + " steps, their " +
+         std::to_string(_output.size()) + " bytes of output are written at once");
+    root = new_root;
+    output += _output;
+    return evaluated_count;
+}
+
+static pass_registration registration({"partial-evaluation", pass_stage::AST, 1, "12s", "statements evaluated",
+ [](pass_context& context){
+    if(context.evaluation_steps <= 0 || !context.ast)
+        return 0;
+    return partial_evaluator(context.evaluation_steps, context.remarks).evaluate_program(context.ast, context.precomputed_output);
+}});
@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+//run the program at compile time: it reads no input, so its output is known before it runs
+//the statements of the top level are run one by one until the step budget is exhausted or a division faults,
+//their output is written by the program at its start and the variables they leave are declared with their values,
+//it goes through the buffer of printf, so a fault later in the program loses it like the output printf would have written
+class partial_evaluator{
+private:
+    //the output is kept in the data section, so a long one is left to the program
+    static constexpr size_t _max_output_size = 1 << 20;
+
+    enum class stop_reason{
+        NONE,
+        BUDGET,
+        //a division by zero or an overflow, the program faults at run time
+        FAULT,
+        OUTPUT
+    };
+
+    int64_t _budget;
+    int64_t _steps = 0;
+    stop_reason _stop = stop_reason::NONE;
+    class remark_emitter* _remarks;
+    std::map<int, int64_t> _globals;
+    //the variables of the open blocks
+    std::vector<std::map<int, int64_t>> _scopes;
+    std::string _output;
+private:
+    //return false if the budget is exhausted
+    bool step();
+    int64_t& get_variable(int id_code);
+    void declare_variable(int id_code, int64_t value);
+
+    //return std::nullopt if the evaluation stops
+    std::optional<int64_t> evaluate(const std::shared_ptr<class expression>& expr);
+    //run the statement and the statements after it, return false if the evaluation stops
+    bool execute(const std::shared_ptr<class statement>& stat);
+    //run only the statement
+    bool execute_statement(const std::shared_ptr<class statement>& stat);
+public:
+    //the budget is the number of the statements and the expression nodes the evaluation may run
+    partial_evaluator(int64_t budget, class remark_emitter* remarks = nullptr);
+
+    //replace the evaluated statements of the program with the declarations of the variables the rest of it uses,
+    //append their output, return the number of evaluated statements
+    int evaluate_program(std::shared_ptr<class statement>& root, std::string& output);
+};
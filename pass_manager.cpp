@@ -0,0 +1,98 @@
+#include <chrono>
+#include <algorithm>
+#include <tuple>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include "pass_manager.h"
+
+pass_registry& pass_registry::get_instance(){
+    //created on the first use, so the registrations of other files can't run before it
+    static pass_registry registry;
+    return registry;
+}
+
+void pass_registry::add(pass_info info){
+    if(find(info.name)){
+        throw std::runtime_error("the pass '" + info.name + "' is registered twice\n");
+    }
+    auto it = std::upper_bound(_passes.begin(), _passes.end(), info, [](const pass_info& left, const pass_info& right){
+        return std::tie(left.stage, left.order) < std::tie(right.stage, right.order);
+    });
+    _passes.insert(it, std::move(info));
+}
+
+const pass_info* pass_registry::find(const std::string& name) const{
+    for(const auto& pass : _passes){
+        if(pass.name == name){
+            return &pass;
+        }
+    }
+    return nullptr;
+}
+
+pass_registration::pass_registration(pass_info info){
+    pass_registry::get_instance().add(std::move(info));
+}
+
+bool pass_manager::is_optimization_level(char level) noexcept{
+    return level == '0' || level == '1' || level == '2' || level == 's';
+}
+
+pass_manager::pass_manager(char optimization_level, const std::unordered_set<std::string>& enabled_passes,
+ const std::unordered_set<std::string>& disabled_passes, bool is_verbose): _is_verbose(is_verbose){
+    if(!is_optimization_level(optimization_level)){
+        throw std::runtime_error(std::string("unknown optimization level -O") + optimization_level + '\n');
+    }
+    const auto& registry = pass_registry::get_instance();
+    for(const auto* names : {&enabled_passes, &disabled_passes}){
+        for(const auto& name : *names){
+            if(!registry.find(name)){
+                throw std::runtime_error("unknown pass '" + name + "'\n");
+            }
+        }
+    }
+    for(const auto& pass : registry.get_passes()){
+        bool is_in_level = pass.levels.find(optimization_level) != std::string::npos;
+        if((is_in_level || enabled_passes.contains(pass.name)) && !disabled_passes.contains(pass.name)){
+            _pipeline.push_back(&pass);
+            _stats.push_back({pass.name});
+        }
+    }
+}
+
+void pass_manager::run(pass_stage stage, pass_context& context){
+    context.is_verbose = _is_verbose;
+    for(size_t i = 0; i < _pipeline.size(); i++){
+        const auto& pass = *_pipeline[i];
+        if(pass.stage != stage){
+            continue;
+        }
+        auto start = std::chrono::steady_clock::now();
+        int changes_count = pass.run(context);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        _stats[i].runs_count++;
+        _stats[i].changes_count += changes_count;
+        _stats[i].milliseconds += elapsed.count();
+        if(_is_verbose)
+            std::cout << pass.name << ": " << changes_count << ' ' << pass.changes_description << '\n';
+    }
+}
+
+void pass_manager::print_stats(std::ostream& out) const{
+    double total_milliseconds = 0;
+    int total_changes = 0;
+    out << std::left << std::setw(24) << "pass" << std::right << std::setw(6) << "runs"
+     << std::setw(12) << "time, ms" << std::setw(10) << "changes" << '\n';
+    for(const auto& stats : _stats){
+        out << std::left << std::setw(24) << stats.name << std::right << std::setw(6) << stats.runs_count
+         << std::setw(12) << std::fixed << std::setprecision(3) << stats.milliseconds
+         << std::setw(10) << stats.changes_count << '\n';
+        total_milliseconds += stats.milliseconds;
+        total_changes += stats.changes_count;
+    }
+    out << std::left << std::setw(24) << "total" << std::right << std::setw(6) << ""
+     << std::setw(12) << std::fixed << std::setprecision(3) << total_milliseconds
+     << std::setw(10) << total_changes << '\n';
+}
@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_set>
+#include <ostream>
+
+enum class pass_stage{
+    AST,
+    ASSEMBLY
+};
+
+//what a pass works on: the ast before the code generation, the assembly after it
+struct pass_context{
+    std::shared_ptr<class statement> ast;
+    class asm_program* program = nullptr;
+    //the branches of the ast, with counts if a profile was loaded
+    const class branch_profile* profile = nullptr;
+    //the remarks of what the passes did and didn't do
+    class remark_emitter* remarks = nullptr;
+    bool is_verbose = false;
+    //the steps the program can be run for at compile time, 0 to compile all of it
+    int64_t evaluation_steps = 0;
+    //the output of the statements run at compile time, the program writes it at its start
+    std::string precomputed_output;
+};
+
+struct pass_info{
+    std::string name;
+    pass_stage stage;
+    //the passes of a stage run in the increasing order
+    int order;
+    //the optimization levels the pass belongs to: '1', '2', 's'
+    std::string levels;
+    //what the returned number counts, for -v
+    std::string changes_description;
+    //return the number of changes
+    std::function<int(pass_context&)> run;
+};
+
+class pass_registry{
+private:
+    std::vector<pass_info> _passes;
+public:
+    static pass_registry& get_instance();
+
+    void add(pass_info info);
+    //return nullptr if there is no such pass
+    const pass_info* find(const std::string& name) const;
+    inline const std::vector<pass_info>& get_passes() const noexcept{ return _passes; }
+};
+
+//a static object of a pass file registers the pass before main, so the driver doesn't know the passes
+struct pass_registration{
+    pass_registration(pass_info info);
+};
+
+class pass_manager{
+private:
+    struct pass_stats{
+        std::string name;
+        int runs_count = 0;
+        int changes_count = 0;
+        double milliseconds = 0;
+    };
+    std::vector<const pass_info*> _pipeline;
+    std::vector<pass_stats> _stats;
+    bool _is_verbose;
+public:
+    //throw std::runtime_error for an unknown level or pass name
+    pass_manager(char optimization_level, const std::unordered_set<std::string>& enabled_passes,
+     const std::unordered_set<std::string>& disabled_passes, bool is_verbose = false);
+
+    static bool is_optimization_level(char level) noexcept;
+
+    //run the passes of the stage in the pipeline order
+    void run(pass_stage stage, pass_context& context);
+    void print_stats(std::ostream& out) const;
+};
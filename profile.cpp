@@ -0,0 +1,148 @@
+#include <fstream>
+#include <ostream>
+#include "profile.h"
+#include "ast.h"
+
+void branch_profile::hash_value(uint64_t val) noexcept{
+    //FNV-1a
+    for(int i = 0; i < 8; i++){
+        _program_hash ^= (val >> (i * 8)) & 0xff;
+        _program_hash *= 1099511628211ull;
+    }
+}
+
+void branch_profile::number_branches(const std::shared_ptr<ast_node>& node){
+    if(!node){
+        hash_value(static_cast<uint64_t>(ast_node_type::END));
+        return;
+    }
+    hash_value(static_cast<uint64_t>(node->get_type()));
+    switch (node->get_type()){
+        case ast_node_type::NUM:
+        case ast_node_type::ID:
+            break;
+        case ast_node_type::ADD:
+        case ast_node_type::SUB:
+        case ast_node_type::DIV:
+        case ast_node_type::MUL:
+        case ast_node_type::EQUAL:
+        case ast_node_type::NEQUAl:
+        case ast_node_type::GREATER:
+        case ast_node_type::GREATER_EQ:
+        case ast_node_type::LESS:
+        case ast_node_type::LESS_EQ:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(node);
+            number_branches(bin_expr->get_left());
+            number_branches(bin_expr->get_right());
+            break;
+        }
+        case ast_node_type::PRINT:{
+            const auto& print_stat = std::static_pointer_cast<print_statement>(node);
+            number_branches(print_stat->get_expression());
+            number_branches(print_stat->get_next());
+            break;
+        }
+        case ast_node_type::VAR_DECL:
+        case ast_node_type::ASSIGN:{
+            const auto& stat = std::static_pointer_cast<statement_with_id>(node);
+            number_branches(stat->get_expression());
+            number_branches(stat->get_next());
+            break;
+        }
+        case ast_node_type::COMPOUND:{
+            const auto& compound_stat = std::static_pointer_cast<compound_statement>(node);
+            number_branches(compound_stat->get_inner_statement());
+            number_branches(compound_stat->get_next());
+            break;
+        }
+        case ast_node_type::IF_HEAD:{
+            const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+            _branch_ids[if_stat.get()] = _counts.size();
+            _counts.emplace_back();
+            number_branches(if_stat->get_conditional_expression());
+            number_branches(if_stat->get_if_inner_statement());
+            number_branches(if_stat->get_else_inner_statement());
+            number_branches(if_stat->get_next());
+            break;
+        }
+        case ast_node_type::WHILE_LOOP:{
+            const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+            _branch_ids[while_stat.get()] = _counts.size();
+            _counts.emplace_back();
+            number_branches(while_stat->get_conditional_expression());
+            number_branches(while_stat->get_inner_statement());
+            number_branches(while_stat->get_next());
+            break;
+        }
+        case ast_node_type::FOR_LOOP:{
+            const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+            _branch_ids[for_stat.get()] = _counts.size();
+            _counts.emplace_back();
+            number_branches(for_stat->get_start_statement());
+            number_branches(for_stat->get_final_expression());
+            number_branches(for_stat->get_after_iter_expression());
+            number_branches(for_stat->get_inner_statement());
+            number_branches(for_stat->get_next());
+            break;
+        }
+        default:
+            throw std::runtime_error("undefined ast_node_type\n");
+    }
+}
+
+branch_profile::branch_profile(const std::shared_ptr<statement>& root){
+    number_branches(root);
+    hash_value(_counts.size());
+}
+
+int branch_profile::get_branch_id(const statement* stat) const noexcept{
+    auto it = _branch_ids.find(stat);
+    return it == _branch_ids.end() ? -1 : it->second;
+}
+
+bool branch_profile::load(const std::string& filename, std::ostream& errors){
+    std::ifstream file(filename, std::ios::binary);
+    if(!file.is_open()){
+        errors << filename << " - failed to open the profile\n";
+        return false;
+    }
+
+    auto read_value = [&file]() -> uint64_t{
+        unsigned char bytes[8] = {};
+        file.read(reinterpret_cast<char*>(bytes), 8);
+        uint64_t val = 0;
+        for(int i = 7; i >= 0; i--){
+            val = (val << 8) | bytes[i];
+        }
+        return val;
+    };
+
+    if(read_value() != magic || !file){
+        errors << filename << " - not an ENMA profile\n";
+        return false;
+    }
+    if(read_value() != _program_hash || read_value() != _counts.size() || !file){
+        errors << filename << " - the profile was collected for another program, ignored\n";
+        return false;
+    }
+    for(auto& counts : _counts){
+        counts.taken = read_value();
+        counts.not_taken = read_value();
+    }
+    if(!file){
+        errors << filename << " - the profile is truncated, ignored\n";
+        return false;
+    }
+    _has_counts = true;
+    return true;
+}
+
+uint64_t branch_profile::get_taken_count(const statement* stat) const noexcept{
+    int id = get_branch_id(stat);
+    return id == -1 || !_has_counts ? 0 : _counts[id].taken;
+}
+
+uint64_t branch_profile::get_not_taken_count(const statement* stat) const noexcept{
+    int id = get_branch_id(stat);
+    return id == -1 || !_has_counts ? 0 : _counts[id].not_taken;
+}
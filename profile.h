@@ -0,0 +1,45 @@
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//branch execution counts of the if, while and for statements of a program
+//every branch gets an id in the AST pre-order, so an instrumented build and a build that uses the profile
+//agree on the numbering as long as they are compiled from the same source
+//the profile file is a sequence of 64-bit little-endian numbers:
+//magic, program hash, branches count, then 2 counters per branch - taken and not taken edges
+class branch_profile{
+public:
+    static constexpr uint64_t magic = 0x464f52504d4e45ull; //"ENMPROF"
+private:
+    struct branch_counts{
+        uint64_t taken = 0;
+        uint64_t not_taken = 0;
+    };
+    std::unordered_map<const class statement*, int> _branch_ids;
+    std::vector<branch_counts> _counts;
+    uint64_t _program_hash = 14695981039346656037ull;
+    bool _has_counts = false;
+
+    void hash_value(uint64_t val) noexcept;
+    void number_branches(const std::shared_ptr<class ast_node>& node);
+public:
+    branch_profile(const std::shared_ptr<class statement>& root);
+
+    //return -1 if the statement is not a numbered branch
+    int get_branch_id(const class statement* stat) const noexcept;
+    inline int get_branches_count() const noexcept{ return _counts.size(); }
+    inline uint64_t get_program_hash() const noexcept{ return _program_hash; }
+
+    //read the counters written by an instrumented executable,
+    //return false if the file doesn't exist or was collected for another program and say why to the errors
+    bool load(const std::string& filename, std::ostream& errors);
+    inline bool has_counts() const noexcept{ return _has_counts; }
+
+    //for an if statement taken means the condition was true,
+    //for a loop taken is the number of iterations and not taken is the number of loop exits
+    uint64_t get_taken_count(const class statement* stat) const noexcept;
+    uint64_t get_not_taken_count(const class statement* stat) const noexcept;
+};
@@ -0,0 +1,90 @@
+#include <iostream>
+#include <stdexcept>
+#include "remarks.h"
+
+std::string remark_emitter::escape_json(const std::string& text){
+    std::string escaped;
+    for(char c : text){
+        switch(c){
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            default:
+                //the other control characters of a file name or a message have no short escape
+                if(static_cast<unsigned char>(c) < 0x20){
+                    escaped += "\\u00";
+                    escaped += "0123456789abcdef"[c >> 4];
+                    escaped += "0123456789abcdef"[c & 0xF];
+                }else{
+                    escaped += c;
+                }
+                break;
+        }
+    }
+    return escaped;
+}
+
+void remark_emitter::show_applied(const std::string& pass){
+    _is_applied_shown = true;
+    if(!pass.empty())
+        _applied_passes.insert(pass);
+}
+
+void remark_emitter::show_missed(const std::string& pass){
+    _is_missed_shown = true;
+    if(!pass.empty())
+        _missed_passes.insert(pass);
+}
+
+void remark_emitter::open_json_file(const std::string& filename){
+    _json_file.open(filename);
+    if(!_json_file.is_open())
+        throw std::runtime_error("can't create the remarks file " + filename + '\n');
+}
+
+void remark_emitter::flush(){
+    if(_json_file.is_open())
+        _json_file.flush();
+}
+
+void remark_emitter::add_source_file(const std::string& filename, int first_line){
+    _source_files.emplace_back(first_line, filename);
+}
+
+bool remark_emitter::is_shown(remark_kind kind, const std::string& pass) const{
+    bool is_kind_shown = kind == remark_kind::APPLIED ? _is_applied_shown : _is_missed_shown;
+    const auto& passes = kind == remark_kind::APPLIED ? _applied_passes : _missed_passes;
+    return is_kind_shown && (passes.empty() || passes.contains(pass));
+}
+
+bool remark_emitter::is_enabled(remark_kind kind, const std::string& pass) const{
+    return _json_file.is_open() || is_shown(kind, pass);
+}
+
+void remark_emitter::emit(remark_kind kind, const std::string& pass, int line, const std::string& message){
+    if(!is_enabled(kind, pass))
+        return;
+    auto key = std::to_string(static_cast<int>(kind)) + ' ' + pass + ' ' + std::to_string(line) + ' ' + message;
+    if(!_emitted.insert(key).second)
+        return;
+    //the file of the line and the line in it
+    std::string filename;
+    int file_line = line;
+    for(const auto& [first_line, name] : _source_files){
+        if(filename.empty() || first_line < line){
+            filename = name;
+            file_line = line == 0 ? 0 : line - first_line;
+        }
+    }
+    const char* kind_name = kind == remark_kind::APPLIED ? "applied" : "missed";
+    if(is_shown(kind, pass)){
+        std::cerr << filename << ':' << file_line << ": remark: " << message
+         << " [-Rpass" << (kind == remark_kind::APPLIED ? "" : "-missed") << '=' << pass << "]\n";
+    }
+    if(_json_file.is_open()){
+        _json_file << "{\"kind\":\"" << kind_name << "\",\"pass\":\"" << escape_json(pass)
+         << "\",\"file\":\"" << escape_json(filename) << "\",\"line\":" << file_line
+         << ",\"message\":\"" << escape_json(message) << "\"}\n";
+    }
+}
@@ -0,0 +1,45 @@
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+enum class remark_kind{
+    //a transformation the pass has done
+    APPLIED,
+    //a transformation the pass has considered and rejected
+    MISSED
+};
+
+//the remarks of the optimizations: text lines of -Rpass and -Rpass-missed on stderr
+//and json lines of all remarks in a file
+class remark_emitter{
+private:
+    bool _is_applied_shown = false;
+    bool _is_missed_shown = false;
+    //the passes whose remarks are shown, empty for all passes
+    std::unordered_set<std::string> _applied_passes;
+    std::unordered_set<std::string> _missed_passes;
+    std::ofstream _json_file;
+    //the first line of every file in the lines of the whole program
+    std::vector<std::pair<int, std::string>> _source_files;
+    //the remarks already emitted: the passes can run more than once
+    std::unordered_set<std::string> _emitted;
+
+    static std::string escape_json(const std::string& text);
+    bool is_shown(remark_kind kind, const std::string& pass) const;
+public:
+    //an empty pass name shows the remarks of all passes
+    void show_applied(const std::string& pass);
+    void show_missed(const std::string& pass);
+    //throw std::runtime_error if the file can't be created
+    void open_json_file(const std::string& filename);
+    //write the buffered json lines, for a process that ends without the destructors
+    void flush();
+    //the lines of the program after first_line belong to the file, up to the first line of the next one
+    void add_source_file(const std::string& filename, int first_line);
+
+    //the passes can skip making the messages nobody reads
+    bool is_enabled(remark_kind kind, const std::string& pass) const;
+    //the line is the line of the program, 0 if it isn't known
+    void emit(remark_kind kind, const std::string& pass, int line, const std::string& message);
+};
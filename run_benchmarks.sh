@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# every benchmarks/<pass_name>.em is compiled with and without the pass (underscores become dashes)
+cd build/
+cmake ..
+make
+
+echo ""
+TIMEFORMAT="%R s"
+for bench in ../benchmarks/*.em
+    do
+    name="${bench#../benchmarks/}"
+    name="${name%.em}"
+    pass="${name//_/-}"
+    ./enma "${bench}" -o bench_on > /dev/null
+    ./enma "${bench}" -o bench_off --disable-pass="${pass}" > /dev/null
+
+    for variant in bench_on bench_off
+        do
+        if command -v perf > /dev/null
+            then
+                misses=$(perf stat -x, -e branch-misses ./${variant} 2>&1 > /dev/null | cut -d, -f1)
+            else
+                misses="n/a"
+            fi
+        elapsed=$( { time ./${variant} > /dev/null; } 2>&1 )
+        echo "${name} - ${variant#bench_} ${pass}: ${elapsed}, branch misses: ${misses}"
+        done
+    done
+    rm -f bench_on bench_off bench_on.o bench_off.o ../benchmarks/*.asm
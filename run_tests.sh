@@ -1,23 +1,46 @@
 #!/bin/bash
 
+# the arguments are passed to enma, e.g. ./run_tests.sh -Os
+# the tests run a second time without the partial evaluation, which folds most of them to one constant output,
+# so the passes they were written for compile them again
 cd build/
 cmake ..
 make
 
-echo ""
-for test in ../tests/*.em
-    do
-    test="${test%.em}"
-    ./enma "${test}.em"
-    
-    ./output > result
-    if ! cmp "${test}_res" result -s 
-        then
-            echo "${test#../tests/*} - FAILED"
-        else
-            echo "${test#../tests/*} - success"
-        fi
-    done
-    rm -f result ../tests/*.asm output output.o
+run_suite(){
+    for test in ../tests/*.em
+        do
+        test="${test%.em}"
+        ./enma "${test}.em" "$@"
+
+        ./output > result
+        if ! cmp "${test}_res" result -s
+            then
+                echo "${test#../tests/*} - FAILED"
+            else
+                echo "${test#../tests/*} - success"
+            fi
+        done
+    # the files of a tests/<name>/ directory are one program
+    for test in ../tests/*/
+        do
+        test="${test%/}"
+        ./enma "${test}"/*.em "$@"
+
+        ./output > result
+        if ! cmp "${test}_res" result -s
+            then
+                echo "${test#../tests/*} - FAILED"
+            else
+                echo "${test#../tests/*} - success"
+            fi
+        done
+}
 
+echo ""
+run_suite "$@"
+echo ""
+echo "without partial evaluation"
+run_suite "$@" --disable-pass=partial-evaluation
+    rm -f result ../tests/*.asm output.asm output output.o
 
@@ -0,0 +1,160 @@
+#include <sstream>
+#include "runtime_library.h"
+#include "asm_program.h"
+#include "x86_encoder.h"
+#include "elf_object.h"
+
+//printf converts the number from the end of _ENMA_DIGITS and copies it to the buffer,
+//the buffer is written when the next number doesn't fit it and at fflush, a short write is continued
+//fwrite copies the bytes to the same buffer, writing it whenever it's full, so the output computed at compile time
+//is buffered like the output of printf and lost the same way when the program faults before fflush
+//the data is addressed relative to rip, so the same code is linked into the executables and the shared libraries
+const char* runtime_library::_code = R"(section .note.GNU-stack
+section .text
+	extern main
+	global _start
+	global printf
+	global fflush
+	global fwrite
+	global stdout
+_start:
+	call main
+	mov rdi, rax
+	mov rax, 60
+	syscall
+
+printf:
+	mov rax, rsi
+	shl rax, 32
+	sar rax, 32
+	mov r9, rax
+	test rax, rax
+	jns _ENMA_PRINT_POSITIVE
+	neg rax
+_ENMA_PRINT_POSITIVE:
+	lea r8, [rel _ENMA_DIGITS + 19]
+	mov byte [r8], 10
+	mov rcx, 10
+_ENMA_PRINT_DIGIT:
+	xor edx, edx
+	div rcx
+	add dl, 48
+	dec r8
+	mov [r8], dl
+	test rax, rax
+	jnz _ENMA_PRINT_DIGIT
+	test r9, r9
+	jns _ENMA_PRINT_COPY
+	dec r8
+	mov byte [r8], 45
+_ENMA_PRINT_COPY:
+	lea rcx, [rel _ENMA_DIGITS + 20]
+	sub rcx, r8
+	mov rax, [rel _ENMA_OUTPUT_SIZE]
+	lea rdx, [rax + rcx]
+	cmp rdx, 4096
+	jbe _ENMA_PRINT_BUFFER
+	push rcx
+	push r8
+	call fflush
+	pop r8
+	pop rcx
+	xor eax, eax
+_ENMA_PRINT_BUFFER:
+	lea rdi, [rel _ENMA_OUTPUT]
+_ENMA_PRINT_BYTE:
+	mov dl, [r8]
+	mov [rdi + rax], dl
+	inc rax
+	inc r8
+	dec rcx
+	jnz _ENMA_PRINT_BYTE
+	mov [rel _ENMA_OUTPUT_SIZE], rax
+	ret
+
+fflush:
+	lea rsi, [rel _ENMA_OUTPUT]
+	mov rdx, [rel _ENMA_OUTPUT_SIZE]
+_ENMA_FLUSH_WRITE:
+	test rdx, rdx
+	jle _ENMA_FLUSH_END
+	mov rax, 1
+	mov rdi, 1
+	syscall
+	test rax, rax
+	jle _ENMA_FLUSH_END
+	add rsi, rax
+	sub rdx, rax
+	jmp _ENMA_FLUSH_WRITE
+_ENMA_FLUSH_END:
+	mov qword [rel _ENMA_OUTPUT_SIZE], 0
+	xor eax, eax
+	ret
+
+fwrite:
+	mov r8, rdi
+	mov r9, rdx
+	mov rax, [rel _ENMA_OUTPUT_SIZE]
+	lea rdi, [rel _ENMA_OUTPUT]
+_ENMA_WRITE_BYTE:
+	test r9, r9
+	jz _ENMA_WRITE_END
+	cmp rax, 4096
+	jb _ENMA_WRITE_COPY
+	mov [rel _ENMA_OUTPUT_SIZE], rax
+	push r8
+	push r9
+	call fflush
+	pop r9
+	pop r8
+	lea rdi, [rel _ENMA_OUTPUT]
+_ENMA_WRITE_COPY:
+	mov dl, [r8]
+	mov [rdi + rax], dl
+	inc rax
+	inc r8
+	dec r9
+	jmp _ENMA_WRITE_BYTE
+_ENMA_WRITE_END:
+	mov [rel _ENMA_OUTPUT_SIZE], rax
+	ret
+
+section .data
+	stdout dq 0
+	_ENMA_OUTPUT_SIZE dq 0
+	_ENMA_DIGITS times 20 db 0
+	_ENMA_OUTPUT times 4096 db 0
+)";
+
+const elf_object& runtime_library::get_object(){
+    static const elf_object runtime = x86_encoder().encode(asm_program(_code));
+    return runtime;
+}
+
+std::string runtime_library::get_entry_code(const std::string& name){
+    //six pushes and the slot keep the stack of main aligned like after a call from C
+    std::ostringstream code;
+    code << "\tglobal " << name << '\n'
+         << name << ":\n"
+         << "\tpush rbx\n"
+         << "\tpush rbp\n"
+         << "\tpush r12\n"
+         << "\tpush r13\n"
+         << "\tpush r14\n"
+         << "\tpush r15\n"
+         << "\tsub rsp, 8\n"
+         << "\tcall main\n"
+         << "\tadd rsp, 8\n"
+         << "\tpop r15\n"
+         << "\tpop r14\n"
+         << "\tpop r13\n"
+         << "\tpop r12\n"
+         << "\tpop rbp\n"
+         << "\tpop rbx\n"
+         << "\tret\n";
+    return code.str();
+}
+
+elf_object runtime_library::get_entry_object(const std::string& name){
+    return x86_encoder().encode(asm_program("section .note.GNU-stack\nsection .text\n\textern main\n" + get_entry_code(name)));
+}
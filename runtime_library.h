@@ -0,0 +1,21 @@
+#include <string>
+
+class elf_object;
+
+//the part of the C library the generated code calls, for the executables of the built-in linker:
+//printf prints the low half of rsi as "%d\n" to a buffer, fflush writes the buffer with the write syscall,
+//stdout is only the argument of fflush, _start calls main
+//it's written in the assembly of the code generator and encoded with it, so it needs no assembler either
+class runtime_library{
+private:
+    static const char* _code;
+public:
+    //encoded by the first call and shared by all compilations of the process,
+    //throw std::runtime_error if the encoder can't encode the code
+    static const elf_object& get_object();
+    //the text of a global function that calls main of the code generated with code_generator::set_returning from C:
+    //it saves the registers main doesn't save and the C caller keeps
+    static std::string get_entry_code(const std::string& name);
+    //the entry function in an object of its own, for a shared library
+    static elf_object get_entry_object(const std::string& name);
+};
@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# the .text size of every program compiled with the default -O2 and with -Os,
+# then without the partial evaluation, which folds most programs to one constant output
+cd build/
+cmake ..
+make
+
+report(){
+    printf "%-32s %8s %8s %8s\n" "program" "-O2" "-Os" "change"
+    for program in ../tests/*.em ../benchmarks/*.em
+        do
+        name="${program#../}"
+        ./enma "${program}" -o size_o2 "$@" > /dev/null
+        ./enma "${program}" -o size_os -Os "$@" > /dev/null
+        o2=$(size -A size_o2.o | awk '$1 == ".text" {print $2}')
+        os=$(size -A size_os.o | awk '$1 == ".text" {print $2}')
+        printf "%-32s %8d %8d %7d%%\n" "${name}" "${o2}" "${os}" "$(( (os - o2) * 100 / o2 ))"
+        done
+}
+
+echo ""
+report
+echo ""
+echo "--eval-steps=0"
+report --eval-steps=0
+    rm -f size_o2 size_os size_o2.o size_os.o ../tests/*.asm ../benchmarks/*.asm
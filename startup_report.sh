@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# the milliseconds from the start of the compiler to the first line of the output of every program:
+# compiled to an executable on disk and run, built with nasm and gcc (--emit=asm) and run, and run in memory with --run
+cd build/
+cmake ..
+make
+
+# run the command and print the microseconds until its first line of output
+first_output(){
+    local start=${EPOCHREALTIME/./}
+    "$@" 2> /dev/null | { read -r line; end=${EPOCHREALTIME/./}; cat > /dev/null; echo $(( end - start )); }
+}
+milliseconds(){
+    printf "%d.%02d" $(( $1 / 1000 )) $(( $1 % 1000 / 10 ))
+}
+
+echo ""
+printf "%-32s %8s %8s %8s\n" "program" "aot" "asm" "--run"
+for program in ../tests/*.em ../benchmarks/*.em
+    do
+    name="${program#../}"
+    aot=$(first_output bash -c "./enma '${program}' -o startup_aot > /dev/null && ./startup_aot")
+    asm="-"
+    if command -v nasm > /dev/null
+        then
+            asm=$(milliseconds "$(first_output bash -c "./enma '${program}' -o startup_asm --emit=asm > /dev/null && ./startup_asm")")
+        fi
+    run=$(first_output bash -c "./enma '${program}' --run")
+    printf "%-32s %8s %8s %8s\n" "${name}" "$(milliseconds "${aot}")" "${asm}" "$(milliseconds "${run}")"
+    done
+    rm -f startup_aot startup_aot.o startup_asm startup_asm.o ../tests/*.asm ../benchmarks/*.asm
@@ -0,0 +1,459 @@
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "superoptimizer.h"
+#include "ast.h"
+
+void rewrite_database::load(const std::string& filename){
+    std::ifstream file(filename);
+    std::string line;
+    int line_number = 0;
+    while(std::getline(file, line)){
+        line_number++;
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string key, count, instructions;
+        std::getline(fields, key, '\t');
+        std::getline(fields, count, '\t');
+        std::getline(fields, instructions);
+        rewrite sequence;
+        if(count != "-"){
+            try{
+                sequence.registers_count = std::stoi(count);
+            }catch(std::logic_error&){
+                throw std::runtime_error(filename + ':' + std::to_string(line_number) + ": malformed superoptimizer database line\n");
+            }
+            std::istringstream list(instructions);
+            std::string instruction;
+            while(std::getline(list, instruction, ';')){
+                auto begin = instruction.find_first_not_of(' ');
+                if(begin != std::string::npos)
+                    sequence.instructions.push_back(instruction.substr(begin));
+            }
+            if(sequence.instructions.empty() || sequence.registers_count < 1)
+                throw std::runtime_error(filename + ':' + std::to_string(line_number) + ": malformed superoptimizer database line\n");
+        }
+        _rewrites[key] = sequence;
+    }
+}
+
+void rewrite_database::save(const std::string& filename) const{
+    std::ofstream file(filename);
+    if(!file.is_open())
+        throw std::runtime_error("can't write the superoptimizer database " + filename + '\n');
+    file << "# enma --superopt: <template>\\t<registers count>\\t<instructions>, '-' if the generated code is the best\n";
+    for(const auto& [key, sequence] : _rewrites){
+        file << key << '\t';
+        if(sequence.instructions.empty()){
+            file << "-\n";
+            continue;
+        }
+        file << sequence.registers_count << '\t';
+        for(size_t i = 0; i < sequence.instructions.size(); i++){
+            file << (i ? "; " : "") << sequence.instructions[i];
+        }
+        file << '\n';
+    }
+}
+
+const rewrite_database::rewrite* rewrite_database::find(const std::string& key) const{
+    auto it = _rewrites.find(key);
+    return it == _rewrites.end() ? nullptr : &it->second;
+}
+
+superoptimizer::superoptimizer(bool is_verbose) : _is_verbose(is_verbose){}
+
+int superoptimizer::get_latency(const instruction& instr){
+    return instr.op == opcode::IMUL || instr.op == opcode::IMUL_IMM ? 3 : 1;
+}
+
+int64_t superoptimizer::wrap(uint64_t value, int bits){
+    //the value of a register of the width, sign extended
+    int shift = 64 - bits;
+    return static_cast<int64_t>(value << shift) >> shift;
+}
+
+int64_t superoptimizer::evaluate(const std::shared_ptr<expression>& expr, const std::vector<int>& inputs,
+ const std::vector<int64_t>& values, int bits){
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+            return wrap(std::static_pointer_cast<number_expression>(expr)->get_number(), bits);
+        case ast_node_type::ID:{
+            int id = std::static_pointer_cast<identifier_expression>(expr)->get_id();
+            for(size_t i = 0; i < inputs.size(); i++){
+                if(inputs[i] == id)
+                    return values[i];
+            }
+            throw std::runtime_error("superoptimizer: unknown template input\n");
+        }
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            uint64_t left = evaluate(bin_expr->get_left(), inputs, values, bits);
+            uint64_t right = evaluate(bin_expr->get_right(), inputs, values, bits);
+            switch (expr->get_type()){
+                case ast_node_type::ADD: return wrap(left + right, bits);
+                case ast_node_type::SUB: return wrap(left - right, bits);
+                case ast_node_type::MUL: return wrap(left * right, bits);
+                //the templates divide only by positive constants
+                case ast_node_type::DIV: return wrap(static_cast<int64_t>(left) / static_cast<int64_t>(right), bits);
+                default:
+                    throw std::runtime_error("superoptimizer: unknown template operation\n");
+            }
+        }
+    }
+}
+
+void superoptimizer::execute(const instruction& instr, std::vector<int64_t>& registers, int bits){
+    uint64_t dest = registers[instr.dest];
+    uint64_t source = registers[instr.source];
+    int shift = instr.is_width_relative ? bits - instr.immediate : instr.immediate;
+    switch (instr.op){
+        case opcode::MOV: registers[instr.dest] = source; break;
+        case opcode::MOV_IMM: registers[instr.dest] = wrap(instr.immediate, bits); break;
+        case opcode::ADD: registers[instr.dest] = wrap(dest + source, bits); break;
+        case opcode::SUB: registers[instr.dest] = wrap(dest - source, bits); break;
+        case opcode::IMUL: registers[instr.dest] = wrap(dest * source, bits); break;
+        case opcode::ADD_IMM: registers[instr.dest] = wrap(dest + instr.immediate, bits); break;
+        case opcode::IMUL_IMM: registers[instr.dest] = wrap(source * instr.immediate, bits); break;
+        case opcode::NEG: registers[instr.dest] = wrap(0 - dest, bits); break;
+        case opcode::SHL: registers[instr.dest] = wrap(dest << shift, bits); break;
+        case opcode::SAR: registers[instr.dest] = registers[instr.dest] >> shift; break;
+        case opcode::SHR:{
+            uint64_t mask = bits == 64 ? ~0ull : (1ull << bits) - 1;
+            registers[instr.dest] = wrap((dest & mask) >> shift, bits);
+            break;
+        }
+        case opcode::LEA:
+            registers[instr.dest] = wrap(source + static_cast<uint64_t>(registers[instr.index]) * instr.immediate, bits);
+            break;
+    }
+}
+
+std::string superoptimizer::to_text(const instruction& instr){
+    auto reg = [](int index){ return '%' + std::to_string(index); };
+    auto dest = reg(instr.dest);
+    int shift = instr.is_width_relative ? 64 - instr.immediate : instr.immediate;
+    switch (instr.op){
+        case opcode::MOV: return "mov " + dest + ", " + reg(instr.source);
+        case opcode::MOV_IMM: return "mov " + dest + ", " + std::to_string(instr.immediate);
+        case opcode::ADD: return "add " + dest + ", " + reg(instr.source);
+        case opcode::SUB: return "sub " + dest + ", " + reg(instr.source);
+        case opcode::IMUL: return "imul " + dest + ", " + reg(instr.source);
+        case opcode::ADD_IMM: return "add " + dest + ", " + std::to_string(instr.immediate);
+        case opcode::IMUL_IMM: return "imul " + dest + ", " + reg(instr.source) + ", " + std::to_string(instr.immediate);
+        case opcode::NEG: return "neg " + dest;
+        case opcode::SHL: return "shl " + dest + ", " + std::to_string(shift);
+        case opcode::SAR: return "sar " + dest + ", " + std::to_string(shift);
+        case opcode::SHR: return "shr " + dest + ", " + std::to_string(shift);
+        case opcode::LEA:
+            return "lea " + dest + ", [" + reg(instr.source) + " + " + reg(instr.index) + '*' + std::to_string(instr.immediate) + ']';
+    }
+    return "";
+}
+
+int superoptimizer::get_generated_cost(const std::shared_ptr<expression>& expr){
+    //the code generator loads every leaf to a register and computes every node with one instruction
+    switch (expr->get_type()){
+        case ast_node_type::NUM:
+        case ast_node_type::ID:
+            return 1;
+        default:{
+            const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+            int cost = expr->get_type() == ast_node_type::MUL ? 3 : expr->get_type() == ast_node_type::DIV ? 26 : 1;
+            return cost + get_generated_cost(bin_expr->get_left()) + get_generated_cost(bin_expr->get_right());
+        }
+    }
+}
+
+std::string superoptimizer::make_template(const expression* expr, std::vector<int>& inputs, int& operations){
+    switch (expr->get_type()){
+        case ast_node_type::NUM:{
+            int number = static_cast<const number_expression*>(expr)->get_number();
+            return number < -_max_constant || number > _max_constant ? "" : std::to_string(number);
+        }
+        case ast_node_type::ID:{
+            int id = static_cast<const identifier_expression*>(expr)->get_id();
+            size_t index = 0;
+            while(index < inputs.size() && inputs[index] != id){
+                index++;
+            }
+            if(index == inputs.size()){
+                if(inputs.size() == _max_inputs)
+                    return "";
+                inputs.push_back(id);
+            }
+            return 'x' + std::to_string(index);
+        }
+        case ast_node_type::ADD:
+        case ast_node_type::SUB:
+        case ast_node_type::MUL:
+        case ast_node_type::DIV:{
+            const auto* bin_expr = static_cast<const binary_expression*>(expr);
+            if(++operations > _max_operations)
+                return "";
+            //a division by a variable can fault, the sequence can't change that
+            const auto& divisor = bin_expr->get_right();
+            if(expr->get_type() == ast_node_type::DIV && (divisor->get_type() != ast_node_type::NUM ||
+             std::static_pointer_cast<number_expression>(divisor)->get_number() <= 0))
+                return "";
+            auto left = make_template(bin_expr->get_left().get(), inputs, operations);
+            auto right = make_template(bin_expr->get_right().get(), inputs, operations);
+            if(left.empty() || right.empty())
+                return "";
+            const char* operation = expr->get_type() == ast_node_type::ADD ? "+" : expr->get_type() == ast_node_type::SUB ? "-" :
+             expr->get_type() == ast_node_type::MUL ? "*" : "/";
+            return '(' + left + operation + right + ')';
+        }
+        default:
+            return "";
+    }
+}
+
+std::string superoptimizer::get_template(const expression* expr, std::vector<int>& inputs){
+    inputs.clear();
+    int operations = 0;
+    auto key = make_template(expr, inputs, operations);
+    if(inputs.empty())
+        return "";
+    return key;
+}
+
+std::vector<superoptimizer::instruction> superoptimizer::make_alphabet(const expression_template& pattern, int registers_count) const{
+    std::vector<int64_t> constants;
+    std::function<void(const std::shared_ptr<expression>&)> collect_constants = [&](const std::shared_ptr<expression>& expr){
+        if(expr->get_type() == ast_node_type::NUM){
+            int64_t number = std::static_pointer_cast<number_expression>(expr)->get_number();
+            if(std::find(constants.begin(), constants.end(), number) == constants.end())
+                constants.push_back(number);
+        }else if(expr->get_type() != ast_node_type::ID){
+            collect_constants(std::static_pointer_cast<binary_expression>(expr)->get_left());
+            collect_constants(std::static_pointer_cast<binary_expression>(expr)->get_right());
+        }
+    };
+    collect_constants(pattern.expr);
+    //the shifts by the powers of two of the constants, the sign of a register is the shift by the width minus 1
+    std::vector<int64_t> shifts = {1};
+    for(auto number : constants){
+        for(int bit = 2; bit < 8; bit++){
+            if(std::abs(number) == (1ll << bit) && std::find(shifts.begin(), shifts.end(), bit) == shifts.end())
+                shifts.push_back(bit);
+        }
+    }
+
+    std::vector<instruction> alphabet;
+    for(int dest = 0; dest < registers_count; dest++){
+        for(int source = 0; source < registers_count; source++){
+            if(source != dest){
+                alphabet.push_back({opcode::MOV, dest, source});
+                alphabet.push_back({opcode::SUB, dest, source});
+            }
+            alphabet.push_back({opcode::ADD, dest, source});
+            alphabet.push_back({opcode::IMUL, dest, source});
+            for(int index = 0; index < registers_count; index++){
+                for(int scale : {1, 2, 4, 8}){
+                    alphabet.push_back({opcode::LEA, dest, source, index, scale});
+                }
+            }
+            for(auto number : constants){
+                alphabet.push_back({opcode::IMUL_IMM, dest, source, 0, number});
+            }
+        }
+        for(auto number : constants){
+            alphabet.push_back({opcode::MOV_IMM, dest, 0, 0, number});
+            alphabet.push_back({opcode::ADD_IMM, dest, 0, 0, number});
+        }
+        alphabet.push_back({opcode::NEG, dest});
+        for(auto shift : shifts){
+            alphabet.push_back({opcode::SHL, dest, 0, 0, shift});
+            alphabet.push_back({opcode::SAR, dest, 0, 0, shift});
+            alphabet.push_back({opcode::SHR, dest, 0, 0, shift});
+            alphabet.push_back({opcode::SAR, dest, 0, 0, shift, true});
+            alphabet.push_back({opcode::SHR, dest, 0, 0, shift, true});
+        }
+    }
+    return alphabet;
+}
+
+bool superoptimizer::is_equivalent(const std::vector<instruction>& sequence, const expression_template& pattern, int registers_count) const{
+    std::mt19937_64 random(pattern.key.size());
+    int inputs_count = pattern.inputs.size();
+    std::vector<int64_t> values(inputs_count);
+    std::vector<int64_t> registers(registers_count);
+    //the temporary registers keep whatever the code before left there
+    auto run = [&](int bits){
+        for(int i = 0; i < registers_count; i++){
+            registers[i] = i < inputs_count ? values[i] : wrap(random(), bits);
+        }
+        for(const auto& instr : sequence){
+            execute(instr, registers, bits);
+        }
+        return registers[0] == evaluate(pattern.expr, pattern.inputs, values, bits);
+    };
+
+    const int64_t special_values[] = {0, 1, -1, 2, -2, INT64_MAX, INT64_MIN, INT64_MAX - 1, INT64_MIN + 1};
+    for(int test = 0; test < _random_tests_count; test++){
+        for(auto& value : values){
+            value = test < 100 ? special_values[random() % std::size(special_values)] : static_cast<int64_t>(random());
+        }
+        if(!run(64))
+            return false;
+    }
+    //a narrow width has few enough inputs to check every one of them
+    int bits = inputs_count == 1 ? 16 : 8;
+    int64_t min_value = -(1ll << (bits - 1)), max_value = (1ll << (bits - 1)) - 1;
+    for(int64_t first = min_value; first <= max_value; first++){
+        values[0] = first;
+        for(int64_t second = min_value; second <= (inputs_count == 2 ? max_value : min_value); second++){
+            if(inputs_count == 2)
+                values[1] = second;
+            if(!run(bits))
+                return false;
+        }
+    }
+    return true;
+}
+
+std::vector<superoptimizer::instruction> superoptimizer::search(const expression_template& pattern, int registers_count) const{
+    auto alphabet = make_alphabet(pattern, registers_count);
+    int inputs_count = pattern.inputs.size();
+
+    //the registers of the quick tests, one array after another
+    std::mt19937_64 random(pattern.key.size());
+    std::vector<int64_t> expected(_quick_tests_count);
+    std::vector<std::vector<int64_t>> states(_max_length + 1, std::vector<int64_t>(_quick_tests_count * registers_count));
+    for(int test = 0; test < _quick_tests_count; test++){
+        std::vector<int64_t> values(inputs_count);
+        for(auto& value : values){
+            value = test == 0 ? -7 : static_cast<int64_t>(random());
+        }
+        for(int i = 0; i < registers_count; i++){
+            states[0][test * registers_count + i] = i < inputs_count ? values[i] : static_cast<int64_t>(random());
+        }
+        expected[test] = evaluate(pattern.expr, pattern.inputs, values, 64);
+    }
+
+    //the loads of the inputs are the same for both, the sequence has to be faster than the rest of the generated code
+    int best_cost = get_generated_cost(pattern.expr) - inputs_count;
+    std::vector<instruction> current, best;
+    int64_t candidates_count = 0;
+    std::vector<int64_t> registers(registers_count);
+    std::function<void(int, int)> extend = [&](int depth, int cost){
+        for(const auto& instr : alphabet){
+            int new_cost = cost + get_latency(instr);
+            if(new_cost >= best_cost)
+                continue;
+            if(++candidates_count > _max_candidates)
+                return;
+            auto& next = states[depth + 1];
+            bool is_match = instr.dest == 0;
+            for(int test = 0; test < _quick_tests_count; test++){
+                auto first = states[depth].begin() + test * registers_count;
+                registers.assign(first, first + registers_count);
+                execute(instr, registers, 64);
+                std::copy(registers.begin(), registers.end(), next.begin() + test * registers_count);
+                is_match = is_match && registers[0] == expected[test];
+            }
+            current.push_back(instr);
+            if(is_match && is_equivalent(current, pattern, registers_count)){
+                //a longer sequence costs more
+                best = current;
+                best_cost = new_cost;
+            }else if(depth + 1 < _max_length){
+                extend(depth + 1, new_cost);
+            }
+            current.pop_back();
+        }
+    };
+    extend(0, 0);
+    if(_is_verbose)
+        std::cout << "superopt: " << pattern.key << " - " << candidates_count << " sequences tried\n";
+    return best;
+}
+
+void superoptimizer::collect_templates(const std::shared_ptr<expression>& expr, std::map<std::string, expression_template>& templates) const{
+    if(!expr || expr->get_type() == ast_node_type::NUM || expr->get_type() == ast_node_type::ID)
+        return;
+    std::vector<int> inputs;
+    auto key = get_template(expr.get(), inputs);
+    if(!key.empty())
+        templates.try_emplace(key, expression_template{key, expr, inputs});
+    const auto& bin_expr = std::static_pointer_cast<binary_expression>(expr);
+    collect_templates(bin_expr->get_left(), templates);
+    collect_templates(bin_expr->get_right(), templates);
+}
+
+void superoptimizer::collect_templates(const std::shared_ptr<statement>& stat, std::map<std::string, expression_template>& templates) const{
+    for(auto node = stat; node; node = node->get_next()){
+        switch (node->get_type()){
+            case ast_node_type::PRINT:
+                collect_templates(std::static_pointer_cast<print_statement>(node)->get_expression(), templates);
+                break;
+            case ast_node_type::VAR_DECL:
+            case ast_node_type::ASSIGN:
+                collect_templates(std::static_pointer_cast<statement_with_id>(node)->get_expression(), templates);
+                break;
+            case ast_node_type::COMPOUND:
+                collect_templates(std::static_pointer_cast<compound_statement>(node)->get_inner_statement(), templates);
+                break;
+            case ast_node_type::IF_HEAD:{
+                const auto& if_stat = std::static_pointer_cast<if_statement>(node);
+                collect_templates(if_stat->get_conditional_expression(), templates);
+                collect_templates(if_stat->get_if_inner_statement(), templates);
+                collect_templates(if_stat->get_else_inner_statement(), templates);
+                break;
+            }
+            case ast_node_type::WHILE_LOOP:{
+                const auto& while_stat = std::static_pointer_cast<while_statement>(node);
+                collect_templates(while_stat->get_conditional_expression(), templates);
+                collect_templates(while_stat->get_inner_statement(), templates);
+                break;
+            }
+            case ast_node_type::FOR_LOOP:{
+                const auto& for_stat = std::static_pointer_cast<for_statement>(node);
+                collect_templates(for_stat->get_start_statement()->get_expression(), templates);
+                collect_templates(for_stat->get_final_expression(), templates);
+                collect_templates(for_stat->get_after_iter_expression(), templates);
+                collect_templates(for_stat->get_inner_statement(), templates);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+int superoptimizer::optimize(const std::shared_ptr<statement>& root, rewrite_database& database) const{
+    std::map<std::string, expression_template> templates;
+    collect_templates(root, templates);
+    int found_count = 0;
+    for(const auto& [key, pattern] : templates){
+        if(database.find(key))
+            continue;
+        int registers_count = pattern.inputs.size() + _temporary_registers_count;
+        auto sequence = search(pattern, registers_count);
+        rewrite_database::rewrite rewrite;
+        for(const auto& instr : sequence){
+            rewrite.instructions.push_back(to_text(instr));
+            rewrite.registers_count = std::max({rewrite.registers_count, instr.dest + 1, instr.source + 1,
+             instr.op == opcode::LEA ? instr.index + 1 : 0, static_cast<int>(pattern.inputs.size())});
+        }
+        database.add(key, rewrite);
+        if(sequence.empty()){
+            std::cout << key << ": the generated code is the best\n";
+            continue;
+        }
+        found_count++;
+        int cost = pattern.inputs.size();
+        for(const auto& instr : sequence){
+            cost += get_latency(instr);
+        }
+        std::cout << key << ": " << sequence.size() << " instructions, " << get_generated_cost(pattern.expr) << " -> " << cost << " cycles\n";
+    }
+    return found_count;
+}
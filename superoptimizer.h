@@ -0,0 +1,108 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+//the best known instruction sequences of the expression templates, kept in a text file between the runs
+//a line is "<template>\t<registers count>\t<instruction>; <instruction>...", the registers are %0, %1...,
+//the inputs x0, x1... are loaded to the first registers and the result is left in %0;
+//"<template>\t-" marks a template the search found nothing better for
+class rewrite_database{
+public:
+    struct rewrite{
+        int registers_count = 0;
+        //empty if the generated code is the best known
+        std::vector<std::string> instructions;
+    };
+private:
+    std::map<std::string, rewrite> _rewrites;
+public:
+    //a missing file is an empty database, throw std::runtime_error for a malformed line
+    void load(const std::string& filename);
+    //throw std::runtime_error if the file can't be written
+    void save(const std::string& filename) const;
+
+    //return nullptr if the template wasn't searched
+    const rewrite* find(const std::string& key) const;
+    inline void add(const std::string& key, const rewrite& sequence){ _rewrites[key] = sequence; }
+    inline int get_size() const noexcept{ return _rewrites.size(); }
+};
+
+//offline search of the shortest x86-64 sequences for small arithmetic expressions of a program
+//the sequences are enumerated over a few instructions (mov, add, sub, imul, neg, shifts, lea) and checked on an emulator:
+//first on random 64-bit inputs, then on every input of a narrow width, so the shift amounts depend on the width
+class superoptimizer{
+private:
+    enum class opcode{
+        MOV,
+        MOV_IMM,
+        ADD,
+        SUB,
+        IMUL,
+        ADD_IMM,
+        IMUL_IMM,
+        NEG,
+        SHL,
+        SAR,
+        SHR,
+        LEA
+    };
+    struct instruction{
+        opcode op;
+        int dest;
+        int source = 0;
+        //the index register of lea
+        int index = 0;
+        //the immediate, the shift amount or the scale of lea
+        int64_t immediate = 0;
+        //the shift amount is the width minus the immediate
+        bool is_width_relative = false;
+    };
+    struct expression_template{
+        std::string key;
+        std::shared_ptr<class expression> expr;
+        //identifier codes of x0, x1...
+        std::vector<int> inputs;
+    };
+
+    static constexpr int _max_operations = 3;
+    static constexpr int _max_inputs = 2;
+    //the constants fit the exhaustive check width
+    static constexpr int _max_constant = 127;
+    static constexpr int _max_length = 4;
+    static constexpr int _temporary_registers_count = 1;
+    //the sequences tried for a template, the search of a template stops after them
+    static constexpr int64_t _max_candidates = 20000000;
+    static constexpr int _random_tests_count = 10000;
+    //the quick tests every candidate runs before the full check
+    static constexpr int _quick_tests_count = 8;
+
+    bool _is_verbose;
+private:
+    static int get_latency(const instruction& instr);
+    static int64_t wrap(uint64_t value, int bits);
+    static int64_t evaluate(const std::shared_ptr<class expression>& expr, const std::vector<int>& inputs,
+     const std::vector<int64_t>& values, int bits);
+    static void execute(const instruction& instr, std::vector<int64_t>& registers, int bits);
+    static std::string to_text(const instruction& instr);
+    static int get_generated_cost(const std::shared_ptr<class expression>& expr);
+    static std::string make_template(const class expression* expr, std::vector<int>& inputs, int& operations);
+
+    std::vector<instruction> make_alphabet(const expression_template& pattern, int registers_count) const;
+    //random 64-bit inputs and all inputs of 8 or 16 bits
+    bool is_equivalent(const std::vector<instruction>& sequence, const expression_template& pattern, int registers_count) const;
+    //return an empty sequence if nothing is cheaper than the generated code
+    std::vector<instruction> search(const expression_template& pattern, int registers_count) const;
+    void collect_templates(const std::shared_ptr<class expression>& expr, std::map<std::string, expression_template>& templates) const;
+    void collect_templates(const std::shared_ptr<class statement>& stat, std::map<std::string, expression_template>& templates) const;
+public:
+    superoptimizer(bool is_verbose = false);
+
+    //the template of an expression: "(x0*5)", the inputs get the identifier codes of x0, x1...
+    //return an empty string if the expression isn't a small arithmetic expression
+    static std::string get_template(const class expression* expr, std::vector<int>& inputs);
+
+    //search the templates of the program which aren't in the database, return the number of added sequences
+    int optimize(const std::shared_ptr<class statement>& root, rewrite_database& database) const;
+};
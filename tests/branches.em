@@ -0,0 +1,29 @@
+let a = 0;
+let hits = 0;
+let misses = 0;
+for => (let i = 0 to 1200){
+    if => (i < 1190){
+        hits = hits + 1;
+    }else{
+        misses = misses + 1;
+    }
+    if => (i == 600){
+        print(i);
+    }
+    let j = 0;
+    while => (j < 3){
+        a = a + j;
+        j = j + 1;
+    }
+}
+print(hits);
+print(misses);
+print(a);
+if => (a > 0){ print(1); }
+if => (a > 1){ print(2); }
+if => (a > 2){ print(3); }
+if => (a > 3){ print(4); }
+if => (a > 4){ print(5); }
+if => (a > 5){ print(6); }
+if => (a > 6){ print(7); }
+if => (a > 7){ print(8); }
@@ -0,0 +1,26 @@
+let a = 5;
+let unused = a * 3 + 7;
+a = 11 - 6 * 2 / 3;
+let b = a;
+a = 2;
+print(b);
+let sum = 0;
+let last = 0;
+for => (let i = 0 to 5){
+    last = i * 2;
+    sum = sum + last;
+    unused = sum / 2;
+}
+print(sum);
+let x = 1;
+if => (sum > 10){
+    x = 2;
+    print(x + 1);
+}
+print(x);
+let c = 0;
+while => (c < 3){
+    let t = c + 1;
+    c = t;
+}
+print(c);
@@ -0,0 +1,55 @@
+let a = 0;
+let b = 1;
+let c = 0;
+let n = 8;
+for => (let i = 0 to n){
+    a = a + i;
+}
+for => (let j = 0 to n){
+    b = b + j * 2;
+}
+for => (let k = 0 to n){
+    c = c + k;
+}
+print(a);
+print(b);
+print(c);
+print(j);
+print(k);
+let s = 0;
+for => (let p = 0 to 6 : 2){
+    s = s + 1;
+}
+for => (let q = 0 to 6 : 2){
+    s = s + q;
+}
+print(s);
+let t = 0;
+for => (let x = 0 to 4){
+    print(x);
+}
+for => (let y = 0 to 4){
+    print(y + 10);
+}
+for => (let z = 0 to 4){
+    t = t + z;
+}
+print(t);
+let e = 0;
+let f = 0;
+for => (let u = 5 to 5){
+    e = e + 1;
+}
+for => (let v = 5 to 5){
+    f = f + 1;
+}
+print(v);
+print(e + f);
+let w = 0;
+for => (let g = 0 to 6 : 2){
+    w = w + g;
+}
+for => (let h = 0 to 6 : 2){
+    print(h);
+}
+print(w);
@@ -0,0 +1,41 @@
+let a = 0;
+let b = 100;
+let c = 7;
+for => (let i = 0 to 10){
+    if => (i < 5){
+        a = a + i;
+        b = b - 1;
+    }else{
+        c = c * 2 / 3;
+    }
+    if => (i == 3){
+        c = c + 100;
+    }
+    if => (a > b){
+        a = b;
+    }else{
+        b = b + 2;
+    }
+}
+print(a);
+print(b);
+print(c);
+let x = 1;
+let y = 2;
+for => (let k = 0 to 6){
+    if => (k > 2){
+        y = y + k;
+    }else{
+        x = y * 3;
+    }
+    if => (x > y){
+        x = y;
+        y = x;
+    }
+    if => (k != 4){
+        y = y + 1;
+        x = y;
+    }
+}
+print(x);
+print(y);
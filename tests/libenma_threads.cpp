@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libenma.h"
+
+//the programs of the tests are compiled by one context, then by many contexts on their threads at the same time,
+//every compilation has to give the bytes of the first one
+
+struct test_program{
+    std::string name;
+    std::string source;
+    std::string expected_output;
+};
+
+static std::string read_file(const std::filesystem::path& path){
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<test_program> read_programs(const std::filesystem::path& directory){
+    std::vector<test_program> programs;
+    for(const auto& entry : std::filesystem::directory_iterator(directory)){
+        if(entry.path().extension() != ".em")
+            continue;
+        auto stem = entry.path().stem().string();
+        programs.push_back({stem + ".em", read_file(entry.path()), read_file(directory / (stem + "_res"))});
+    }
+    return programs;
+}
+
+//the executable is written, run and its output compared with the one of the test
+static bool run_executable(const test_program& program, const std::vector<uint8_t>& executable){
+    auto path = std::filesystem::temp_directory_path() / ("libenma_threads_" + program.name + ".out");
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(executable.data()), executable.size());
+    }
+    std::filesystem::permissions(path, std::filesystem::perms::owner_all);
+    std::string output;
+    if(FILE* pipe = popen(path.c_str(), "r")){
+        char buffer[4096];
+        size_t size;
+        while((size = fread(buffer, 1, sizeof(buffer), pipe)) > 0){
+            output.append(buffer, size);
+        }
+        pclose(pipe);
+    }
+    std::filesystem::remove(path);
+    return output == program.expected_output;
+}
+
+int main(int argc, char** argv){
+    if(argc != 2){
+        std::cerr << "usage: libenma_threads <tests directory>\n";
+        return 1;
+    }
+    auto programs = read_programs(argv[1]);
+    if(programs.empty()){
+        std::cerr << "no programs in " << argv[1] << '\n';
+        return 1;
+    }
+
+    //the backends and levels the threads go through
+    std::vector<compile_options> configurations(4);
+    configurations[1].optimization_level = '0';
+    configurations[2].optimization_level = 's';
+    configurations[3].backend = "baseline";
+
+    std::vector<std::vector<compile_artifacts>> references(configurations.size());
+    for(size_t i = 0; i < configurations.size(); i++){
+        enma_context context(configurations[i]);
+        for(const auto& program : programs){
+            auto compiled = context.compile(program.source, program.name);
+            if(!compiled.is_success){
+                std::cerr << program.name << " - failed to compile:\n" << compiled.errors;
+                return 1;
+            }
+            if(!run_executable(program, compiled.artifacts.executable)){
+                std::cerr << program.name << " - wrong output of configuration " << i << '\n';
+                return 1;
+            }
+            references[i].push_back(std::move(compiled.artifacts));
+        }
+    }
+
+    //every thread has its context and compiles the programs in its own order, with a syntax error between them,
+    //so the identifiers of one program or one thread showing up in another change the bytes
+    const std::string broken_source = "let broken_identifier = ;\n";
+    constexpr int threads_count = 8;
+    constexpr int rounds = 3;
+    std::vector<std::string> failures(threads_count);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < threads_count; t++){
+        threads.emplace_back([&, t](){
+            size_t configuration = t % configurations.size();
+            enma_context context(configurations[configuration]);
+            std::ostringstream failure;
+            for(int round = 0; round < rounds; round++){
+                for(size_t p = 0; p < programs.size(); p++){
+                    size_t index = (p + t + round) % programs.size();
+                    auto compiled = context.compile(programs[index].source, programs[index].name);
+                    const auto& reference = references[configuration][index];
+                    if(!compiled.is_success){
+                        failure << programs[index].name << " - failed to compile:\n" << compiled.errors;
+                    }else if(compiled.artifacts.executable != reference.executable ||
+                     compiled.artifacts.object != reference.object || compiled.artifacts.assembly != reference.assembly){
+                        failure << programs[index].name << " - different artifacts on thread " << t << '\n';
+                    }
+                }
+                auto broken = context.compile(broken_source, "broken.em");
+                if(broken.is_success || broken.errors.find("syntax error") == std::string::npos){
+                    failure << "broken.em - no error on thread " << t << ":\n" << broken.errors;
+                }
+            }
+            failures[t] = failure.str();
+        });
+    }
+    for(auto& thread : threads){
+        thread.join();
+    }
+
+    bool is_success = true;
+    for(const auto& failure : failures){
+        if(!failure.empty()){
+            std::cerr << failure;
+            is_success = false;
+        }
+    }
+    std::cout << programs.size() << " programs, " << configurations.size() << " configurations, " << threads_count <<
+     " threads - " << (is_success ? "success" : "FAILED") << '\n';
+    return is_success ? 0 : 1;
+}
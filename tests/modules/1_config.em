@@ -0,0 +1,3 @@
+let width = 6;
+let height = 7;
+let depth = 0 - 2;
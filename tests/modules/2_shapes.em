@@ -0,0 +1,2 @@
+let area = width * height;
+let volume = area * depth;
@@ -0,0 +1,10 @@
+print(area);
+print(volume);
+let i = 0;
+while => (i < 3){
+    print(i * width + depth);
+    i = i + 1;
+}
+if => (volume < 0){
+    print(0 - volume);
+}
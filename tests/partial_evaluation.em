@@ -0,0 +1,34 @@
+let a = 12;
+let big = 65536 * 65536 + 5;
+print(big);
+print(big / 65536);
+let x = 1;
+if => (a > 0){
+    let y = 2;
+    print(y);
+    x = y + a;
+    print(x);
+}
+print(x);
+let f = 1;
+for => (let i = 1 to 11){
+    f = f * i;
+}
+print(f);
+let n = 27;
+let steps = 0;
+while => (n != 1){
+    if => (n / 2 * 2 == n){
+        n = n / 2;
+    }else{
+        n = 3 * n + 1;
+    }
+    steps = steps + 1;
+}
+print(steps);
+let s = 0;
+for => (let j = 0 to 300000){
+    s = s + j / 1000;
+}
+print(s);
+print(big - 5 + f);
@@ -0,0 +1,14 @@
+let a = 7;
+let b = 3;
+print((a*4 + a*4) / 8);
+print(a - a);
+print(b + 3 - 3);
+print((a + 1) * 2 - 2);
+if => (a + 2 < b + 2){
+    print(1);
+}
+print(a*3 + a*5 - a*8 + b);
+print(a / 2 / 3);
+print(a / (b - 3 + 1));
+let c = 2 * 4 - 8;
+print((b - b) + a / b);
@@ -0,0 +1,130 @@
+#!/bin/bash
+
+# the suite of ctest: every program of tests/ is compiled by the enma of $1 in a temporary directory
+# and its output is compared with tests/<name>_res, $2 is how the program is run:
+#   executable - the executable the compiler writes
+#   profile - the executable compiled with --profile-use and the profile of a build with --profile-generate,
+#             the hot loops are unrolled
+#   remarks - the executable, its --remarks-file has to have a remark and only json lines of remarks
+#   shared - a C program calling <name>_run of the --shared library
+#   server - the executable, compiled by a compile server the suite starts on its own socket
+#   direct - enma itself, its output is the one of the program (--run, the vm and the tiered backend)
+# the other arguments are passed to enma
+enma="$(realpath "$1")"
+mode="$2"
+shift 2
+options=("$@")
+# the programs of the C backend and the hosts of the libraries are built by cc, without it the suite is skipped
+if [[ "${mode}" == shared || " ${options[*]} " == *" --backend=c "* ]] && ! command -v cc > /dev/null
+    then
+        echo "cc isn't installed"
+        exit 77
+    fi
+tests="$(cd "$(dirname "$0")" && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "${work}"' EXIT
+cd "${work}"
+# a compile server of the user isn't used, only the one the mode starts
+export ENMA_SERVER_SOCKET="${work}/server.socket"
+
+# a json string: the characters but the quote, the backslash and the control characters, and the escapes
+json_string='"([^"\\[:cntrl:]]|\\["\\/bfnrt]|\\u[0-9a-fA-F]{4})*"'
+remark_line="^\\{\"kind\":\"(applied|missed)\",\"pass\":${json_string},\"file\":${json_string},\"line\":[0-9]+,\"message\":${json_string}\\}\$"
+
+# compile the files of a program and write its output to result
+run_program(){
+    case "${mode}" in
+        executable|server)
+            "${enma}" "$@" "${options[@]}" -o program > /dev/null && ./program > result
+            ;;
+        profile)
+            # the profile is written by the native backend, --backend=c can't be built with --profile-generate
+            "${enma}" "$@" --profile-generate -o profiled > /dev/null && ./profiled > /dev/null &&
+             "${enma}" "$@" "${options[@]}" --profile-use=profiled.profdata -o program > /dev/null && ./program > result
+            ;;
+        remarks)
+            "${enma}" "$@" "${options[@]}" --remarks-file=remarks.json -o program > /dev/null && ./program > result &&
+             [ -s remarks.json ] && ! grep -q -v -E "${remark_line}" remarks.json
+            ;;
+        shared)
+            # the host is the C program of the README: it includes the header and calls the library
+            "${enma}" "$@" "${options[@]}" --shared -o program > /dev/null &&
+             printf '#include "program.h"\nint main(void){\n    program_run();\n    return 0;\n}\n' > host.c &&
+             cc host.c -o host -L. -lprogram -Wl,-rpath,"${work}" && ./host > result
+            ;;
+        direct)
+            "${enma}" "$@" "${options[@]}" > result
+            ;;
+        *)
+            echo "unknown mode ${mode}"
+            exit 1
+            ;;
+    esac
+}
+
+if [ "${mode}" == server ]
+    then
+        "${enma}" --server="${ENMA_SERVER_SOCKET}" > server.log &
+        server=$!
+        for i in $(seq 100)
+            do
+            [ -S "${ENMA_SERVER_SOCKET}" ] && break
+            sleep 0.1
+            done
+    fi
+
+failed=0
+programs=0
+for test in "${tests}"/*.em "${tests}"/*/
+    do
+    test="${test%/}"
+    name="${test##*/}"
+    # the files are copied, so the files enma writes next to them stay in the temporary directory
+    cp -r "${test}" .
+    if [ -d "${test}" ]
+        then
+            files=("${name}"/*.em)
+        else
+            files=("${name}")
+            test="${test%.em}"
+        fi
+    if run_program "${files[@]}" && cmp -s "${test}_res" result
+        then
+            echo "${name} - success"
+        else
+            echo "${name} - FAILED"
+            failed=1
+        fi
+    rm -rf result "${name}"
+    programs=$((programs + 1))
+    done
+
+# the control characters of a file name are escaped in the remarks
+if [ "${mode}" == remarks ]
+    then
+        name=$'control\x01\x1f\tname.em'
+        cp "${tests}/loops.em" "${name}"
+        if run_program "${name}" && cmp -s "${tests}/loops_res" result && grep -q -F 'control\u0001\u001f\tname.em' remarks.json
+            then
+                echo "control characters - success"
+            else
+                echo "control characters - FAILED"
+                failed=1
+            fi
+    fi
+
+# every program has to have been compiled by the server, not by enma in its process
+if [ "${mode}" == server ]
+    then
+        kill -TERM "${server}"
+        wait "${server}"
+        if grep -q "^${programs} requests" server.log
+            then
+                echo "server - success"
+            else
+                echo "server - FAILED, ${programs} programs:"
+                cat server.log
+                failed=1
+            fi
+    fi
+exit ${failed}
@@ -0,0 +1,17 @@
+let a = 7;
+let b = 0 - 3;
+let c = 5;
+print(a * b + c * a);
+print(a / 2 + c / b + b * c);
+let d = (a + b) * (c - b) / (a * c - 1);
+print(d);
+let s = 0;
+for => (let i = 1 to 6){
+    s = s + i * a / 3 + i * b;
+    c = c * 2 - i / 2;
+}
+print(s);
+print(c);
+if => (a * b < c * d){
+    print(a * c - b * d);
+}
@@ -0,0 +1,30 @@
+let total = 0;
+for => (let i = 0 to 4){
+    let square = i * i;
+    total = total + square;
+}
+print(total);
+if => (total > 10){
+    let t = total - 10;
+    print(t);
+}else{
+    let t = 10 - total;
+    print(t);
+}
+let n = 0;
+while => (n < 3){
+    let t = n * 10;
+    if => (t > 5){
+        let u = t + 1;
+        print(u);
+    }
+    for => (let k = 0 to 2){
+        let v = k + t;
+        total = total + v;
+    }
+    n = n + 1;
+}
+print(total);
+print(i);
+if => (n == 3){}
+print(n);
@@ -0,0 +1,7 @@
+print(1+(2+(3+(4+(5+(6+(7+(8+(9+(10))))))))));
+let a = 100;
+print(a - (a/(2+(a/(5+(a/(10+(a - (90/(3+(a - (97))))))))))));
+let b = 1;
+if => (b < 1+(b+(b+(b+(b+(b+(b+(b+(b))))))))){
+    print(b*(2*(3*(4*(5*(6*(7*(8*(9*(b))))))))));
+}
@@ -0,0 +1,13 @@
+let b = 0;
+for => (let i = 0 to 6){
+    if => (i > 2){
+        b = i * 2;
+        print(b);
+        print(i);
+    }else{
+        b = i + 7;
+        print(b);
+        print(i);
+    }
+}
+print(b);
@@ -0,0 +1,49 @@
+let a = 7;
+let r = 0;
+if => (a < 5){
+    print(a);
+    r = 1;
+}
+if => (a < 3){
+    print(a);
+    r = r + 10;
+}
+if => (a > 5){
+    if => (a > 2){
+        print(a + 1);
+        r = r + 100;
+    }
+    if => (a == 3){
+        r = r + 1000;
+    }
+}
+print(r);
+let n = 0;
+let k = 0;
+while => (k < 10){
+    if => (k < 20){
+        n = n + 1;
+        print(k);
+    }else{
+        n = n - 1;
+    }
+    k = k + 1;
+}
+print(n);
+if => (1 == 2){
+    print(5);
+}else{
+    print(6);
+}
+let b = 3;
+if => (b != 3){
+    b = 0;
+}
+if => (b == 3){
+    b = b + 1;
+    print(b);
+}
+if => (b == 3){
+    b = 0;
+}
+print(b);
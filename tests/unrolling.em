@@ -0,0 +1,9 @@
+let s = 0;
+for => (let i = 0 to 2000){
+    let t = i * 2;
+    s = s + t;
+    if => (i > 1990){
+        print(t);
+    }
+}
+print(s);
@@ -0,0 +1,51 @@
+let mode = 2;
+let sum = 0;
+let limit = 5;
+for => (let i = 0 to 10){
+    if => (mode == 2){
+        sum = sum + i;
+    }else{
+        sum = sum - i;
+    }
+    if => (limit < 3){
+        sum = sum + 1000;
+    }
+}
+print(sum);
+let n = 0;
+let j = 0;
+while => (j < 4){
+    if => (sum > 40){
+        if => (mode != 2){
+            n = n + 100;
+        }
+        n = n + 1;
+    }
+    for => (let k = 0 to 3){
+        if => (limit > mode){
+            n = n + j;
+        }
+    }
+    j = j + 1;
+}
+print(n);
+let flag = 1;
+let m = 0;
+for => (let t = 0 to 6){
+    if => (flag == 1){
+        m = m + 10;
+        flag = 0;
+    }else{
+        m = m + 1;
+        flag = 1;
+    }
+}
+print(m);
+let d = 0;
+let e = 3;
+for => (let u = e to e){
+    if => (10 / d > 1){
+        e = 0;
+    }
+}
+print(e);
@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "asm_program.h"
+#include "elf_object.h"
+#include "x86_encoder.h"
+
+//the lines the code generator, the stencils of the baseline backend and the runtime library write are encoded
+//and compared with the bytes NASM writes for them with its default -Ox, so the encoder is checked without nasm
+//the forms are the ones check_encoding.sh compares: the shortest immediates, mov r64, imm32 as mov r32, imm32,
+//the accumulator forms, REX for spl to dil and r8 to r15, SIB for rsp and r12, a displacement for rbp and r13
+
+struct encoding_case{
+    std::string line;
+    std::string bytes;
+    //the relocation of a symbol field, none for an empty symbol
+    std::string symbol;
+    relocation_type type = relocation_type::PC_RELATIVE_32;
+    uint64_t offset = 0;
+    int64_t addend = 0;
+};
+
+static const std::vector<encoding_case> cases = {
+    {"mov rax, 60", "b8 3c 00 00 00"},
+    {"mov rdi, 0", "bf 00 00 00 00"},
+    {"mov r9, 1", "41 b9 01 00 00 00"},
+    {"mov r9d, 5", "41 b9 05 00 00 00"},
+    {"mov rcx, -1", "48 c7 c1 ff ff ff ff"},
+    {"mov rax, 4294967295", "b8 ff ff ff ff"},
+    {"mov rax, 4294967296", "48 b8 00 00 00 00 01 00 00 00"},
+    {"mov rbp, rsp", "48 89 e5"},
+    {"mov r12, r13", "4d 89 ec"},
+    {"mov rsi, r8", "4c 89 c6"},
+    {"add r8, r9", "4d 01 c8"},
+    {"sub rax, rcx", "48 29 c8"},
+    {"sub rsp, 16", "48 83 ec 10"},
+    {"add rax, 100000", "48 05 a0 86 01 00"},
+    {"cmp rax, -5", "48 83 f8 fb"},
+    {"and r9, 255", "49 81 e1 ff 00 00 00"},
+    {"imul r13, r14", "4d 0f af ee"},
+    {"imul rax, rax, -7", "48 6b c0 f9"},
+    {"imul rax, rax, 1000", "48 69 c0 e8 03 00 00"},
+    {"test r10, r10", "4d 85 d2"},
+    {"xor edi, edi", "31 ff"},
+    {"xor r9d, r9d", "45 31 c9"},
+    {"sete al", "0f 94 c0"},
+    {"setl sil", "40 0f 9c c6"},
+    {"setne r8b", "41 0f 95 c0"},
+    {"movzx eax, al", "0f b6 c0"},
+    {"movzx r9d, r9b", "45 0f b6 c9"},
+    {"cmovnz r8, r9", "4d 0f 45 c1"},
+    {"cqo", "48 99"},
+    {"idiv rcx", "48 f7 f9"},
+    {"idiv r11", "49 f7 fb"},
+    {"neg rax", "48 f7 d8"},
+    {"inc rcx", "48 ff c1"},
+    {"shl rax, 1", "48 d1 e0"},
+    {"sar rdx, 63", "48 c1 fa 3f"},
+    {"push rbp", "55"},
+    {"push r12", "41 54"},
+    {"pop r15", "41 5f"},
+    {"push 1", "6a 01"},
+    {"push 1000", "68 e8 03 00 00"},
+    {"syscall", "0f 05"},
+    {"ret", "c3"},
+    {"mov r8, [rbp - 8]", "4c 8b 45 f8"},
+    {"mov [rbp - 200], rax", "48 89 85 38 ff ff ff"},
+    {"add [rbp - 16], r9", "4c 01 4d f0"},
+    {"mov rax, [rsp + 8]", "48 8b 44 24 08"},
+    {"mov rax, [r12]", "49 8b 04 24"},
+    {"mov rax, [r13]", "49 8b 45 00"},
+    {"mov rax, [rbx + rcx*8 + 16]", "48 8b 44 cb 10"},
+    {"mov qword [rbp - 8], 0", "48 c7 45 f8 00 00 00 00"},
+    {"mov byte [rbp - 1], 10", "c6 45 ff 0a"},
+    //the fields of the symbols are zero, the linker writes them
+    {"call printf", "e8 00 00 00 00", "printf", relocation_type::PC_RELATIVE_32, 1, -4},
+    {"mov rdi, d_fmt", "48 bf 00 00 00 00 00 00 00 00", "d_fmt", relocation_type::ABSOLUTE_64, 2, 0},
+    {"mov rdi, [stdout]", "48 8b 3c 25 00 00 00 00", "stdout", relocation_type::ABSOLUTE_32S, 4, 0},
+    {"mov [rel counter], rax", "48 89 05 00 00 00 00", "counter", relocation_type::PC_RELATIVE_32, 3, -4},
+    {"lea r8, [rel counter + 19]", "4c 8d 05 00 00 00 00", "counter", relocation_type::PC_RELATIVE_32, 3, 15},
+    {"mov qword [rel counter], 0", "48 c7 05 00 00 00 00 00 00 00 00", "counter", relocation_type::PC_RELATIVE_32, 3, -8},
+};
+
+static std::vector<uint8_t> parse_bytes(const std::string& text){
+    std::istringstream input(text);
+    std::vector<uint8_t> bytes;
+    unsigned byte;
+    while(input >> std::hex >> byte){
+        bytes.push_back(static_cast<uint8_t>(byte));
+    }
+    return bytes;
+}
+
+static std::string to_hex(const std::vector<uint8_t>& bytes){
+    std::string text;
+    char digits[4];
+    for(auto byte : bytes){
+        std::snprintf(digits, sizeof(digits), "%02x ", byte);
+        text += digits;
+    }
+    return text.empty() ? text : text.substr(0, text.size() - 1);
+}
+
+static const object_section& get_text(const elf_object& object){
+    return object.get_sections()[object.find_section(".text")];
+}
+
+//return an empty string if the line gives the bytes and the relocation of the case
+static std::string check_case(const encoding_case& test){
+    auto object = x86_encoder().encode(asm_program("\textern printf\n\textern stdout\n\textern d_fmt\n\textern counter\n"
+     "section .text\n\t" + test.line + "\n"));
+    const auto& text = get_text(object);
+    if(text.bytes != parse_bytes(test.bytes))
+        return to_hex(text.bytes) + " instead of " + test.bytes;
+    if(test.symbol.empty())
+        return text.relocations.empty() ? "" : "a relocation of a line without a symbol";
+    if(text.relocations.size() != 1)
+        return std::to_string(text.relocations.size()) + " relocations instead of one";
+    const auto& relocation = text.relocations[0];
+    if(object.get_symbols()[relocation.symbol].name != test.symbol || relocation.type != test.type ||
+     relocation.offset != test.offset || relocation.addend != test.addend)
+        return "the relocation " + object.get_symbols()[relocation.symbol].name + " " +
+         std::to_string(static_cast<uint32_t>(relocation.type)) + " at " + std::to_string(relocation.offset) +
+         " + " + std::to_string(relocation.addend) + " instead of " + test.symbol + " " +
+         std::to_string(static_cast<uint32_t>(test.type)) + " at " + std::to_string(test.offset) + " + " + std::to_string(test.addend);
+    return "";
+}
+
+//a jump is short while its target is at most 127 bytes after it or 128 before, and long past that
+static std::string check_jumps(){
+    auto near = get_text(x86_encoder().encode(asm_program("section .text\nback:\n\tjz forward\n\tjmp back\nforward:\n\tret\n")));
+    if(near.bytes != parse_bytes("74 02 eb fc c3"))
+        return "near jumps: " + to_hex(near.bytes) + " instead of 74 02 eb fc c3";
+    //63 cqo are 126 bytes, 64 are 128
+    for(int count : {63, 64}){
+        std::string code = "section .text\n\tjz forward\n";
+        for(int i = 0; i < count; i++){
+            code += "\tcqo\n";
+        }
+        code += "forward:\n\tret\n";
+        auto far = get_text(x86_encoder().encode(asm_program(code)));
+        auto expected = count == 63 ? parse_bytes("74 7e") : parse_bytes("0f 84 80 00 00 00");
+        if(!std::equal(expected.begin(), expected.end(), far.bytes.begin()))
+            return "a jump over " + std::to_string(count * 2) + " bytes: " +
+             to_hex(std::vector<uint8_t>(far.bytes.begin(), far.bytes.begin() + expected.size())) + " instead of " + to_hex(expected);
+    }
+    return "";
+}
+
+int main(){
+    bool is_success = true;
+    for(const auto& test : cases){
+        std::string failure;
+        try{
+            failure = check_case(test);
+        }catch(const std::exception& error){
+            failure = error.what();
+        }
+        if(!failure.empty()){
+            std::cerr << test.line << " - " << failure << '\n';
+            is_success = false;
+        }
+    }
+    auto failure = check_jumps();
+    if(!failure.empty()){
+        std::cerr << failure << '\n';
+        is_success = false;
+    }
+    std::cout << cases.size() << " lines, the jumps - " << (is_success ? "success" : "FAILED") << '\n';
+    return is_success ? 0 : 1;
+}
@@ -2,7 +2,7 @@
 #include "token_types.h"
 #include "lexer.h"
 
-extern std::unique_ptr<symbol_table> global_sym_table;
+extern thread_local std::unique_ptr<symbol_table> global_sym_table;
 
 std::ostream& operator<<(std::ostream& os, const token_type& t){
     switch (t)
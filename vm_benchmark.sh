@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# the time from the start of enma to the end of the program with the bytecode interpreter and with the native code,
+# for the same loop run from 10 to 10000000 times: the interpreter starts sooner, the native code runs faster,
+# the tiered program starts in the interpreter and goes on in the native code after 1000 iterations
+# the partial evaluation is turned off, otherwise the short programs are run by the compiler
+cd build/
+cmake ..
+make
+
+echo ""
+TIMEFORMAT="%R"
+printf "%-12s %10s %10s %10s %10s\n" "iterations" "vm" "native" "--run" "tiered"
+for iterations in 10 1000 100000 1000000 10000000
+    do
+    cat > vm_bench.em << EOF
+let sum = 0;
+let odd = 0;
+for => (let i = 0 to ${iterations}){
+    let square = i * i;
+    if => (square / 3 * 3 == square){
+        sum = sum + i;
+    }else{
+        odd = odd + 1;
+    }
+    sum = sum - odd;
+}
+print(sum);
+print(odd);
+EOF
+    vm=$( { time ./enma vm_bench.em --backend=vm --eval-steps=0 > /dev/null; } 2>&1 )
+    native=$( { time (./enma vm_bench.em -o vm_bench --eval-steps=0 > /dev/null && ./vm_bench > /dev/null); } 2>&1 )
+    run=$( { time ./enma vm_bench.em --run --eval-steps=0 > /dev/null; } 2>&1 )
+    tiered=$( { time ./enma vm_bench.em --backend=tiered --eval-steps=0 > /dev/null; } 2>&1 )
+    printf "%-12s %9ss %9ss %9ss %9ss\n" "${iterations}" "${vm}" "${native}" "${run}" "${tiered}"
+    done
+    rm -f vm_bench vm_bench.o vm_bench.em
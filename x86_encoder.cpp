@@ -0,0 +1,682 @@
+#include <array>
+#include <bit>
+#include <stdexcept>
+#include <unordered_map>
+#include "x86_encoder.h"
+#include "elf_object.h"
+#include "asm_program.h"
+
+namespace{
+
+const std::array<const char*, 16> registers_64 = {
+    "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+const std::array<const char*, 16> registers_32 = {
+    "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+const std::array<const char*, 16> registers_8 = {
+    "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil", "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+//the /digit of the instructions of a group
+const std::unordered_map<std::string, int> arithmetic_group = {
+    {"add", 0}, {"or", 1}, {"adc", 2}, {"sbb", 3}, {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7}
+};
+const std::unordered_map<std::string, int> unary_group = {
+    {"not", 2}, {"neg", 3}, {"mul", 4}, {"imul", 5}, {"div", 6}, {"idiv", 7}
+};
+const std::unordered_map<std::string, int> shift_group = {
+    {"rol", 0}, {"ror", 1}, {"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7}
+};
+
+std::string trim(const std::string& str){
+    auto begin = str.find_first_not_of(" \t");
+    if(begin == std::string::npos)
+        return "";
+    auto end = str.find_last_not_of(" \t");
+    return str.substr(begin, end - begin + 1);
+}
+
+//decimal and 0x hexadecimal numbers, return false for other text
+bool parse_number(const std::string& text, int64_t& value){
+    bool is_negative = text.starts_with('-');
+    auto digits = is_negative ? text.substr(1) : text;
+    bool is_hex = digits.starts_with("0x") || digits.starts_with("0X");
+    if(is_hex)
+        digits = digits.substr(2);
+    if(digits.empty() || digits.find_first_not_of(is_hex ? "0123456789abcdefABCDEF" : "0123456789") != std::string::npos)
+        return false;
+    uint64_t magnitude = std::stoull(digits, nullptr, is_hex ? 16 : 10);
+    value = static_cast<int64_t>(is_negative ? 0 - magnitude : magnitude);
+    return true;
+}
+
+//return false if the text isn't a register
+bool parse_register(const std::string& text, int& reg, int& size){
+    for(int r = 0; r < 16; r++){
+        if(text == registers_64[r] || text == registers_32[r] || text == registers_8[r]){
+            reg = r;
+            size = text == registers_64[r] ? 64 : text == registers_32[r] ? 32 : 8;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+bool x86_encoder::is_int8(int64_t value){
+    return value >= -128 && value <= 127;
+}
+
+bool x86_encoder::is_int32(int64_t value){
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+int x86_encoder::get_condition_code(const std::string& suffix){
+    static const std::unordered_map<std::string, int> codes = {
+        {"o", 0}, {"no", 1}, {"b", 2}, {"c", 2}, {"nae", 2}, {"ae", 3}, {"nb", 3}, {"nc", 3}, {"e", 4}, {"z", 4},
+        {"ne", 5}, {"nz", 5}, {"be", 6}, {"na", 6}, {"a", 7}, {"nbe", 7}, {"s", 8}, {"ns", 9}, {"p", 10}, {"pe", 10},
+        {"np", 11}, {"po", 11}, {"l", 12}, {"nge", 12}, {"ge", 13}, {"nl", 13}, {"le", 14}, {"ng", 14}, {"g", 15}, {"nle", 15}
+    };
+    auto it = codes.find(suffix);
+    return it == codes.end() ? -1 : it->second;
+}
+
+x86_encoder::operand x86_encoder::parse_operand(const std::string& text){
+    operand op;
+    auto str = trim(text);
+    for(auto [prefix, size] : {std::pair{"qword ", 64}, {"dword ", 32}, {"word ", 16}, {"byte ", 8}}){
+        if(str.starts_with(prefix)){
+            op.size = size;
+            str = trim(str.substr(std::string(prefix).size()));
+            break;
+        }
+    }
+    if(str.starts_with('[') && str.ends_with(']')){
+        op.type = operand::kind::MEMORY;
+        //the terms of the address with their signs: a base, an index with a scale, a symbol and numbers
+        auto inner = trim(str.substr(1, str.size() - 2));
+        if(inner.starts_with("rel ")){
+            op.is_rip_relative = true;
+            inner = inner.substr(4);
+        }
+        size_t begin = 0;
+        bool is_negative = false;
+        while(begin <= inner.size()){
+            auto end = inner.find_first_of("+-", begin);
+            auto term = trim(inner.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+            int64_t number;
+            int reg, size;
+            if(term.empty()){
+                //a sign before the first term
+            }else if(auto star = term.find('*'); star != std::string::npos){
+                std::string name = trim(term.substr(0, star));
+                std::string scale = trim(term.substr(star + 1));
+                if(!parse_register(name, reg, size))
+                    std::swap(name, scale);
+                if(!parse_register(name, reg, size) || size != 64 || op.index != -1 || is_negative)
+                    throw std::runtime_error("the encoder doesn't support the address: " + text);
+                op.index = reg;
+                op.scale = std::stoi(scale);
+            }else if(parse_register(term, reg, size)){
+                if(size != 64 || is_negative || (op.base != -1 && op.index != -1))
+                    throw std::runtime_error("the encoder doesn't support the address: " + text);
+                (op.base == -1 ? op.base : op.index) = reg;
+            }else if(parse_number(term, number)){
+                op.value += is_negative ? -number : number;
+            }else{
+                if(!op.symbol.empty() || is_negative)
+                    throw std::runtime_error("the encoder doesn't support the address: " + text);
+                op.symbol = term;
+            }
+            if(end == std::string::npos)
+                break;
+            is_negative = inner[end] == '-';
+            begin = end + 1;
+        }
+        if(op.scale != 1 && op.scale != 2 && op.scale != 4 && op.scale != 8)
+            throw std::runtime_error("the encoder doesn't support the address: " + text);
+        if(op.is_rip_relative && (op.symbol.empty() || op.base != -1 || op.index != -1))
+            throw std::runtime_error("the encoder doesn't support the address: " + text);
+        return op;
+    }
+    if(parse_register(str, op.reg, op.size)){
+        op.type = operand::kind::REGISTER;
+    }else if(parse_number(str, op.value)){
+        op.type = operand::kind::IMMEDIATE;
+    }else{
+        op.type = operand::kind::SYMBOL;
+        op.symbol = str;
+    }
+    return op;
+}
+
+void x86_encoder::append_immediate(text_item& item, int64_t value, int bytes){
+    for(int i = 0; i < bytes; i++){
+        item.bytes.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+}
+
+void x86_encoder::encode_modrm(text_item& item, int size, const std::vector<uint8_t>& opcode, int reg_field, bool is_byte_reg,
+ const operand& rm){
+    bool is_register = rm.type == operand::kind::REGISTER;
+    uint8_t rex = (size == 64 ? 0x8 : 0) | (reg_field >= 8 ? 0x4 : 0);
+    if(is_register){
+        rex |= rm.reg >= 8 ? 0x1 : 0;
+    }else{
+        rex |= (rm.index >= 8 ? 0x2 : 0) | (rm.base >= 8 ? 0x1 : 0);
+    }
+    //spl, bpl, sil and dil exist only with a REX prefix, without it they are ah, ch, dh and bh
+    bool needs_rex = (is_register && rm.size == 8 && rm.reg >= 4 && rm.reg < 8) || (is_byte_reg && reg_field >= 4 && reg_field < 8);
+    if(rex != 0 || needs_rex)
+        item.bytes.push_back(0x40 | rex);
+    item.bytes.insert(item.bytes.end(), opcode.begin(), opcode.end());
+
+    uint8_t reg_bits = (reg_field & 7) << 3;
+    if(is_register){
+        item.bytes.push_back(0xC0 | reg_bits | (rm.reg & 7));
+        return;
+    }
+    auto append_displacement = [&item, &rm](int bytes){
+        if(!rm.symbol.empty())
+            item.fixups.push_back(fixup{static_cast<int>(item.bytes.size()), relocation_type::ABSOLUTE_32S, rm.symbol, rm.value});
+        append_immediate(item, rm.symbol.empty() ? rm.value : 0, bytes);
+    };
+    if(rm.is_rip_relative){
+        //the end of the instruction is subtracted from the addend by encode, after the immediates that follow the field
+        item.bytes.push_back(0x05 | reg_bits);
+        item.fixups.push_back(fixup{static_cast<int>(item.bytes.size()), relocation_type::PC_RELATIVE_32, rm.symbol, rm.value});
+        append_immediate(item, 0, 4);
+        return;
+    }
+    if(rm.index == 4)
+        throw std::runtime_error("rsp can't be an index register");
+    if(rm.base == -1){
+        //an absolute address is [disp32] with a SIB byte, the ModRM form without it is relative to rip
+        item.bytes.push_back(0x04 | reg_bits);
+        uint8_t index_bits = rm.index == -1 ? 0x20 : ((rm.index & 7) << 3);
+        uint8_t scale_bits = rm.index == -1 ? 0 : (std::countr_zero(static_cast<unsigned>(rm.scale)) << 6);
+        item.bytes.push_back(scale_bits | index_bits | 0x05);
+        append_displacement(4);
+        return;
+    }
+    if(!is_int32(rm.value))
+        throw std::runtime_error("the displacement doesn't fit 32 bits");
+    //rbp and r13 as the base always have a displacement, their encoding without one means [disp32]
+    int mod = !rm.symbol.empty() ? 2 : rm.value == 0 && (rm.base & 7) != 5 ? 0 : is_int8(rm.value) ? 1 : 2;
+    bool has_sib = rm.index != -1 || (rm.base & 7) == 4;
+    item.bytes.push_back((mod << 6) | reg_bits | (has_sib ? 0x04 : (rm.base & 7)));
+    if(has_sib){
+        uint8_t index_bits = rm.index == -1 ? 0x20 : ((rm.index & 7) << 3);
+        uint8_t scale_bits = rm.index == -1 ? 0 : (std::countr_zero(static_cast<unsigned>(rm.scale)) << 6);
+        item.bytes.push_back(scale_bits | index_bits | (rm.base & 7));
+    }
+    if(mod != 0)
+        append_displacement(mod == 1 ? 1 : 4);
+}
+
+x86_encoder::text_item x86_encoder::encode_instruction(const asm_line& line, const std::unordered_set<std::string>& text_labels){
+    const auto& name = line.opcode;
+    std::vector<operand> ops;
+    for(const auto& text : line.operands){
+        ops.push_back(parse_operand(text));
+    }
+    std::string line_text = name;
+    for(size_t i = 0; i < line.operands.size(); i++){
+        line_text += (i == 0 ? " " : ", ") + line.operands[i];
+    }
+    auto unsupported = [&line_text](){
+        return std::runtime_error("the encoder doesn't support the instruction: " + line_text);
+    };
+    auto is_kind = [&ops](size_t i, operand::kind type){ return i < ops.size() && ops[i].type == type; };
+    //the operation size is the size of a register operand or of the memory operand with a size
+    int size = 0;
+    for(const auto& op : ops){
+        if(op.size != 0){
+            size = op.size;
+            break;
+        }
+    }
+    bool is_byte = size == 8;
+    text_item item;
+
+    if(ops.empty()){
+        if(name == "syscall"){
+            item.bytes = {0x0F, 0x05};
+        }else if(name == "cqo"){
+            item.bytes = {0x48, 0x99};
+        }else if(name == "ret"){
+            item.bytes = {0xC3};
+        }else{
+            throw unsupported();
+        }
+        return item;
+    }
+    if((name == "jmp" || name == "call") && ops.size() == 1 && is_kind(0, operand::kind::REGISTER)){
+        //FF /4 and FF /2 take the 64-bit register without REX.W
+        encode_modrm(item, 32, {0xFF}, name == "jmp" ? 4 : 2, false, ops[0]);
+        return item;
+    }
+    if(name == "jmp" || name == "call" || (name.starts_with('j') && get_condition_code(name.substr(1)) != -1)){
+        if(ops.size() != 1 || !is_kind(0, operand::kind::SYMBOL))
+            throw unsupported();
+        if(text_labels.contains(ops[0].symbol)){
+            item.jump_target = ops[0].symbol;
+            item.condition = name == "jmp" ? -1 : name == "call" ? -2 : get_condition_code(name.substr(1));
+            item.is_long = name == "call";
+            return item;
+        }
+        if(name != "call")
+            throw std::runtime_error("the jump target isn't a label of the text section: " + ops[0].symbol);
+        //a call of a function of another object, the field is relative to the next instruction
+        item.bytes = {0xE8};
+        item.fixups.push_back(fixup{1, relocation_type::PC_RELATIVE_32, ops[0].symbol, 0});
+        append_immediate(item, 0, 4);
+        return item;
+    }
+    if((name == "push" || name == "pop") && ops.size() == 1){
+        if(is_kind(0, operand::kind::REGISTER) && size == 64){
+            if(ops[0].reg >= 8)
+                item.bytes.push_back(0x41);
+            item.bytes.push_back((name == "push" ? 0x50 : 0x58) + (ops[0].reg & 7));
+            return item;
+        }
+        if(name == "push" && is_kind(0, operand::kind::IMMEDIATE) && is_int32(ops[0].value)){
+            bool is_short = is_int8(ops[0].value);
+            item.bytes.push_back(is_short ? 0x6A : 0x68);
+            append_immediate(item, ops[0].value, is_short ? 1 : 4);
+            return item;
+        }
+    }
+    if(size != 8 && size != 32 && size != 64)
+        throw std::runtime_error("the operation size isn't known: " + line_text);
+
+    if(name == "mov" && ops.size() == 2){
+        if(is_kind(0, operand::kind::REGISTER) && is_kind(1, operand::kind::IMMEDIATE)){
+            int64_t value = ops[1].value;
+            uint8_t rex = ops[0].reg >= 8 ? 0x41 : 0;
+            if(size == 64 && is_int32(value) && value < 0){
+                //a negative number is sign-extended from 32 bits
+                encode_modrm(item, 64, {0xC7}, 0, false, ops[0]);
+                append_immediate(item, value, 4);
+                return item;
+            }
+            //a write to the 32-bit register clears the upper half, so a number of 32 bits takes mov r32, imm32
+            bool is_wide = size == 64 && (value < 0 || value > UINT32_MAX);
+            if(is_wide)
+                rex |= 0x48;
+            if(is_byte && ops[0].reg >= 4)
+                rex |= 0x40;
+            if(rex != 0)
+                item.bytes.push_back(rex);
+            item.bytes.push_back((is_byte ? 0xB0 : 0xB8) + (ops[0].reg & 7));
+            append_immediate(item, value, is_byte ? 1 : is_wide ? 8 : 4);
+            return item;
+        }
+        if(is_kind(0, operand::kind::REGISTER) && is_kind(1, operand::kind::SYMBOL) && size == 64){
+            //the address of a symbol takes 64 bits, the linker fills it
+            item.bytes = {static_cast<uint8_t>(ops[0].reg >= 8 ? 0x49 : 0x48), static_cast<uint8_t>(0xB8 + (ops[0].reg & 7))};
+            item.fixups.push_back(fixup{2, relocation_type::ABSOLUTE_64, ops[1].symbol, 0});
+            append_immediate(item, 0, 8);
+            return item;
+        }
+        if(is_kind(0, operand::kind::MEMORY) && is_kind(1, operand::kind::IMMEDIATE)){
+            if(size == 64 && !is_int32(ops[1].value))
+                throw unsupported();
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xC6 : 0xC7)}, 0, false, ops[0]);
+            append_immediate(item, ops[1].value, is_byte ? 1 : 4);
+            return item;
+        }
+        if(is_kind(1, operand::kind::REGISTER) && !is_kind(0, operand::kind::IMMEDIATE) && !is_kind(0, operand::kind::SYMBOL)){
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0x88 : 0x89)}, ops[1].reg, is_byte, ops[0]);
+            return item;
+        }
+        if(is_kind(0, operand::kind::REGISTER) && is_kind(1, operand::kind::MEMORY)){
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0x8A : 0x8B)}, ops[0].reg, is_byte, ops[1]);
+            return item;
+        }
+        throw unsupported();
+    }
+    if(arithmetic_group.contains(name) && ops.size() == 2 && !is_kind(0, operand::kind::IMMEDIATE)){
+        int digit = arithmetic_group.at(name);
+        if(is_kind(1, operand::kind::IMMEDIATE)){
+            int64_t value = ops[1].value;
+            if(size == 64 && !is_int32(value))
+                throw unsupported();
+            if(is_byte){
+                encode_modrm(item, size, {0x80}, digit, false, ops[0]);
+                append_immediate(item, value, 1);
+            }else if(is_int8(value)){
+                encode_modrm(item, size, {0x83}, digit, false, ops[0]);
+                append_immediate(item, value, 1);
+            }else if(is_kind(0, operand::kind::REGISTER) && ops[0].reg == 0){
+                //the accumulator has a form without ModRM
+                if(size == 64)
+                    item.bytes.push_back(0x48);
+                item.bytes.push_back(digit * 8 + 5);
+                append_immediate(item, value, 4);
+            }else{
+                encode_modrm(item, size, {0x81}, digit, false, ops[0]);
+                append_immediate(item, value, 4);
+            }
+            return item;
+        }
+        if(is_kind(1, operand::kind::REGISTER)){
+            encode_modrm(item, size, {static_cast<uint8_t>(digit * 8 + (is_byte ? 0 : 1))}, ops[1].reg, is_byte, ops[0]);
+            return item;
+        }
+        if(is_kind(0, operand::kind::REGISTER) && is_kind(1, operand::kind::MEMORY)){
+            encode_modrm(item, size, {static_cast<uint8_t>(digit * 8 + (is_byte ? 2 : 3))}, ops[0].reg, is_byte, ops[1]);
+            return item;
+        }
+        throw unsupported();
+    }
+    if(name == "test" && ops.size() == 2){
+        if(is_kind(1, operand::kind::REGISTER)){
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0x84 : 0x85)}, ops[1].reg, is_byte, ops[0]);
+            return item;
+        }
+        if(is_kind(1, operand::kind::IMMEDIATE) && (size != 64 || is_int32(ops[1].value))){
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xF6 : 0xF7)}, 0, false, ops[0]);
+            append_immediate(item, ops[1].value, is_byte ? 1 : 4);
+            return item;
+        }
+        throw unsupported();
+    }
+    if(name == "imul" && ops.size() >= 2 && is_kind(0, operand::kind::REGISTER) && !is_byte){
+        //imul r, imm is imul r, r, imm
+        const auto& source = ops.size() == 3 || !is_kind(1, operand::kind::IMMEDIATE) ? ops[1] : ops[0];
+        const auto& factor = ops.size() == 3 ? ops[2] : ops[1];
+        if(source.type == operand::kind::IMMEDIATE || source.type == operand::kind::SYMBOL)
+            throw unsupported();
+        if(factor.type == operand::kind::IMMEDIATE && (size != 64 || is_int32(factor.value))){
+            bool is_short = is_int8(factor.value);
+            encode_modrm(item, size, {static_cast<uint8_t>(is_short ? 0x6B : 0x69)}, ops[0].reg, false, source);
+            append_immediate(item, factor.value, is_short ? 1 : 4);
+            return item;
+        }
+        if(ops.size() == 2 && factor.type != operand::kind::SYMBOL){
+            encode_modrm(item, size, {0x0F, 0xAF}, ops[0].reg, false, source);
+            return item;
+        }
+        throw unsupported();
+    }
+    if(unary_group.contains(name) && ops.size() == 1 && !is_kind(0, operand::kind::IMMEDIATE) && !is_kind(0, operand::kind::SYMBOL)){
+        encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xF6 : 0xF7)}, unary_group.at(name), false, ops[0]);
+        return item;
+    }
+    if((name == "inc" || name == "dec") && ops.size() == 1 && !is_kind(0, operand::kind::IMMEDIATE) && !is_kind(0, operand::kind::SYMBOL)){
+        encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xFE : 0xFF)}, name == "inc" ? 0 : 1, false, ops[0]);
+        return item;
+    }
+    if(shift_group.contains(name) && ops.size() == 2 && is_kind(1, operand::kind::IMMEDIATE) && !is_kind(0, operand::kind::SYMBOL)){
+        int digit = shift_group.at(name);
+        if(ops[1].value == 1){
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xD0 : 0xD1)}, digit, false, ops[0]);
+        }else{
+            encode_modrm(item, size, {static_cast<uint8_t>(is_byte ? 0xC0 : 0xC1)}, digit, false, ops[0]);
+            append_immediate(item, ops[1].value, 1);
+        }
+        return item;
+    }
+    if(name == "lea" && ops.size() == 2 && is_kind(0, operand::kind::REGISTER) && is_kind(1, operand::kind::MEMORY) && !is_byte){
+        encode_modrm(item, size, {0x8D}, ops[0].reg, false, ops[1]);
+        return item;
+    }
+    if(name == "movzx" && ops.size() == 2 && is_kind(0, operand::kind::REGISTER) && !is_kind(1, operand::kind::IMMEDIATE)){
+        if(ops[1].size != 8 || is_byte)
+            throw unsupported();
+        encode_modrm(item, size, {0x0F, 0xB6}, ops[0].reg, false, ops[1]);
+        return item;
+    }
+    if(name.starts_with("set") && get_condition_code(name.substr(3)) != -1 && ops.size() == 1 && is_byte){
+        encode_modrm(item, 8, {0x0F, static_cast<uint8_t>(0x90 + get_condition_code(name.substr(3)))}, 0, false, ops[0]);
+        return item;
+    }
+    if(name.starts_with("cmov") && get_condition_code(name.substr(4)) != -1 && ops.size() == 2 && is_kind(0, operand::kind::REGISTER) &&
+     !is_byte && (is_kind(1, operand::kind::REGISTER) || is_kind(1, operand::kind::MEMORY))){
+        encode_modrm(item, size, {0x0F, static_cast<uint8_t>(0x40 + get_condition_code(name.substr(4)))}, ops[0].reg, false, ops[1]);
+        return item;
+    }
+    throw unsupported();
+}
+
+void x86_encoder::encode_data(const std::string& directive, std::vector<uint8_t>& bytes, std::vector<fixup>& fixups){
+    auto text = trim(directive);
+    auto name_end = text.find_first_of(" \t");
+    auto name = text.substr(0, name_end);
+    auto rest = name_end == std::string::npos ? "" : trim(text.substr(name_end));
+    if(name == "times"){
+        auto count_end = rest.find_first_of(" \t");
+        int64_t count;
+        if(count_end == std::string::npos || !parse_number(rest.substr(0, count_end), count))
+            throw std::runtime_error("the encoder doesn't support the data: " + text);
+        for(int64_t i = 0; i < count; i++){
+            encode_data(rest.substr(count_end), bytes, fixups);
+        }
+        return;
+    }
+    static const std::unordered_map<std::string, int> unit_sizes = {{"db", 1}, {"dw", 2}, {"dd", 4}, {"dq", 8}};
+    if(!unit_sizes.contains(name))
+        throw std::runtime_error("the encoder doesn't support the data: " + text);
+    int unit = unit_sizes.at(name);
+
+    //the values are split by the commas outside of the quotes
+    std::vector<std::string> values(1);
+    char quote = 0;
+    for(char c : rest){
+        if(quote == 0 && c == ','){
+            values.emplace_back();
+            continue;
+        }
+        if(c == '\'' || c == '"' || c == '`')
+            quote = quote == 0 ? c : quote == c ? 0 : quote;
+        values.back() += c;
+    }
+    for(auto& value : values){
+        value = trim(value);
+        int64_t number;
+        if(value.size() >= 2 && (value.front() == '\'' || value.front() == '"') && value.back() == value.front()){
+            //a string fills whole units
+            bytes.insert(bytes.end(), value.begin() + 1, value.end() - 1);
+            while((value.size() - 2) % unit != 0){
+                bytes.push_back(0);
+                value += ' ';
+            }
+        }else if(parse_number(value, number)){
+            for(int i = 0; i < unit; i++){
+                bytes.push_back(static_cast<uint8_t>(static_cast<uint64_t>(number) >> (i * 8)));
+            }
+        }else if(unit == 8 && !value.empty()){
+            fixups.push_back(fixup{static_cast<int>(bytes.size()), relocation_type::ABSOLUTE_64, value, 0});
+            bytes.insert(bytes.end(), 8, 0);
+        }else{
+            throw std::runtime_error("the encoder doesn't support the data: " + text);
+        }
+    }
+}
+
+elf_object x86_encoder::encode(const asm_program& program) const{
+    const auto& lines = program.get_lines();
+    std::unordered_set<std::string> text_labels;
+    for(const auto& line : lines){
+        if(line.is_label())
+            text_labels.insert(line.text);
+    }
+
+    elf_object object;
+    int text_section = -1;
+    int current_section = -1;
+    std::vector<text_item> items;
+    std::vector<std::string> labels;
+    std::unordered_set<std::string> externs;
+    std::unordered_set<std::string> globals;
+    //the labels of the data and the symbol fields of the data with their sections
+    std::vector<std::pair<std::string, std::pair<int, uint64_t>>> data_labels;
+    std::vector<std::pair<int, fixup>> data_fixups;
+    auto get_section = [&object](const std::string& name){
+        int section = object.find_section(name);
+        if(section != -1)
+            return section;
+        //the attributes NASM gives to the sections of elf64
+        if(name == ".text")
+            return object.add_section(name, elf_object::allocated | elf_object::executable, 16);
+        if(name == ".data")
+            return object.add_section(name, elf_object::allocated | elf_object::writable, 4);
+        if(name == ".bss")
+            throw std::runtime_error("the encoder doesn't support the section .bss");
+        return object.add_section(name, 0, 1);
+    };
+    for(const auto& line : lines){
+        if(line.is_label()){
+            labels.push_back(line.text);
+            continue;
+        }
+        if(line.is_instruction()){
+            if(current_section != text_section || text_section == -1)
+                throw std::runtime_error("an instruction outside of the text section: " + line.opcode);
+            items.push_back(encode_instruction(line, text_labels));
+            for(auto& item_fixup : items.back().fixups){
+                if(item_fixup.type == relocation_type::PC_RELATIVE_32)
+                    item_fixup.addend -= static_cast<int64_t>(items.back().bytes.size()) - item_fixup.offset;
+            }
+            items.back().labels = std::move(labels);
+            labels.clear();
+            continue;
+        }
+        auto text = trim(line.text);
+        if(text.empty() || text.starts_with(';'))
+            continue;
+        if(text.starts_with("section ")){
+            current_section = get_section(trim(text.substr(8)));
+            if(object.get_sections()[current_section].name == ".text")
+                text_section = current_section;
+            continue;
+        }
+        if(text.starts_with("extern ") || text.starts_with("global ")){
+            (text[0] == 'e' ? externs : globals).insert(trim(text.substr(7)));
+            continue;
+        }
+        if(current_section == -1 || current_section == text_section)
+            throw std::runtime_error("the encoder doesn't support the line: " + text);
+        //"name:", "name db ..." or "db ..." in the data
+        auto& bytes = object.get_sections()[current_section].bytes;
+        auto name_end = text.find_first_of(" \t:");
+        auto name = text.substr(0, name_end);
+        static const std::unordered_set<std::string> directives = {"db", "dw", "dd", "dq", "times"};
+        if(!directives.contains(name)){
+            data_labels.push_back({name, {current_section, bytes.size()}});
+            text = name_end == std::string::npos ? "" : trim(text.substr(name_end + (text[name_end] == ':' ? 1 : 0)));
+            if(text.empty())
+                continue;
+        }
+        std::vector<fixup> fixups;
+        encode_data(text, bytes, fixups);
+        for(auto& data_fixup : fixups){
+            data_fixups.push_back({current_section, data_fixup});
+        }
+    }
+    if(!labels.empty()){
+        items.emplace_back();
+        items.back().labels = std::move(labels);
+    }
+
+    //every jump starts short and gets the long form when its target is too far, until no jump changes
+    std::unordered_map<std::string, int> label_items;
+    for(int i = 0; i < static_cast<int>(items.size()); i++){
+        for(const auto& label : items[i].labels){
+            label_items[label] = i;
+        }
+    }
+    auto get_size = [](const text_item& item) -> uint64_t{
+        if(item.jump_target.empty())
+            return item.bytes.size();
+        if(!item.is_long)
+            return 2;
+        return item.condition >= 0 ? 6 : 5;
+    };
+    bool is_changed = true;
+    while(is_changed){
+        is_changed = false;
+        uint64_t offset = 0;
+        for(auto& item : items){
+            item.offset = offset;
+            offset += get_size(item);
+        }
+        for(auto& item : items){
+            if(item.jump_target.empty() || item.is_long)
+                continue;
+            int64_t distance = items[label_items[item.jump_target]].offset - (item.offset + 2);
+            if(!is_int8(distance)){
+                item.is_long = true;
+                is_changed = true;
+            }
+        }
+    }
+
+    std::vector<std::pair<int, fixup>> text_fixups;
+    if(text_section != -1){
+        auto& bytes = object.get_sections()[text_section].bytes;
+        for(auto& item : items){
+            if(!item.jump_target.empty()){
+                int64_t distance = items[label_items[item.jump_target]].offset - (item.offset + get_size(item));
+                if(!item.is_long){
+                    item.bytes = {static_cast<uint8_t>(item.condition >= 0 ? 0x70 + item.condition : 0xEB)};
+                    append_immediate(item, distance, 1);
+                }else{
+                    if(item.condition >= 0){
+                        item.bytes = {0x0F, static_cast<uint8_t>(0x80 + item.condition)};
+                    }else{
+                        item.bytes = {static_cast<uint8_t>(item.condition == -1 ? 0xE9 : 0xE8)};
+                    }
+                    append_immediate(item, distance, 4);
+                }
+            }
+            for(auto text_fixup : item.fixups){
+                text_fixup.offset += item.offset;
+                text_fixups.push_back({text_section, text_fixup});
+            }
+            bytes.insert(bytes.end(), item.bytes.begin(), item.bytes.end());
+        }
+    }
+
+    //the symbols of the labels, the fields of the labels refer to their sections like the fields NASM makes
+    std::unordered_map<std::string, std::pair<int, uint64_t>> definitions;
+    for(const auto& item : items){
+        for(const auto& label : item.labels){
+            definitions[label] = {text_section, item.offset};
+            object.add_symbol(label, text_section, item.offset, globals.contains(label));
+        }
+    }
+    for(const auto& [label, place] : data_labels){
+        if(definitions.contains(label))
+            throw std::runtime_error("the symbol is defined twice: " + label);
+        definitions[label] = place;
+        object.add_symbol(label, place.first, place.second, globals.contains(label));
+    }
+    for(const auto& name : globals){
+        if(!definitions.contains(name))
+            throw std::runtime_error("the global symbol isn't defined: " + name);
+    }
+    std::unordered_map<std::string, int> extern_symbols;
+    for(auto& [section, symbol_fixup] : text_fixups){
+        data_fixups.push_back({section, symbol_fixup});
+    }
+    for(const auto& [section, symbol_fixup] : data_fixups){
+        object_relocation relocation{static_cast<uint64_t>(symbol_fixup.offset), symbol_fixup.type, 0, symbol_fixup.addend};
+        auto definition = definitions.find(symbol_fixup.symbol);
+        if(definition != definitions.end()){
+            relocation.symbol = object.get_sections()[definition->second.first].symbol;
+            relocation.addend += definition->second.second;
+        }else if(externs.contains(symbol_fixup.symbol)){
+            if(!extern_symbols.contains(symbol_fixup.symbol))
+                extern_symbols[symbol_fixup.symbol] = object.add_symbol(symbol_fixup.symbol, -1, 0, true);
+            relocation.symbol = extern_symbols[symbol_fixup.symbol];
+        }else{
+            throw std::runtime_error("the symbol isn't defined: " + symbol_fixup.symbol);
+        }
+        object.get_sections()[section].relocations.push_back(relocation);
+    }
+    return object;
+}
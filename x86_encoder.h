@@ -0,0 +1,79 @@
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class asm_program;
+struct asm_line;
+enum class relocation_type : uint32_t;
+
+//the machine code of the generated assembly without an assembler: the lines of the text section are encoded
+//to x86-64 and the data directives to bytes, the symbols the object doesn't define are left to the linker
+//the encodings are the ones NASM chooses with its default -Ox, so both paths give the same bytes:
+//the shortest immediates, the short jumps where the target is near, mov r64, imm32 as mov r32, imm32
+//the encoder takes the lines of the asm_program, not operands the code generator builds: the generator writes text
+//and the passes of the assembly edit its lines, so the operands are parsed again here, and an instruction
+//the parser doesn't know fails when a program is compiled, tests/x86_encoder_bytes.cpp checks the forms that are used
+class x86_encoder{
+private:
+    struct operand{
+        enum class kind{
+            REGISTER,
+            IMMEDIATE,
+            //the address of a symbol as an immediate: mov rdi, d_fmt
+            SYMBOL,
+            MEMORY
+        };
+        kind type;
+        //the register number of a register operand, 0-15 like the encoding
+        int reg = -1;
+        //the size of a register or of a memory operand with qword/dword/byte in bits, 0 if it isn't known
+        int size = 0;
+        //the immediate or the displacement of an address
+        int64_t value = 0;
+        //the symbol of an address or of an immediate
+        std::string symbol;
+        int base = -1;
+        int index = -1;
+        int scale = 1;
+        //[rel name]: the field is the distance from the end of the instruction to the symbol
+        bool is_rip_relative = false;
+    };
+    //a symbol field of an encoded instruction, resolved when all labels are known
+    struct fixup{
+        int offset;
+        relocation_type type;
+        std::string symbol;
+        int64_t addend;
+    };
+    //an encoded line of the text section, a jump to a label is encoded when the distance is known
+    struct text_item{
+        std::vector<uint8_t> bytes;
+        std::vector<fixup> fixups;
+        //the labels at the beginning of the item
+        std::vector<std::string> labels;
+        std::string jump_target;
+        //the condition code of a conditional jump, -1 for jmp, -2 for a call of a label
+        int condition = -1;
+        bool is_long = false;
+        uint64_t offset = 0;
+    };
+private:
+    static operand parse_operand(const std::string& text);
+    static bool is_int8(int64_t value);
+    static bool is_int32(int64_t value);
+    //return -1 if the suffix of a jcc, setcc or cmovcc isn't a condition
+    static int get_condition_code(const std::string& suffix);
+
+    //REX, the opcode, ModRM, SIB and the displacement, reg_field is the register or the /digit of the opcode
+    static void encode_modrm(text_item& item, int size, const std::vector<uint8_t>& opcode, int reg_field, bool is_byte_reg,
+     const operand& rm);
+    static void append_immediate(text_item& item, int64_t value, int bytes);
+    //throw std::runtime_error for an instruction the encoder doesn't know
+    static text_item encode_instruction(const asm_line& line, const std::unordered_set<std::string>& text_labels);
+    //db, dq and times of the data section
+    static void encode_data(const std::string& directive, std::vector<uint8_t>& bytes, std::vector<fixup>& fixups);
+public:
+    //throw std::runtime_error for a line that can't be encoded or a symbol that isn't defined or extern
+    class elf_object encode(const asm_program& program) const;
+};